@@ -10,6 +10,7 @@
 #include <EVENT/Track.h>
 
 #include "KiTrack/Segment.h"
+#include "CellIDDecoder.h"
 
 
 
@@ -90,6 +91,8 @@ protected:
    
    std::string _colNameMCTrueTracksRel;
    
+   /** decodes the cellIDs of the hits, made in init */
+   const KiTrackMarlin::CellIDDecoder* _cellIDDecoder;
   
    
 } ;
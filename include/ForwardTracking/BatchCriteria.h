@@ -0,0 +1,320 @@
+#ifndef BatchCriteria_h
+#define BatchCriteria_h
+
+#include <string>
+#include <vector>
+#include <cmath>
+
+#include "Criteria/ICriterion.h"
+
+#include "IBatchCriterion.h"
+#include "PrecisionValidator.h"
+
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+   
+   
+   /** Runs the check of the cut off values of a criterion over all pairs of the batch. 
+    * 
+    * Cuts needs a method template< class T > bool check( xA, yA, zA, xB, yB, zB ) const, that calculates in the
+    * precision T. The cuts are passed by value, so the compiler knows the mask doesn't change them: the check gets
+    * inlined and the loop can be vectorized. In float the loop checks twice as many pairs per instruction as in double.
+    */
+   template< class T , class Cuts >
+   void filterBatch( const Cuts cuts , const HitPairBatch& batch , std::vector< char >& pass ){
+      
+      
+      const unsigned n = batch.size();
+      
+      const float* xA = batch.xA.data();
+      const float* yA = batch.yA.data();
+      const float* zA = batch.zA.data();
+      const float* xB = batch.xB.data();
+      const float* yB = batch.yB.data();
+      const float* zB = batch.zB.data();
+      char* p = pass.data();
+      
+      // a local copy: the mask can't alias it, also when the function isn't inlined
+      const Cuts c = cuts;
+      
+      for( unsigned i=0; i < n; i++ ) p[i] &= c.check( T( xA[i] ), T( yA[i] ), T( zA[i] ), T( xB[i] ), T( yB[i] ), T( zB[i] ) );
+      
+      
+   }
+   
+   
+   /** Compares the decisions of a check made in float (passFloat) and in double (passDouble) for the pairs
+    * not rejected before (pass) and tells the validator.
+    */
+   void recordPrecisionDecisions( const std::string& checkName , const HitPairBatch& batch , const std::vector< char >& pass ,
+                                  const std::vector< char >& passFloat , const std::vector< char >& passDouble , PrecisionValidator* validator );
+   
+   
+   /** Runs the check of the cut off values over the batch in float or double precision.
+    * 
+    * With a validator the check is run in both and the decisions are compared, the mask gets the ones of the
+    * precision chosen with useFloat.
+    */
+   template< class Cuts >
+   void filterBatchInPrecision( const Cuts& cuts , const HitPairBatch& batch , std::vector< char >& pass , 
+                                bool useFloat , PrecisionValidator* validator , const std::string& checkName ){
+      
+      
+      if( validator == NULL ){
+         
+         if( useFloat ) filterBatch< float >( cuts, batch, pass );
+         else filterBatch< double >( cuts, batch, pass );
+         
+         return;
+         
+      }
+      
+      std::vector< char > passFloat( pass );
+      std::vector< char > passDouble( pass );
+      
+      filterBatch< float >( cuts, batch, passFloat );
+      filterBatch< double >( cuts, batch, passDouble );
+      
+      recordPrecisionDecisions( checkName, batch, pass, passFloat, passDouble, validator );
+      
+      pass.swap( useFloat ? passFloat : passDouble );
+      
+      
+   }
+   
+   
+   /** Batch version of Crit2_DeltaRho: the difference of the distances of the hits from the z axis, rhoA - rhoB */
+   class BatchCrit2_DeltaRho : public IBatchCriterion{
+      
+   public:
+      
+      /** The cut off values and the check of one pair */
+      struct Cuts{
+         
+         double deltaRhoMin;
+         double deltaRhoMax;
+         
+         template< class T >
+         bool check( T xA , T yA , T , T xB , T yB , T ) const {
+            
+            T deltaRho = std::sqrt( xA*xA + yA*yA ) - std::sqrt( xB*xB + yB*yB );
+            
+            return ( deltaRho <= T( deltaRhoMax ) ) & ( deltaRho >= T( deltaRhoMin ) );
+            
+         }
+         
+      };
+      
+      BatchCrit2_DeltaRho( float deltaRhoMin , float deltaRhoMax );
+      
+      virtual void filter( const HitPairBatch& batch , std::vector< char >& pass ) const;
+      
+      const Cuts& getCuts() const { return _cuts; }
+      
+      static const char* getCritName(){ return "Crit2_DeltaRho"; }
+      
+   private:
+      
+      Cuts _cuts;
+      
+   };
+   
+   
+   /** Batch version of Crit2_RZRatio: the distance of the hits divided by their distance in z.
+    * 
+    * The squares are compared, like in Crit2_RZRatio, and multiplied out instead of dividing, so the check has no branches.
+    */
+   class BatchCrit2_RZRatio : public IBatchCriterion{
+      
+   public:
+      
+      /** The cut off values and the check of one pair */
+      struct Cuts{
+         
+         double ratioMin2;
+         double ratioMax2;
+         bool zeroInRange;
+         
+         template< class T >
+         bool check( T xA , T yA , T zA , T xB , T yB , T zB ) const {
+            
+            T dx = xA - xB;
+            T dy = yA - yB;
+            T dz = zA - zB;
+            
+            T deltaZ2 = dz*dz;
+            T deltaPos2 = dx*dx + dy*dy + deltaZ2;
+            
+            // like Crit2_RZRatio: if the hits are at the same z, the ratio is 0
+            bool defined = ( dz != T( 0 ) );
+            bool inRange = ( deltaPos2 <= T( ratioMax2 ) * deltaZ2 ) & ( deltaPos2 >= T( ratioMin2 ) * deltaZ2 );
+            
+            return ( defined & inRange ) | ( !defined & zeroInRange );
+            
+         }
+         
+      };
+      
+      BatchCrit2_RZRatio( float ratioMin , float ratioMax );
+      
+      virtual void filter( const HitPairBatch& batch , std::vector< char >& pass ) const;
+      
+      const Cuts& getCuts() const { return _cuts; }
+      
+      static const char* getCritName(){ return "Crit2_RZRatio"; }
+      
+   private:
+      
+      Cuts _cuts;
+      
+   };
+   
+   
+   /** Batch version of Crit2_StraightTrackRatio: (rhoA / zA) / (rhoB / zB), which is 1 for a straight track from the IP.
+    * 
+    * The squares are compared and multiplied out instead of dividing.
+    */
+   class BatchCrit2_StraightTrackRatio : public IBatchCriterion{
+      
+   public:
+      
+      /** The cut off values and the check of one pair */
+      struct Cuts{
+         
+         double ratioMin2;
+         double ratioMax2;
+         
+         template< class T >
+         bool check( T xA , T yA , T zA , T xB , T yB , T zB ) const {
+            
+            T rhoA2 = xA*xA + yA*yA;
+            T rhoB2 = xB*xB + yB*yB;
+            
+            T numerator = rhoA2 * zB*zB;
+            T denominator = rhoB2 * zA*zA;
+            
+            // like Crit2_StraightTrackRatio: pairs where the ratio can't be calculated are accepted
+            bool defined = ( rhoB2 > T( 0 ) ) & ( zB != T( 0 ) );
+            bool inRange = ( numerator <= T( ratioMax2 ) * denominator ) & ( numerator >= T( ratioMin2 ) * denominator );
+            
+            return ( !defined ) | inRange;
+            
+         }
+         
+      };
+      
+      BatchCrit2_StraightTrackRatio( float ratioMin , float ratioMax );
+      
+      virtual void filter( const HitPairBatch& batch , std::vector< char >& pass ) const;
+      
+      const Cuts& getCuts() const { return _cuts; }
+      
+      static const char* getCritName(){ return "Crit2_StraightTrackRatio"; }
+      
+   private:
+      
+      Cuts _cuts;
+      
+   };
+   
+   
+   /** Batch version of Crit2_DeltaPhi: the difference in phi of the hits in degrees.
+    * 
+    * Instead of calculating the angles, the dot product of the positions in the xy plane is compared to the
+    * cosines of the cut off values (calculated once). This gives the same window as |phiA - phiB| in [0,180],
+    * without atan2, so the loop can be vectorized.
+    */
+   class BatchCrit2_DeltaPhi : public IBatchCriterion{
+      
+   public:
+      
+      /** The cut off values and the check of one pair */
+      struct Cuts{
+         
+         double cosDeltaPhiMin;
+         double cosDeltaPhiMax;
+         bool zeroInWindow;
+         
+         template< class T >
+         bool check( T xA , T yA , T , T xB , T yB , T ) const {
+            
+            T rhoA2 = xA*xA + yA*yA;
+            T rhoB2 = xB*xB + yB*yB;
+            
+            // cos( deltaPhi ) * rhoA * rhoB
+            T dot = xA*xB + yA*yB;
+            T rhoAB = std::sqrt( rhoA2 * rhoB2 );
+            
+            bool inWindow = ( dot >= T( cosDeltaPhiMax ) * rhoAB ) & ( dot <= T( cosDeltaPhiMin ) * rhoAB );
+            
+            // like Crit2_DeltaPhi: a hit too close to the z axis has no phi, the difference is 0 then
+            bool nearAxis = ( rhoA2 < T( 0.0001 ) ) | ( rhoB2 < T( 0.0001 ) );
+            
+            return ( nearAxis & zeroInWindow ) | ( !nearAxis & inWindow );
+            
+         }
+         
+      };
+      
+      BatchCrit2_DeltaPhi( float deltaPhiMin , float deltaPhiMax );
+      
+      virtual void filter( const HitPairBatch& batch , std::vector< char >& pass ) const;
+      
+      const Cuts& getCuts() const { return _cuts; }
+      
+      static const char* getCritName(){ return "Crit2_DeltaPhi"; }
+      
+   private:
+      
+      Cuts _cuts;
+      
+   };
+   
+   
+   /** Runs any 2-hit ICriterion over a batch, one pair after the other. Pairs already rejected are skipped. 
+    * 
+    * For the criteria that have no batch version.
+    */
+   class BatchCriterionAdapter : public IBatchCriterion{
+      
+   public:
+      
+      /** @param criterion the criterion to use, it is not owned */
+      BatchCriterionAdapter( ICriterion* criterion );
+      
+      virtual void filter( const HitPairBatch& batch , std::vector< char >& pass ) const;
+      
+   private:
+      
+      ICriterion* _criterion;
+      
+   };
+   
+   
+   /** @return the batch version of the criterion with the passed name and cut off values. If there is none, 
+    * a BatchCriterionAdapter around the passed criterion.
+    */
+   IBatchCriterion* createBatchCriterion( const std::string& critName , float min , float max , ICriterion* criterion );
+   
+   
+   /** @return a FusedBatchCriterion for the passed 2-hit criteria, if there is a compiled one for exactly these criteria 
+    * (in any order), otherwise NULL.
+    * 
+    * @param critNames the names of the criteria
+    * 
+    * @param critMins the minimum of every criterion
+    * 
+    * @param critMaxs the maximum of every criterion
+    */
+   IBatchCriterion* createFusedBatchCriterion( const std::vector< std::string >& critNames, 
+                                               const std::vector< float >& critMins, 
+                                               const std::vector< float >& critMaxs );
+   
+   
+}
+
+
+#endif
+
@@ -0,0 +1,121 @@
+#ifndef BestFirstTrackExtractor_h
+#define BestFirstTrackExtractor_h
+
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+#include "KiTrack/Automaton.h"
+#include "KiTrack/Segment.h"
+#include "KiTrack/IHit.h"
+
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+
+
+   /** Extracts the raw tracks (vectors of hits) from an Automaton, like Automaton::getTracks(), but bounded.
+    *
+    * Automaton::getTracks() enumerates every path from the outermost segments down to the IP. With many crossing
+    * segments the number of paths grows combinatorially.
+    *
+    * Here every outermost segment (a segment without parents) is walked best first: the partial path with the
+    * lowest cost is always lengthened next. The cost is a cheap quality score from the geometry of the hits:
+    * the sum of ( 1 - cos(kink angle) ) over all hits, where the kink angle is the angle between the
+    * directions to the hit before and to the hit after. As the cost never decreases when a path gets longer,
+    * the paths come out ordered from the straightest to the most kinked one.
+    *
+    * At most pathsPerSegmentMax paths are kept per starting segment. Every starting segment that had more paths
+    * (with at least minHits real hits) counts as a hit of the limit.
+    *
+    * The paths can also be handed on one by one as they are found (extractTracks), so the work on them can start
+    * before the extraction is done and they don't have to be kept all at once.
+    */
+   class BestFirstTrackExtractor{
+
+
+   public:
+
+      /**
+       * @param pathsPerSegmentMax the maximum number of paths that are extracted from one starting segment
+       *
+       * @param minHits the minimum number of (real) hits a path needs to be returned
+       */
+      BestFirstTrackExtractor( unsigned pathsPerSegmentMax , unsigned minHits = 3 );
+
+
+      /** @return the raw tracks of the automaton, at most pathsPerSegmentMax per outermost segment
+       */
+      std::vector < std::vector< IHit* > > getTracks( Automaton& automaton );
+
+      /** Gets one raw track at a time (it may be moved from). Returning false stops the extraction. */
+      typedef std::function< bool( std::vector< IHit* >& ) > TrackConsumer;
+
+      /** Extracts the same raw tracks as getTracks in the same order, but passes each one to the consumer as soon as it is found.
+       */
+      void extractTracks( Automaton& automaton , const TrackConsumer& consumer );
+
+
+      /** @return the number of starting segments of the last call of getTracks */
+      unsigned getNStartSegments() const { return _nStartSegments; }
+
+      /** @return how many starting segments had more paths than allowed in the last call of getTracks */
+      unsigned getNLimitHit() const { return _nLimitHit; }
+
+
+   private:
+
+      /** A partial path: the hits so far (outer to inner, virtual hits included) and the segment it ends in */
+      struct PathNode{
+
+         double cost;
+         std::vector< IHit* > hits;
+         Segment* segment;
+
+      };
+
+      /** Orders the nodes in a priority queue, so that the cheapest one is on top */
+      struct PathNodeCompare{
+
+         bool operator()( const PathNode* a, const PathNode* b ) const { return a->cost > b->cost; }
+
+      };
+
+      /** Walks the paths of one starting segment best first and passes the found ones to the consumer.
+       *
+       * @return whether there were more paths than pathsPerSegmentMax
+       */
+      bool extractFromSegment( Segment* startSegment, const TrackConsumer& consumer );
+
+      /** @return whether a path with at least minHits real hits can still be made from the node */
+      bool canReachMinHits( const PathNode* node );
+
+      /** @return the most real hits a path can get below the outer hit of the segment (memoized in _nHitsBelow) */
+      unsigned getNHitsBelow( Segment* segment );
+
+      /** @return the cost added by appending hit c to a path ending in the hits a and b */
+      static double kinkCost( IHit* a, IHit* b, IHit* c );
+
+
+      unsigned _pathsPerSegmentMax;
+      unsigned _minHits;
+
+      unsigned _nStartSegments;
+      unsigned _nLimitHit;
+
+      /** whether the consumer stopped the extraction */
+      bool _stopped;
+
+      /** the results of getNHitsBelow for the segments of the automaton */
+      std::unordered_map< Segment* , unsigned > _nHitsBelow;
+
+
+   };
+
+
+}
+
+
+#endif
+
@@ -0,0 +1,104 @@
+#ifndef BoundedQueue_h
+#define BoundedQueue_h
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+
+namespace KiTrackMarlin{
+
+
+   /** A first in first out queue with a maximum size, to hand things from one thread to another.
+    *
+    * push blocks while the queue is full, so a fast producer can't run away from a slow consumer and the number
+    * of things waiting stays bounded. pop blocks while the queue is empty.
+    *
+    * When the producer is done (or either side has to give up) the queue gets closed: pushing fails from then on,
+    * what is still in the queue can be popped and after that pop fails.
+    */
+   template< class T >
+   class BoundedQueue{
+
+
+   public:
+
+      /** @param capacity the maximum number of elements in the queue, at least 1 */
+      BoundedQueue( unsigned capacity ): _capacity( capacity > 0 ? capacity : 1 ), _closed( false ){}
+
+      /** Adds an element, waits while the queue is full.
+       *
+       * @return false if the queue is closed, the element was not added then
+       */
+      bool push( T&& value ){
+
+         std::unique_lock< std::mutex > lock( _mutex );
+
+         _notFull.wait( lock, [ this ](){ return _closed || _queue.size() < _capacity; } );
+
+         if( _closed ) return false;
+
+         _queue.push_back( std::move( value ) );
+         _notEmpty.notify_one();
+
+         return true;
+
+      }
+
+      /** Takes the oldest element, waits while the queue is empty and not closed.
+       *
+       * @return false if the queue is closed and empty, value is unchanged then
+       */
+      bool pop( T& value ){
+
+         std::unique_lock< std::mutex > lock( _mutex );
+
+         _notEmpty.wait( lock, [ this ](){ return _closed || !_queue.empty(); } );
+
+         if( _queue.empty() ) return false;
+
+         value = std::move( _queue.front() );
+         _queue.pop_front();
+         _notFull.notify_one();
+
+         return true;
+
+      }
+
+      /** Closes the queue and wakes up everyone waiting */
+      void close(){
+
+         std::lock_guard< std::mutex > lock( _mutex );
+
+         _closed = true;
+         _notFull.notify_all();
+         _notEmpty.notify_all();
+
+      }
+
+      unsigned getCapacity() const { return _capacity; }
+
+
+   private:
+
+      BoundedQueue( const BoundedQueue& );
+      BoundedQueue& operator=( const BoundedQueue& );
+
+      const unsigned _capacity;
+
+      bool _closed;
+
+      std::deque< T > _queue;
+
+      std::mutex _mutex;
+      std::condition_variable _notFull;
+      std::condition_variable _notEmpty;
+
+   };
+
+
+}
+
+
+#endif
+
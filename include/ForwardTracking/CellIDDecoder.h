@@ -0,0 +1,100 @@
+#ifndef CellIDDecoder_h
+#define CellIDDecoder_h
+
+#include <string>
+#include <vector>
+
+#include "lcio.h"
+
+
+namespace KiTrackMarlin{
+   
+   
+   /** Decodes the fields of a cellID with shifts and masks.
+    * 
+    * UTIL::BitField64 parses the encoding string whenever it is constructed, which is expensive when done for every hit.
+    * Here the string is parsed once in the constructor and the offsets, widths and signs of the fields are kept. 
+    * Decoding is then only a shift and a mask. The decoder is not changed by decoding, so it can be shared.
+    * 
+    * The layer of a hit can be shifted by an offset per subdetector (see getLayerWithOffset), so that the layers of
+    * several subdetectors can be numbered consecutively.
+    */
+   class CellIDDecoder{
+      
+      
+   public:
+      
+      /** The position of a field in the cellID */
+      struct Field{
+         
+         unsigned offset;
+         unsigned width;
+         bool isSigned;
+         
+      };
+      
+      
+      /**
+       * @param encodingString the cellID encoding, e.g. UTIL::LCTrackerCellID::encoding_string(). It needs the fields 
+       * of LCTrackerCellID: subdet, side, layer, module and sensor.
+       * 
+       * @param layerOffsets the offset added to the layer for each subdetector (index = subdet). Subdetectors beyond 
+       * the end have offset 0.
+       */
+      CellIDDecoder( const std::string& encodingString, const std::vector< int >& layerOffsets = std::vector< int >() );
+      
+      
+      /** @return the field with the passed name (throws if it doesn't exist in the encoding) */
+      Field getField( const std::string& name ) const;
+      
+      /** @return the value of a field in the cellID */
+      static int getValue( lcio::long64 cellID, const Field& field ){
+         
+         unsigned long long value = ( (unsigned long long) cellID >> field.offset ) & ( ( 1ULL << field.width ) - 1 );
+         
+         if( field.isSigned && ( value & ( 1ULL << ( field.width - 1 ) ) ) ) return int( (long long) value - (long long)( 1ULL << field.width ) );
+         
+         return int( value );
+         
+      }
+      
+      int getSubdet( lcio::long64 cellID ) const { return getValue( cellID, _subdet ); }
+      int getSide( lcio::long64 cellID ) const { return getValue( cellID, _side ); }
+      int getLayer( lcio::long64 cellID ) const { return getValue( cellID, _layer ); }
+      int getModule( lcio::long64 cellID ) const { return getValue( cellID, _module ); }
+      int getSensor( lcio::long64 cellID ) const { return getValue( cellID, _sensor ); }
+      
+      /** @return the layer plus the offset of its subdetector */
+      int getLayerWithOffset( lcio::long64 cellID ) const {
+         
+         unsigned subdet = getSubdet( cellID );
+         int layer = getLayer( cellID );
+         
+         if( subdet < _layerOffsets.size() ) layer += _layerOffsets[ subdet ];
+         
+         return layer;
+         
+      }
+      
+      
+   private:
+      
+      std::string _encodingString;
+      
+      Field _subdet;
+      Field _side;
+      Field _layer;
+      Field _module;
+      Field _sensor;
+      
+      std::vector< int > _layerOffsets;
+      
+      
+   };
+   
+   
+}
+
+
+#endif
+
@@ -0,0 +1,104 @@
+#ifndef ClassifierCriterion_h
+#define ClassifierCriterion_h
+
+#include <vector>
+
+#include "Criteria/ICriterion.h"
+
+#include "SegmentClassifier.h"
+#include "IBatchCriterion.h"
+
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+
+
+   /** A criterion, that connects two segments if a SegmentClassifier gives them a score of at least its threshold.
+    *
+    * The features are calculated by the KiTrack criteria the classifier names, made with setSaveValues( true ).
+    * Their cut off values don't matter, only the values they calculate are used. A feature a criterion didn't
+    * calculate (e.g. for a virtual hit) is 0.
+    *
+    * The criterion can be used by several threads at once: every thread gets its own criteria for the features
+    * and its own buffer for them, kept in a thread_local cache (no locking). They are deleted when the thread ends.
+    */
+   class ClassifierCriterion : public ICriterion{
+
+
+   public:
+
+      /** @param classifier the classifier, it is not owned and has to live as long as the criterion */
+      ClassifierCriterion( const SegmentClassifier* classifier );
+
+      virtual bool areCompatible( Segment* parent , Segment* child );
+
+      /** Calculates the features of a pair of segments
+       *
+       * @param features set to the getNFeatures() features of the classifier
+       */
+      void getFeatures( Segment* parent , Segment* child , float* features );
+
+      const SegmentClassifier* getClassifier() const { return _classifier; }
+
+      virtual ~ClassifierCriterion();
+
+
+   private:
+
+      ClassifierCriterion( const ClassifierCriterion& );
+      ClassifierCriterion& operator=( const ClassifierCriterion& );
+
+      /** The criteria for the features and the buffer for the features of one thread */
+      struct FeatureCache{
+
+         FeatureCache(){}
+         ~FeatureCache(){ for( unsigned i=0; i < criteria.size(); i++ ) delete criteria[i]; }
+
+         std::vector< ICriterion* > criteria;
+         std::vector< float > features;
+
+      private:
+
+         FeatureCache( const FeatureCache& );
+         FeatureCache& operator=( const FeatureCache& );
+
+      };
+
+      /** @return the cache of the calling thread for this criterion, made at the first call */
+      FeatureCache& getFeatureCache();
+
+      const SegmentClassifier* _classifier;
+
+      /** Identifies the criterion in the caches of the threads (unlike the address it isn't reused) */
+      const unsigned long _id;
+
+   };
+
+
+   /** The ClassifierCriterion for batches of pairs of hits: the features of all pairs not rejected yet are
+    * calculated first and then scored by the classifier in one go.
+    */
+   class BatchClassifierCriterion : public IBatchCriterion{
+
+
+   public:
+
+      /** @param criterion the criterion to get the features and the classifier from, it is not owned */
+      BatchClassifierCriterion( ClassifierCriterion* criterion );
+
+      virtual void filter( const HitPairBatch& batch , std::vector< char >& pass ) const;
+
+
+   private:
+
+      ClassifierCriterion* _criterion;
+
+   };
+
+
+}
+
+
+#endif
+
@@ -0,0 +1,68 @@
+#ifndef CriteriaProfiler_h
+#define CriteriaProfiler_h
+
+#include <vector>
+#include <ostream>
+
+#include "CriteriaSet.h"
+#include "ProfiledCriterion.h"
+
+
+namespace KiTrackMarlin{
+   
+   
+   /** Learns the order in which the criteria of the automaton are best checked.
+    * 
+    * The automaton stops checking a connection at the first criterion that rejects it. So a criterion that
+    * rejects much and is fast should come early. Which ones these are depends on the criteria, their cut off
+    * values and the events, so it is measured:
+    * 
+    * - startProfiling() replaces every criterion of the sets by a ProfiledCriterion around it. 
+    * - During a warm-up the automaton runs with these and they count how often they reject and how long they take.
+    * - stopProfiling() puts the criteria back into the sets. In every vector they are ordered by the number of rejections
+    * per ns. Criteria that were never called (because the ones before rejected everything) keep their order after the others.
+    * 
+    * Afterwards the automaton runs on the criteria directly, without measuring. The measured values and the learned order
+    * can be printed with print().
+    */
+   class CriteriaProfiler{
+      
+      
+   public:
+      
+      CriteriaProfiler(){}
+      
+      /** Deletes the ProfiledCriteria (not the criteria they measure) */
+      ~CriteriaProfiler();
+      
+      
+      /** Replaces the criteria of the sets by ProfiledCriteria, the sets must not be deleted before stopProfiling() */
+      void startProfiling( std::vector< CriteriaSet >& criteriaSets );
+      
+      /** Puts the criteria back into the sets in the learned order */
+      void stopProfiling( std::vector< CriteriaSet >& criteriaSets );
+      
+      bool isProfiling() const { return _isProfiling; }
+      
+      /** Prints for every round and every type of criteria the criteria in the learned order with the values measured */
+      void print( std::ostream& os ) const;
+      
+      
+   private:
+      
+      CriteriaProfiler( const CriteriaProfiler& );
+      CriteriaProfiler& operator=( const CriteriaProfiler& );
+      
+      /** The ProfiledCriteria per round, 3 vectors (2, 3 and 4 hits) per round */
+      std::vector< std::vector< ProfiledCriterion* > > _profiledCriteria;
+      
+      bool _isProfiling=false;
+      
+   };
+   
+   
+}
+
+
+#endif
+
@@ -0,0 +1,79 @@
+#ifndef CriteriaSet_h
+#define CriteriaSet_h
+
+#include <vector>
+#include <map>
+#include <string>
+
+#include "Criteria/ICriterion.h"
+
+#include "IBatchCriterion.h"
+#include "SegmentClassifier.h"
+#include "ThetaBinnedCriterion.h"
+
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+   
+   
+   /** The criteria of one round of the automaton */
+   struct CriteriaSet{
+      
+      /** A vector of criteria for 2 hits (2 1-hit segments) */
+      std::vector< ICriterion* > crit2Vec;
+      
+      /** A vector of criteria for 3 hits (2 2-hit segments) */
+      std::vector< ICriterion* > crit3Vec;
+      
+      /** A vector of criteria for 4 hits (2 3-hit segments) */
+      std::vector< ICriterion* > crit4Vec;
+      
+      /** The criteria of crit2Vec, to check batches of pairs of hits (see createBatchCriterion). Can be a single
+       * compiled criterion for all of them (see createFusedBatchCriterion) */
+      std::vector< IBatchCriterion* > batch2Vec;
+      
+   };
+   
+   
+   /** Makes the criteria for all rounds of the automaton.
+    * 
+    * Every criterion can have a list of cut off values (for every min and every max), that are used one after the other
+    * in the rounds. There are as many rounds as the criterion with the most values has values. If there are no new cut 
+    * off values for a criterion in a round, its last one remains.
+    * 
+    * The criteria are made with Criteria::createCriterion, every criterion needs at least one min and one max.
+    * The 2-hit criteria get a batch version as well.
+    * 
+    * @param fuseBatchCriteria whether the batch versions of the 2-hit criteria are replaced by a single compiled one,
+    * if there is one for them (see createFusedBatchCriterion)
+    * 
+    * @param thetaCuts if not NULL, the criteria with a table there get their cut off values per theta division 
+    * (see ThetaCutTable and ThetaBinnedCriterion). A criterion with a table has at least as many rounds as its
+    * table has rows. Its 2-hit criteria are not fused.
+    * 
+    * @return a set of criteria for every round, to be deleted with deleteCriteriaSets
+    */
+   std::vector< CriteriaSet > makeCriteriaSets( const std::vector< std::string >& criteriaNames,
+                                                const std::map< std::string , std::vector< float > >& critMinima,
+                                                const std::map< std::string , std::vector< float > >& critMaxima,
+                                                bool fuseBatchCriteria = false,
+                                                const ThetaCutTable* thetaCuts = NULL );
+   
+   /** Adds a ClassifierCriterion for the classifier to every set, for the criteria with as many hits as the classifier.
+    * 
+    * For 2 hits a BatchClassifierCriterion is added to the batch criteria as well.
+    * 
+    * @param replaceCuts whether the classifier replaces the criteria (which are deleted), otherwise it is put in front of them
+    */
+   void addClassifierCriteria( std::vector< CriteriaSet >& criteriaSets , const SegmentClassifier* classifier , bool replaceCuts );
+   
+   /** Deletes all the criteria of the sets and clears them */
+   void deleteCriteriaSets( std::vector< CriteriaSet >& criteriaSets );
+   
+   
+}
+
+
+#endif
+
@@ -2,6 +2,7 @@
 #define EndcapHit01_h
 
 #include "IEndcapHit.h"
+#include "HitTable.h"
 
 
 using namespace lcio;
@@ -15,13 +16,28 @@ namespace KiTrackMarlin{
     * - Layer is set according to CellID0 +1 (so we can use layer 0 for the IP)
     * - Module is set according to CellID0.
     * - Sensor is set according to CellID0 -1. (because currently sensors of the VXD start with 1 in the CellID0, if this changes, this has to be modified)
+    * 
+    * The hit is a row of a HitTable: position, layer and sector are taken from the row, which must be
+    * complete when the hit is created. The table must live as long as the hit.
     */   
    class EndcapHit01 : public IEndcapHit{
       
       
    public:
       
-      EndcapHit01( TrackerHit* trackerHit , const SectorSystemEndcap* const sectorSystemEndcap );
+      EndcapHit01( const HitTable* const hitTable , unsigned row , const SectorSystemEndcap* const sectorSystemEndcap );
+      
+      /** @return the table holding the derived quantities (r, phi, cosTheta, ...) of this hit */
+      const HitTable* getHitTable() const { return _hitTable; }
+      
+      /** @return the row of this hit in the table */
+      unsigned getRow() const { return _row; }
+      
+      
+   private:
+      
+      const HitTable* _hitTable;
+      unsigned _row;
       
       
    };
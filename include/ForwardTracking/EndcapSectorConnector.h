@@ -1,9 +1,14 @@
 #ifndef EndcapSectorConnector_h
 #define EndcapSectorConnector_h
 
+#include <map>
+#include <vector>
+
 #include "KiTrack/ISectorConnector.h"
+#include "KiTrack/IHit.h"
 
 #include "SectorSystemEndcap.h"
+#include "SectorConnectionTable.h"
 
 
 
@@ -16,21 +21,73 @@ namespace KiTrackMarlin{
     * 
     * - going to layers on the inside (how far see constructor)
     * - jumping to the IP (from where see constructor)
+    * 
+    * Without layer z positions the targets are the sectors within +-8 divisions in phi (wrapping around at 2 pi) 
+    * and +-1 division in theta.
+    * 
+    * With the z positions of the layers, the field and a minimum pt, the windows are derived for every pair of 
+    * layers and every theta division: a track from the IP with the minimum pt turns by an angle proportional to
+    * the z distance it travels, so the phi window is as wide as the turn between the two layers (+1 division
+    * for the binning). The theta window covers the theta divisions the position of a straight track or of such a
+    * track can have on the inner layer (+-half a division). This works for theta divisions, that aren't uniform, as well.
+    * 
+    * The targets only depend on the geometry, so they are calculated for all sectors in the constructor and stored
+    * in a SectorConnectionTable. With the physics windows the targets of the fixed windows are stored in a second 
+    * table, for comparing the number of candidate pairs.
     */   
    class EndcapSectorConnector : public ISectorConnector{
       
       
    public:
       
-    EndcapSectorConnector ( const SectorSystemEndcap* sectorSystemEndcap , unsigned layerStepMax, unsigned lastLayerToIP ) ;
+      /**
+       * @param layerZ the z positions of the layers (index = layer, layer 0 is the IP). If empty, the fixed
+       * windows of +-8 in phi and +-1 in theta are used.
+       * 
+       * @param Bz the magnetic field in z in Tesla
+       * 
+       * @param ptMin the minimum transverse momentum in GeV of the tracks that shall be connected
+       */
+    EndcapSectorConnector ( const SectorSystemEndcap* sectorSystemEndcap , unsigned layerStepMax, unsigned lastLayerToIP,
+                            const std::vector< float >& layerZ = std::vector< float >(), double Bz = 0., double ptMin = 0. ) ;
       
       /** @return a set of all sectors that are connected to the passed sector */
       virtual std::set <int>  getTargetSectors ( int sector );
       
+      /** @return the precomputed targets of all sectors */
+      const SectorConnectionTable& getTable() const { return _table; }
+      
+      /** @return whether the windows are derived from the field, the layer z positions and the minimum pt */
+      bool usesPhysicsWindows() const { return _usePhysicsWindows; }
+      
+      /** @return the number of sector connections the fixed windows of +-8 in phi and +-1 in theta would have */
+      unsigned getNConnectionsFixedWindows() const { return _nConnectionsFixedWindows; }
+      
+      /** @return the number of pairs of hits that would be checked by the 2-hit criteria for the passed hits
+       * 
+       * @param fixedWindows whether to count with the fixed windows instead of the windows of this connector
+       */
+      unsigned long countCandidatePairs( const std::map< int , std::vector< IHit* > >& map_sector_hits, bool fixedWindows ) const;
+      
       virtual ~EndcapSectorConnector(){};
       
    private:
       
+      /** Calculates the targets of one sector from the geometry */
+      std::set <int> calculateTargetSectors ( int sector, bool fixedWindows ) const;
+      
+      /** Calculates the phi window and the theta divisions to look at in layerTarget for a sector in layer 
+       * and theta division iTheta */
+      void calculateWindow( int layer, int layerTarget, int iTheta, bool fixedWindows, 
+                            int& phiHalfWidth, int& iThetaLow, int& iThetaHigh ) const;
+      
+      /** @return the angle a track with the minimum pt has turned at |z| when its position there has tan(theta), 
+       * or a negative value if it can't get there */
+      double calculateTurningAngle( double z, double tanTheta ) const;
+      
+      /** @return the |cos(theta)| of the position at |zTarget| of the track that has |cos(theta)| = cosTheta at |z| */
+      double calculateCosThetaAt( double z, double zTarget, double cosTheta ) const;
+      
       const SectorSystemEndcap* _sectorSystemEndcap;
       
       unsigned _layerStepMax;
@@ -39,6 +96,19 @@ namespace KiTrackMarlin{
       unsigned _nDivisionsInPhi ;
       unsigned _nDivisionsInTheta ;      
       
+      std::vector< float > _layerZ;
+      bool _usePhysicsWindows;
+      
+      /** radius of the helix of a track with the minimum pt in mm */
+      double _radiusMin;
+      
+      unsigned _nConnectionsFixedWindows;
+      
+      SectorConnectionTable _table;
+      
+      /** the targets with the fixed windows, only filled if the physics windows are used */
+      SectorConnectionTable _tableFixedWindows;
+      
    };
    
    
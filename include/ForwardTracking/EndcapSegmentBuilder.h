@@ -0,0 +1,78 @@
+#ifndef EndcapSegmentBuilder_h
+#define EndcapSegmentBuilder_h
+
+#include <map>
+#include <vector>
+
+#include "KiTrack/IHit.h"
+#include "KiTrack/Automaton.h"
+
+#include "IBatchCriterion.h"
+#include "SectorConnectionTable.h"
+#include "GeometricAcceptanceTable.h"
+
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+   
+   
+   /** Builds the automaton with the 1-hit segments, like KiTrack's SegmentBuilder, but checks the 2-hit criteria in batches.
+    * 
+    * Every hit gets a 1-hit segment. Then for every hit all the hits in its target sectors are collected as pairs into 
+    * a HitPairBatch and every criterion runs once over the whole batch. The segments of the pairs that pass all criteria
+    * are connected (the outer hit is the parent).
+    * 
+    * With a GeometricAcceptanceTable the pairs, that can't come from a track above the minimum pt, are left out of
+    * the batch before any criterion runs. If the hits of the target sector are sorted by phi (sortHitsByPhi), only 
+    * the hits in the largest window in phi the table accepts are looked at, found with a binary search.
+    */
+   class EndcapSegmentBuilder{
+      
+      
+   public:
+      
+      /**
+       * @param map_sector_hits the hits per sector
+       * 
+       * @param connectionTable the target sectors of every sector
+       */
+      EndcapSegmentBuilder( const std::map< int , std::vector< IHit* > >& map_sector_hits , const SectorConnectionTable& connectionTable );
+      
+      /** Adds criteria, they are not owned */
+      void addCriteria( const std::vector< IBatchCriterion* >& criteria );
+      
+      /** Sets the table to reject pairs of hits with before the criteria, it is not owned. NULL = no table. 
+       * It has to be made for the same connection table. */
+      void setAcceptanceTable( const GeometricAcceptanceTable* acceptanceTable ){ _acceptanceTable = acceptanceTable; }
+      
+      /** @return the automaton with the connected 1-hit segments of all hits */
+      Automaton get1SegAutomaton();
+      
+      /** @return the number of pairs of hits checked by the criteria */
+      unsigned long getNPairsChecked() const { return _nPairsChecked; }
+      
+      /** @return the number of pairs of hits rejected by the acceptance table (not checked by the criteria) */
+      unsigned long getNPairsRejectedByAcceptance() const { return _nPairsRejectedByAcceptance; }
+      
+      
+   private:
+      
+      const std::map< int , std::vector< IHit* > >& _map_sector_hits;
+      const SectorConnectionTable& _connectionTable;
+      
+      std::vector< IBatchCriterion* > _criteria;
+      
+      const GeometricAcceptanceTable* _acceptanceTable;
+      
+      unsigned long _nPairsChecked;
+      unsigned long _nPairsRejectedByAcceptance;
+      
+   };
+   
+   
+}
+
+
+#endif
+
@@ -15,6 +15,11 @@
 #include "KiTrack/ITrack.h"
 #include "Criteria/Criteria.h"
 #include "ILDImpl/SectorSystemFTD.h"
+#include "SectorConnectionTable.h"
+#include "HitTableRegistry.h"
+#include "HitTimeFilter.h"
+#include "CriteriaSet.h"
+#include "CriteriaProfiler.h"
 
 using namespace lcio ;
 using namespace marlin ;
@@ -195,13 +200,13 @@ class ForwardTracking : public Processor {
    * 
    * @param map_sector_hits a map with first= the sector number. second = the hits in the sector. 
    * 
-   * @param secSysFTD the SectorSystemFTD that is used
+   * @param neighborPetalTable the table of the neighbouring petals of every sector
    * 
    * @param distMax the maximum distance of two hits. If two hits are on the right petals and their distance is smaller
    * than this, the connection will be saved in the returned map.
    */
    std::map< IHit* , std::vector< IHit* > > getOverlapConnectionMap( const std::map< int , std::vector< IHit* > > & map_sector_hits, 
-                                                                     const SectorSystemFTD* secSysFTD,
+                                                                     const SectorConnectionTable* neighborPetalTable,
                                                                      float distMax);
    
    /** Adds hits from overlapping areas to a RawTrack in every possible combination.
@@ -221,24 +226,6 @@ class ForwardTracking : public Processor {
    */
    void finaliseTrack( TrackImpl* trackImpl );
    
-   /** Sets the cut off values for all the criteria
-    * 
-    * This method is necessary for cases where the CA just finds too much.
-    * Therefore it is possible to enter a whole list of cut off values for every criterion (for every min and every max to be more precise),
-    * that are then used one after the other. 
-    * If the CA finds way too many connections, we can thus make the cuts tighter and rerun it. If there are still too many
-    * connections, just tighten them again.
-    * 
-    * This method will set the according values. It will read the passed (as steering parameter) cut off values, create
-    * criteria from them and store them in the corresponding vectors.
-    * 
-    * If there are no new cut off values for a criterion, the last one remains.
-    * 
-    * @return whether any new cut off value was set. false == there are no new cutoff values anymore
-    * 
-    * @param round The number of the round we are in. I.e. the nth time we run the Cellular Automaton.
-    */
-   bool setCriteria( unsigned round );
    
    
    /** @return Info on the content of _map_sector_hits. Says how many hits are in each sector */
@@ -273,6 +260,18 @@ class ForwardTracking : public Processor {
     * and the quality of the output track collection will be set to poor */
    int _maxHitsPerSector;
    
+   /** the lower ends of the time windows for hits, empty = no time filter */
+   FloatVec _hitTimeWindowMin;
+   
+   /** the upper ends of the time windows for hits */
+   FloatVec _hitTimeWindowMax;
+   
+   /** whether the time of flight from the IP is subtracted from the hit time */
+   bool _hitTimeCorrectTOF;
+   
+   /** drops hits out of the time windows, NULL if no windows are set */
+   HitTimeFilter* _hitTimeFilter;
+   
    
    // Properties for the Hopfield Neural Network
    double _HNN_Omega;
@@ -282,6 +281,9 @@ class ForwardTracking : public Processor {
    /** A map to store the hits according to their sectors */
    std::map< int , std::vector< IHit* > > _map_sector_hits;
    
+   /** The label of the HitTables filled by this processor: the layers and sectors depend on it, see HitTableRegistry */
+   std::string _hitTableLabel;
+   
    /** Names of the used criteria */
    std::vector< std::string > _criteriaNames;
    
@@ -294,18 +296,24 @@ class ForwardTracking : public Processor {
    /** Minimum number of hits a track has to have in order to be stored */
    int _hitsPerTrackMin;
    
-   /** A vector of criteria for 2 hits (2 1-hit segments) */
-   std::vector <ICriterion*> _crit2Vec;
+   /** The criteria for every round of the automaton (see makeCriteriaSets), made in init. Only their order changes after the warm-up */
+   std::vector< CriteriaSet > _criteriaSets;
    
-   /** A vector of criteria for 3 hits (2 2-hit segments) */
-   std::vector <ICriterion*> _crit3Vec;
+   /** the number of events the criteria are measured in before they are ordered by rejections per ns, 0 = steering file order */
+   int _criteriaWarmUpEvents;
    
-   /** A vector of criteria for 4 hits (2 3-hit segments) */
-   std::vector <ICriterion*> _crit4Vec;
+   /** measures the criteria during the warm-up and orders them afterwards */
+   CriteriaProfiler _criteriaProfiler;
    
    
    const SectorSystemFTD* _sectorSystemFTD;
    
+   /** The targets of the FTDSectorConnector for every sector, made in init */
+   SectorConnectionTable* _sectorConnectionTable;
+   
+   /** The targets of the FTDNeighborPetalSecCon for every sector, made in init */
+   SectorConnectionTable* _neighborPetalTable;
+   
    
    bool _useCED;
    
@@ -0,0 +1,119 @@
+#ifndef FusedBatchCriterion_h
+#define FusedBatchCriterion_h
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "BatchCriteria.h"
+
+
+namespace KiTrackMarlin{
+   
+   
+   /** The checks of all the cuts of a tuple, joined with & */
+   template< unsigned I , unsigned N >
+   struct FusedCheck{
+      
+      template< class Tuple , class T >
+      static bool check( const Tuple& crits , T xA , T yA , T zA , T xB , T yB , T zB ){
+         
+         return std::get< I >( crits ).check( xA, yA, zA, xB, yB, zB ) & FusedCheck< I+1 , N >::check( crits, xA, yA, zA, xB, yB, zB );
+         
+      }
+      
+   };
+   
+   template< unsigned N >
+   struct FusedCheck< N , N >{
+      
+      template< class Tuple , class T >
+      static bool check( const Tuple& , T , T , T , T , T , T ){ return true; }
+      
+   };
+   
+   
+   /** Several batch criteria compiled into one.
+    * 
+    * The criteria are fixed at compile time (Crits are batch criteria with Cuts, like BatchCrit2_RZRatio), so their
+    * checks are inlined into a single loop over the pairs: one pass over the batch instead of one per criterion,
+    * and no virtual calls.
+    * 
+    * The criteria are all evaluated for every pair, so their order doesn't matter.
+    */
+   template< class... Crits >
+   class FusedBatchCriterion : public IBatchCriterion{
+      
+      
+   public:
+      
+      /** The cut off values of all the criteria and the joined check of one pair */
+      struct Cuts{
+         
+         std::tuple< typename Crits::Cuts... > cuts;
+         
+         template< class T >
+         bool check( T xA , T yA , T zA , T xB , T yB , T zB ) const {
+            
+            return FusedCheck< 0 , sizeof...( Crits ) >::check( cuts, xA, yA, zA, xB, yB, zB );
+            
+         }
+         
+      };
+      
+      
+      FusedBatchCriterion( const Crits&... crits ){
+         
+         _cuts.cuts = std::make_tuple( crits.getCuts()... );
+         
+         const char* names[] = { Crits::getCritName()... };
+         
+         _name = "Fused(";
+         for( unsigned i=0; i < sizeof...( Crits ); i++ ) _name += std::string( i > 0 ? "," : "" ) + names[i];
+         _name += ")";
+         
+      }
+      
+      virtual void filter( const HitPairBatch& batch , std::vector< char >& pass ) const {
+         
+         filterBatchInPrecision( _cuts, batch, pass, _useFloat, _validator, _name );
+         
+      }
+      
+      
+   private:
+      
+      Cuts _cuts;
+      
+   };
+   
+   
+   /** @return a FusedBatchCriterion of the Crits with the cut off values of the map, if the map has exactly the criteria Crits 
+    * (first = name, second = min and max), otherwise NULL.
+    */
+   template< class... Crits >
+   IBatchCriterion* createFusedIfMatching( const std::map< std::string , std::pair< float , float > >& cuts ){
+      
+      
+      const char* names[] = { Crits::getCritName()... };
+      
+      if( cuts.size() != sizeof...( Crits ) ) return NULL;
+      
+      for( unsigned i=0; i < sizeof...( Crits ); i++ ){
+         
+         if( cuts.count( names[i] ) == 0 ) return NULL;
+         
+      }
+      
+      return new FusedBatchCriterion< Crits... >( Crits( cuts.at( Crits::getCritName() ).first, cuts.at( Crits::getCritName() ).second )... );
+      
+      
+   }
+   
+   
+}
+
+
+#endif
+
@@ -0,0 +1,107 @@
+#ifndef GeometricAcceptanceTable_h
+#define GeometricAcceptanceTable_h
+
+#include <vector>
+#include <cmath>
+
+#include "SectorSystemEndcap.h"
+#include "SectorConnectionTable.h"
+
+
+namespace KiTrackMarlin{
+
+
+   /** A precomputed table of the difference in phi, a track from the IP with a minimum pt can have between two hits
+    * in connected sectors.
+    *
+    * The position of a helix from the IP with radius R is at the distance r = 2 R sin( alpha / 2 ) from the z axis
+    * after turning by alpha, and its azimuth has turned by alpha / 2. So two hits of the track differ in phi by
+    * asin( rA / 2R ) - asin( rB / 2R ), which is largest for the smallest R. As asin is convex, this is at most
+    * slope * |rA - rB|, with the slope of asin( r / 2R ) at the largest r the two sectors can have.
+    *
+    * The largest r of a sector follows from the |z| of its layer and its theta division. For every connection of
+    * the SectorConnectionTable the table stores the slope, so a pair of hits is checked with one comparison:
+    *
+    * |deltaPhi| <= slope * |rA - rB| + phiTolerance
+    *
+    * The tolerance covers the spread of the vertex, multiple scattering and the thickness of the layers.
+    * Connections where a track with the minimum pt may curl (or to the IP) accept every pair.
+    *
+    * The table only depends on the geometry, it is made once and can be shared by several threads.
+    */
+   class GeometricAcceptanceTable{
+
+
+   public:
+
+      /**
+       * @param connectionTable the connections to make the table for, the order of the slopes is the order of its targets
+       *
+       * @param layerZ the |z| positions of the layers (index = layer, layer 0 is the IP)
+       *
+       * @param Bz the magnetic field in z in Tesla
+       *
+       * @param ptMin the minimum transverse momentum in GeV of the tracks, that have to be accepted
+       *
+       * @param phiTolerance the difference in phi, that is always accepted
+       */
+      GeometricAcceptanceTable( const SectorSystemEndcap* sectorSystemEndcap , const SectorConnectionTable& connectionTable ,
+                                const std::vector< float >& layerZ , double Bz , double ptMin , double phiTolerance );
+
+      /** @return a pointer to the slope of the first target of the sector. The slopes are in the order of
+       * SectorConnectionTable::getTargetsBegin(). A negative slope accepts every pair.
+       */
+      const float* getSlopesBegin( int sector ) const { return &_slopes[ _offsets[ sector ] ]; }
+
+      /** @return whether a pair of hits in a connection with the passed slope can come from a track above the minimum pt
+       *
+       * @param phiA, rhoA the azimuth and distance from the z axis of the outer hit
+       *
+       * @param phiB, rhoB the azimuth and distance from the z axis of the inner hit
+       */
+      bool isAccepted( float slope , float phiA , float rhoA , float phiB , float rhoB ) const {
+
+         float deltaPhi = std::fabs( phiA - phiB );
+         if( deltaPhi > float( M_PI ) ) deltaPhi = float( 2.*M_PI ) - deltaPhi;
+
+         return ( slope < 0.f ) || ( deltaPhi <= slope * std::fabs( rhoA - rhoB ) + _phiTolerance );
+
+      }
+
+      /** @return the largest difference in phi a connection with the passed (non negative) slope accepts for hits
+       * with a distance from the z axis of at most rhoMax. As |rhoA - rhoB| <= rhoMax, it is slope * rhoMax + phiTolerance.
+       */
+      float getPhiHalfWidth( float slope , float rhoMax ) const { return slope * rhoMax + _phiTolerance + 1e-6f; }
+
+      /** @return the number of connections, that don't accept every pair */
+      unsigned getNRestrictedConnections() const ;
+
+      float getPhiTolerance() const { return _phiTolerance; }
+
+
+   private:
+
+      /** @return the largest distance from the z axis a hit in the sector can have, or a negative value if it is unbounded */
+      double calculateRhoMax( int sector , const std::vector< float >& layerZ ) const ;
+
+      const SectorSystemEndcap* _sectorSystemEndcap;
+
+      /** the radius of the helix of a track with the minimum pt in mm */
+      double _radiusMin;
+
+      float _phiTolerance;
+
+      /** The position of the slope of the first target of sector i in _slopes. Has one entry more than there are sectors. */
+      std::vector< unsigned > _offsets;
+
+      /** The slopes of all connections, one sector after the other */
+      std::vector< float > _slopes;
+
+   };
+
+
+}
+
+
+#endif
+
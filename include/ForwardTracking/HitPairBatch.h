@@ -0,0 +1,76 @@
+#ifndef HitPairBatch_h
+#define HitPairBatch_h
+
+#include <vector>
+
+#include "KiTrack/IHit.h"
+#include "KiTrack/Segment.h"
+
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+   
+   
+   /** Pairs of hits to be checked by the 2-hit criteria, in structure of arrays form.
+    * 
+    * Hit a is the outer hit (the parent), hit b the inner one (the child), like in ICriterion::areCompatible.
+    * The positions are stored in one array per coordinate, so a criterion can run over all pairs in a simple 
+    * loop the compiler can vectorize. The 1-hit segments of the hits are kept as well, for the criteria that
+    * can only check a pair of segments and for connecting the segments of the accepted pairs, and so are the
+    * sectors of the hits, for the criteria that depend on where the hits are.
+    */
+   struct HitPairBatch{
+      
+      std::vector< float > xA;
+      std::vector< float > yA;
+      std::vector< float > zA;
+      
+      std::vector< float > xB;
+      std::vector< float > yB;
+      std::vector< float > zB;
+      
+      std::vector< Segment* > segA;
+      std::vector< Segment* > segB;
+      
+      std::vector< int > sectorA;
+      std::vector< int > sectorB;
+      
+      
+      void add( IHit* a , Segment* segmentA , IHit* b , Segment* segmentB ){
+         
+         xA.push_back( a->getX() );
+         yA.push_back( a->getY() );
+         zA.push_back( a->getZ() );
+         
+         xB.push_back( b->getX() );
+         yB.push_back( b->getY() );
+         zB.push_back( b->getZ() );
+         
+         segA.push_back( segmentA );
+         segB.push_back( segmentB );
+         
+         sectorA.push_back( a->getSector() );
+         sectorB.push_back( b->getSector() );
+         
+      }
+      
+      void clear(){
+         
+         xA.clear(); yA.clear(); zA.clear();
+         xB.clear(); yB.clear(); zB.clear();
+         segA.clear(); segB.clear();
+         sectorA.clear(); sectorB.clear();
+         
+      }
+      
+      unsigned size() const { return segA.size(); }
+      
+   };
+   
+   
+}
+
+
+#endif
+
@@ -0,0 +1,59 @@
+#ifndef HitProximityGrid_h
+#define HitProximityGrid_h
+
+#include <vector>
+#include <unordered_map>
+
+#include "KiTrack/IHit.h"
+
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+
+
+   /** Finds out quickly, whether a hit close to a position was already added.
+    *
+    * The hits are put into cubic cells with the edge length distMax. A hit closer than distMax to a position
+    * is in the cell of the position or in one of its 26 neighbours, so only these hits are compared instead of
+    * all hits of the sector.
+    */
+   class HitProximityGrid{
+
+
+   public:
+
+      /** @param distMax hits closer than this count as close, > 0 */
+      HitProximityGrid( double distMax );
+
+      /** Takes out all hits (for the next event) */
+      void clear(){ _cells.clear(); }
+
+      void add( IHit* hit );
+
+      /** @return whether a hit of the sector closer than distMax to the position was added */
+      bool hasCloseHit( double x , double y , double z , int sector ) const ;
+
+      double getDistMax() const { return _distMax; }
+
+
+   private:
+
+      /** @return the index of the cell along one axis */
+      long long getCellIndex( double coordinate ) const ;
+
+      /** @return the key of the cell with the passed indices. Cells far apart may share a key, this only costs time. */
+      static long long getCellKey( long long ix , long long iy , long long iz );
+
+      double _distMax;
+
+      std::unordered_map< long long , std::vector< IHit* > > _cells;
+
+   };
+
+
+}
+
+
+#endif
+
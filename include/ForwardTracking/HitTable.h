@@ -0,0 +1,100 @@
+#ifndef HitTable_h
+#define HitTable_h
+
+#include <vector>
+
+#include "EVENT/TrackerHit.h"
+#include "lcio.h"
+
+
+using namespace lcio;
+
+namespace KiTrackMarlin{
+
+
+   /** A per event table of the hits of the input collections, stored as structure of arrays.
+    *
+    * Every TrackerHit is read in once and gets a row with its position and the quantities derived from it:
+    * the transverse radius r and 1/r, the azimuth phi in [0, 2pi) and cos(theta) (with theta measured from
+    * the IP). The layer and the sector depend on the geometry of the processor and are filled in by it
+    * with setLayer() and setSector() after the row was added.
+    *
+    * Every quantity lies in a contiguous array of its own, so loops over one quantity of many hits read
+    * memory linearly. Hit objects refer to their row by index, see EndcapHit01.
+    */
+   class HitTable{
+
+
+   public:
+
+      HitTable(){}
+
+      /** Removes all rows (but keeps the allocated memory for the next event) */
+      void clear();
+
+      /** Reserves memory for nRows rows */
+      void reserve( unsigned nRows );
+
+      /** Adds a row for the TrackerHit and calculates its derived quantities. Layer and sector are set to -1.
+       *
+       * @return the index of the new row
+       */
+      unsigned addHit( TrackerHit* trackerHit );
+
+      /** Replaces the rows by those of the other table, but with layer and sector set to -1. This saves
+       * calculating the derived quantities again, when layers and sectors are wanted in another sector system.
+       */
+      void copyRows( const HitTable& other );
+
+      void setLayer( unsigned row , int layer ){ _layer[ row ] = layer; }
+      void setSector( unsigned row , int sector ){ _sector[ row ] = sector; }
+
+
+      /** @return the number of rows */
+      unsigned size() const { return _trackerHit.size(); }
+
+      bool empty() const { return _trackerHit.empty(); }
+
+
+      double getX( unsigned row ) const { return _x[ row ]; }
+      double getY( unsigned row ) const { return _y[ row ]; }
+      double getZ( unsigned row ) const { return _z[ row ]; }
+
+      /** @return the transverse radius */
+      double getR( unsigned row ) const { return _r[ row ]; }
+
+      /** @return 1/r, or 0 for a hit on the z axis */
+      double getInvR( unsigned row ) const { return _invR[ row ]; }
+
+      /** @return the azimuth in [0, 2pi) */
+      double getPhi( unsigned row ) const { return _phi[ row ]; }
+
+      double getCosTheta( unsigned row ) const { return _cosTheta[ row ]; }
+
+      int getLayer( unsigned row ) const { return _layer[ row ]; }
+      int getSector( unsigned row ) const { return _sector[ row ]; }
+
+      TrackerHit* getTrackerHit( unsigned row ) const { return _trackerHit[ row ]; }
+
+
+   private:
+
+      std::vector< double > _x;
+      std::vector< double > _y;
+      std::vector< double > _z;
+      std::vector< double > _r;
+      std::vector< double > _invR;
+      std::vector< double > _phi;
+      std::vector< double > _cosTheta;
+      std::vector< int > _layer;
+      std::vector< int > _sector;
+      std::vector< TrackerHit* > _trackerHit;
+
+   };
+
+
+}
+
+
+#endif
+
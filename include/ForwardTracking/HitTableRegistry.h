@@ -0,0 +1,79 @@
+#ifndef HitTableRegistry_h
+#define HitTableRegistry_h
+
+#include <string>
+#include <map>
+#include <utility>
+
+#include "lcio.h"
+#include "EVENT/LCEvent.h"
+#include "LCRTRelations.h"
+
+#include "HitTable.h"
+
+
+using namespace lcio;
+
+namespace KiTrackMarlin{
+
+
+   /** The HitTables of one event, shared by all processors of a Marlin job.
+    *
+    * The registry is attached to the LCEvent as a runtime extension (see getRegistry()) and is deleted together
+    * with the event. A table is made for one input collection and is labelled with the way its layers and sectors
+    * were calculated (the sector system and the layer numbering of the processor that filled them). A processor
+    * that calculates layers and sectors the same way reuses the table as it is. A processor with another label gets
+    * its own table, but the positions and the quantities derived from them are copied from the table that is
+    * already there, so only layers and sectors are calculated again.
+    */
+   class HitTableRegistry{
+
+
+   public:
+
+      HitTableRegistry(){}
+
+      ~HitTableRegistry();
+
+
+      /** @return the registry of the event, it is created if the event has none yet */
+      static HitTableRegistry* getRegistry( LCEvent* evt );
+
+
+      /** @return the table of the collection with the passed label, or NULL if there is none */
+      HitTable* getTable( const std::string& colName , const std::string& label ) const;
+
+      /** Creates a new table for the collection with the passed label.
+       *
+       * If there is already a table of the collection with another label, its rows are copied (without layers and
+       * sectors). Otherwise the table is empty and has to be filled by the caller. If the table exists already,
+       * it is returned as it is.
+       *
+       * The registry owns the table.
+       */
+      HitTable* createTable( const std::string& colName , const std::string& label );
+
+      /** @return the number of tables in the registry */
+      unsigned getNTables() const { return _tables.size(); }
+
+
+   private:
+
+      HitTableRegistry( const HitTableRegistry& );
+      HitTableRegistry& operator=( const HitTableRegistry& );
+
+      /** The tables by ( collection name, label ) */
+      std::map< std::pair< std::string , std::string > , HitTable* > _tables;
+
+   };
+
+
+   /** The runtime extension of the LCEvent holding the HitTableRegistry */
+   struct HitTableRegistryExtension : LCOwnedExtension< HitTableRegistryExtension , HitTableRegistry > {};
+
+
+}
+
+
+#endif
+
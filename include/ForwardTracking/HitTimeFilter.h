@@ -0,0 +1,68 @@
+#ifndef HitTimeFilter_h
+#define HitTimeFilter_h
+
+#include <vector>
+
+
+namespace KiTrackMarlin{
+
+
+   /** Accepts hits whose time lies in a window, to drop out-of-time background before it enters the track search.
+    *
+    * The window can be the same for all layers or given per layer. Optionally the time of flight of a particle
+    * coming from the IP at the speed of light (distance / c) is subtracted from the time of the hit first, so the
+    * windows of all layers can be centered around 0.
+    *
+    * The filter counts the accepted and rejected hits per layer.
+    */
+   class HitTimeFilter{
+
+
+   public:
+
+      /**
+       * @param timeMin the lower ends of the windows in ns: either one value for all layers or one per layer
+       *
+       * @param timeMax the upper ends of the windows in ns, like timeMin
+       *
+       * @param correctTOF whether the time of flight from the IP is subtracted from the hit time
+       */
+      HitTimeFilter( const std::vector< float >& timeMin , const std::vector< float >& timeMax , bool correctTOF );
+
+
+      /** @return whether the hit is in time. Layers without a window of their own use the last window given.
+       *
+       * @param time the time of the hit in ns
+       *
+       * @param distance the distance of the hit from the IP in mm
+       */
+      bool accept( double time , double distance , int layer );
+
+
+      /** @return the (time of flight corrected, if chosen) time of the hit */
+      double getCorrectedTime( double time , double distance ) const;
+
+      unsigned long getNAccepted( int layer ) const;
+      unsigned long getNRejected( int layer ) const;
+
+      /** @return the number of layers with counted hits */
+      unsigned getNLayers() const { return _nAccepted.size(); }
+
+
+   private:
+
+      std::vector< float > _timeMin;
+      std::vector< float > _timeMax;
+      bool _correctTOF;
+
+      std::vector< unsigned long > _nAccepted;
+      std::vector< unsigned long > _nRejected;
+
+   };
+
+
+}
+
+
+#endif
+
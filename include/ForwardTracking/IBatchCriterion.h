@@ -0,0 +1,65 @@
+#ifndef IBatchCriterion_h
+#define IBatchCriterion_h
+
+#include <vector>
+#include <string>
+
+#include "HitPairBatch.h"
+#include "PrecisionValidator.h"
+
+
+namespace KiTrackMarlin{
+   
+   
+   /** A 2-hit criterion, that checks a whole batch of pairs of hits at once instead of one pair per (virtual) call.
+    * 
+    * The result is a pass mask with one entry per pair. A criterion only sets entries to 0 (rejected), so several
+    * criteria can be run one after the other on the same mask.
+    * 
+    * filter() must not change the criterion, so one criterion can be used by several threads.
+    * 
+    * Criteria with a calculation of their own can do it in single (float) or double precision (setPrecision()).
+    * The positions of the batch are floats in both cases, only the arithmetic differs.
+    */
+   class IBatchCriterion{
+      
+      
+   public:
+      
+      /** Sets the entries of the pairs the criterion rejects to 0.
+       * 
+       * @param pass the pass mask, it has as many entries as the batch has pairs
+       */
+      virtual void filter( const HitPairBatch& batch , std::vector< char >& pass ) const = 0;
+      
+      const std::string& getName() const { return _name; }
+      
+      /** Sets the precision of the calculation. 
+       * 
+       * @param useFloat whether the calculation is done in float instead of double precision
+       * 
+       * @param validator if not NULL, the calculation is done in both precisions and the decisions are compared
+       * there. The pairs are still decided by the precision chosen with useFloat. The validator is not owned.
+       */
+      virtual void setPrecision( bool useFloat , PrecisionValidator* validator = NULL ){ _useFloat = useFloat; _validator = validator; }
+      
+      bool usesFloat() const { return _useFloat; }
+      
+      virtual ~IBatchCriterion(){}
+      
+      
+   protected:
+      
+      std::string _name;
+      
+      bool _useFloat=false;
+      PrecisionValidator* _validator=NULL;
+      
+   };
+   
+   
+}
+
+
+#endif
+
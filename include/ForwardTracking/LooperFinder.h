@@ -0,0 +1,69 @@
+#ifndef LooperFinder_h
+#define LooperFinder_h
+
+#include <map>
+#include <vector>
+
+#include "KiTrack/IHit.h"
+
+#include "SectorSystemEndcap.h"
+
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+
+
+   /** Finds clusters of hits as left by low pt curlers (loopers), before the track search.
+    *
+    * A curler leaves many hits close to each other in phi and theta, on several layers. This is looked for
+    * per sector:
+    *
+    * - A sector is dense, if it and its 8 neighbours in phi and theta (on the same layer) have together at
+    * least minHits hits.
+    * - A column of sectors (same phi and theta, all layers) is looper-like, if at least minLayers of its sectors
+    * are dense.
+    *
+    * The hits of the dense sectors of looper-like columns are taken out of the track search, so they don't
+    * blow up the number of connections. They can be searched for tracks on their own afterwards.
+    *
+    * The sectors of layer 0 (the IP) are never touched.
+    */
+   class LooperFinder{
+
+
+   public:
+
+      /**
+       * @param minHits the minimum number of hits in a sector and its neighbours for the sector to be dense
+       *
+       * @param minLayers the minimum number of dense sectors in a column to be looper-like
+       */
+      LooperFinder( const SectorSystemEndcap* sectorSystemEndcap , unsigned minHits , unsigned minLayers );
+
+
+      /** Moves the hits of the looper-like clusters from map_sector_hits to map_sector_loopers.
+       *
+       * @return the number of moved hits
+       */
+      unsigned maskLoopers( std::map< int , std::vector< IHit* > >& map_sector_hits ,
+                            std::map< int , std::vector< IHit* > >& map_sector_loopers ) const;
+
+
+   private:
+
+      /** @return the number of hits in the sector and its neighbours in phi and theta */
+      unsigned countHitsAround( int sector , const std::map< int , std::vector< IHit* > >& map_sector_hits ) const;
+
+      const SectorSystemEndcap* _sectorSystemEndcap;
+      unsigned _minHits;
+      unsigned _minLayers;
+
+   };
+
+
+}
+
+
+#endif
+
@@ -0,0 +1,44 @@
+#ifndef PhiSortedHits_h
+#define PhiSortedHits_h
+
+#include <map>
+#include <vector>
+#include <utility>
+#include <cmath>
+
+#include "KiTrack/IHit.h"
+
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+   
+   
+   /** @return the azimuth of the hit in [-pi, pi], the order the hits of a sector are sorted in */
+   inline float getHitPhi( IHit* hit ){ return std::atan2( hit->getY(), hit->getX() ); }
+   
+   /** Sorts the hits of every sector by getHitPhi, so the hits within a window in phi can be found with a binary
+    * search (see findPhiRanges) instead of looking at every hit of the sector.
+    */
+   void sortHitsByPhi( std::map< int , std::vector< IHit* > >& map_sector_hits );
+   
+   /** Positions [first, second) in a vector */
+   typedef std::pair< unsigned , unsigned > IndexRange;
+   
+   /** Finds the positions of the phis within halfWidth of phi, going around at +-pi.
+    * 
+    * @param phis sorted ascending, in [-pi, pi]
+    * 
+    * @param ranges set to the ranges of positions: one range, or two where the window goes around at +-pi.
+    * With a halfWidth of pi or more it is one range with all positions.
+    * 
+    * @return the number of ranges
+    */
+   unsigned findPhiRanges( const std::vector< float >& phis , float phi , float halfWidth , IndexRange ranges[2] );
+   
+   
+}
+
+
+#endif
+
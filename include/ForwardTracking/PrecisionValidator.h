@@ -0,0 +1,87 @@
+#ifndef PrecisionValidator_h
+#define PrecisionValidator_h
+
+#include <map>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <ostream>
+
+
+namespace KiTrackMarlin{
+
+
+   /** Collects the decisions of checks that were made both in single (float) and in double precision.
+    *
+    * The checks with a float path (the batch criteria and the SegmentPredictionCriterion) can run both paths
+    * side by side. They report here how many decisions they made and how many of them differed between the
+    * two paths. The first few differing decisions of every check are kept with a description, so they can be
+    * looked at.
+    *
+    * The checks can be run by several threads, record() and addExample() can be called concurrently.
+    */
+   class PrecisionValidator{
+
+
+   public:
+
+      /** @param maxExamples the number of differing decisions kept with their description per check */
+      PrecisionValidator( unsigned maxExamples = 10 ): _maxExamples( maxExamples ){}
+
+
+      /** Adds decisions of a check
+       *
+       * @param checkName the name of the check (e.g. of the criterion)
+       *
+       * @param nDecisions the number of decisions made in both precisions
+       *
+       * @param nDiffering the number of them that were different
+       */
+      void record( const std::string& checkName , unsigned long nDecisions , unsigned long nDiffering );
+
+      /** Keeps the description of a differing decision, if the check doesn't have maxExamples yet */
+      void addExample( const std::string& checkName , const std::string& description );
+
+      /** @return whether more examples are kept for the check */
+      bool wantsExample( const std::string& checkName );
+
+      /** @return the number of decisions of the check made in both precisions */
+      unsigned long getNDecisions( const std::string& checkName ) const;
+
+      /** @return the number of differing decisions of the check */
+      unsigned long getNDiffering( const std::string& checkName ) const;
+
+      /** @return the number of differing decisions of all checks */
+      unsigned long getNDiffering() const;
+
+      /** Forgets all decisions */
+      void clear();
+
+      /** Prints for every check the number of decisions and of differing ones, and the examples kept */
+      void print( std::ostream& os ) const;
+
+
+   private:
+
+      struct Decisions{
+
+         unsigned long nDecisions=0;
+         unsigned long nDiffering=0;
+         std::vector< std::string > examples;
+
+      };
+
+      unsigned _maxExamples;
+
+      std::map< std::string , Decisions > _decisions;
+
+      mutable std::mutex _mutex;
+
+   };
+
+
+}
+
+
+#endif
+
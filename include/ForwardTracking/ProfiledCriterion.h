@@ -0,0 +1,70 @@
+#ifndef ProfiledCriterion_h
+#define ProfiledCriterion_h
+
+#include <atomic>
+
+#include "Criteria/ICriterion.h"
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+   
+   
+   /** A criterion that passes the check on to another criterion and measures it: how often it is called, how often
+    * it rejects and how long it takes.
+    * 
+    * The counters are atomic, so the same ProfiledCriterion can be used by several threads at once.
+    * 
+    * Reading the clock takes longer than many criteria, so only every _timingInterval-th call is timed (all calls
+    * are counted) and the time of reading the clock, measured once, is taken off the measured time.
+    */
+   class ProfiledCriterion : public ICriterion{
+      
+      
+   public:
+      
+      /** @param criterion the criterion to measure, it is not owned */
+      ProfiledCriterion( ICriterion* criterion );
+      
+      virtual bool areCompatible( Segment* parent , Segment* child );
+      
+      virtual ~ProfiledCriterion(){};
+      
+      /** @return the measured criterion */
+      ICriterion* getCriterion() const { return _criterion; }
+      
+      unsigned long getNCalls() const { return _nCalls; }
+      unsigned long getNRejected() const { return _nRejected; }
+      
+      /** @return the number of calls, that were timed */
+      unsigned long getNTimedCalls() const { return _nTimedCalls; }
+      
+      /** @return the mean time of a call in ns without the reading of the clock, at least 1 ns. 0 if no call was timed. */
+      double getTimePerCall() const;
+      
+      /** @return the number of rejections per ns spent in the criterion, 0 if it wasn't called */
+      double getRejectionPerTime() const;
+      
+      /** @return the time in ns it takes to read the clock before and after a call */
+      static double getClockOverhead();
+      
+      
+   private:
+      
+      /** the first call and then every _timingInterval-th one is timed */
+      static const unsigned _timingInterval;
+      
+      ICriterion* _criterion;
+      
+      std::atomic< unsigned long > _nCalls;
+      std::atomic< unsigned long > _nRejected;
+      std::atomic< unsigned long > _nTimedCalls;
+      std::atomic< unsigned long long > _time;
+      
+      
+   };
+   
+}
+
+#endif
+
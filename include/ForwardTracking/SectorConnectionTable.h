@@ -0,0 +1,89 @@
+#ifndef SectorConnectionTable_h
+#define SectorConnectionTable_h
+
+#include <vector>
+#include <set>
+
+#include "KiTrack/ISectorConnector.h"
+
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+
+
+   /** A precomputed adjacency table of sectors.
+    *
+    * The target sectors of all sectors are stored once in compressed sparse row form: one flat array of
+    * target sectors and an offset per sector into it. Looking up the targets of a sector is then O(1) and
+    * does not allocate.
+    *
+    * The table can be filled from any ISectorConnector (it asks the connector once for every sector) or
+    * sector by sector with appendSector(). It is an ISectorConnector itself, so it can be handed to a
+    * SegmentBuilder in place of the connector it was made from.
+    *
+    * The table is not changed by lookups, so it can be shared by several threads.
+    */
+   class SectorConnectionTable : public ISectorConnector{
+
+
+   public:
+
+      /** An empty table, fill it with appendSector() */
+      SectorConnectionTable();
+
+      /** Asks the connector for the target sectors of the sectors 0 to nSectors-1 and stores them.
+       *
+       * @param connector the sector connector to tabulate
+       *
+       * @param nSectors the number of sectors of the sector system
+       */
+      SectorConnectionTable( ISectorConnector* connector , unsigned nSectors );
+
+
+      /** Adds the targets of the next sector (the sector number is the number of sectors added before) */
+      void appendSector( const std::set< int >& targetSectors );
+
+
+      /** @return a pointer to the first target sector of the passed sector. Together with getTargetsEnd()
+       * this gives the (sorted) targets without allocating. Sectors outside the table have no targets.
+       */
+      const int* getTargetsBegin( int sector ) const;
+
+      /** @return a pointer behind the last target sector of the passed sector */
+      const int* getTargetsEnd( int sector ) const;
+
+      /** @return the number of target sectors of the passed sector */
+      unsigned getNTargets( int sector ) const;
+
+      /** @return the number of sectors in the table */
+      unsigned getNSectors() const { return _offsets.size() - 1; }
+
+      /** @return the total number of connections stored in the table */
+      unsigned getNConnections() const { return _targets.size(); }
+
+
+      /** @return a set of all sectors that are connected to the passed sector */
+      virtual std::set <int>  getTargetSectors ( int sector );
+
+      virtual ~SectorConnectionTable(){};
+
+
+   private:
+
+      bool isInTable( int sector ) const { return ( sector >= 0 ) && ( unsigned( sector ) + 1 < _offsets.size() ); }
+
+      /** Position of the first target of sector i in _targets. Has one entry more than there are sectors. */
+      std::vector< unsigned > _offsets;
+
+      /** The target sectors of all sectors, one after the other */
+      std::vector< int > _targets;
+
+   };
+
+
+}
+
+
+#endif
+
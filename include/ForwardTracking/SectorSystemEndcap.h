@@ -7,6 +7,8 @@
 #include "KiTrack/ISectorSystem.h"
 
 #include <vector>
+#include <atomic>
+#include <cmath>
 
 using namespace KiTrack;
 
@@ -24,6 +26,8 @@ namespace KiTrackMarlin{
     * 
     * @param sensor: the sensor on the module
     * 
+    * The divisions in theta are uniform in cos(theta) from -1 to 1, or have boundaries of their own (e.g. from
+    * ThetaOccupancyProfile::suggestBoundaries), so that dense regions get narrower divisions.
     * 
     */ 
    class SectorSystemEndcap : public ISectorSystem{
@@ -41,17 +45,27 @@ namespace KiTrackMarlin{
        * @param nSensors the number of sensors on one module.
        */
     SectorSystemEndcap( unsigned nLayers , unsigned nDivisionsInPhi , unsigned nDivisionsInTheta );
+    
+      /** Constructor for divisions in theta, that aren't uniform
+       * 
+       * @param cosThetaBoundaries the boundaries of the theta divisions in cos(theta): one more than there are divisions, 
+       * strictly increasing from -1 to 1. Throws std::invalid_argument otherwise.
+       */
+    SectorSystemEndcap( unsigned nLayers , unsigned nDivisionsInPhi , const std::vector< double >& cosThetaBoundaries );
       
 
       /** Virtual, because this method is demanded by the Interface ISectorSystem
        * 
        * @return the layer corresponding to the passed sector number
        */
-      virtual unsigned getLayer( int sector ) const ;
+      virtual unsigned getLayer( int sector ) const noexcept ;
       
-      virtual unsigned getPhi( int sector ) const ;
+      virtual unsigned getPhi( int sector ) const noexcept ;
 
-      virtual unsigned getTheta( int sector ) const ;
+      virtual unsigned getTheta( int sector ) const noexcept ;
+      
+      /** Decodes layer, phi and theta division of a sector at once */
+      void decodeSector( int sector, unsigned& layer, unsigned& phi, unsigned& theta ) const noexcept ;
 
       /** @return some information on the sector as string */
       virtual std::string getInfoOnSector( int sector) const;
@@ -63,9 +77,37 @@ namespace KiTrackMarlin{
 
       int getSector( int layer, double phi, double cosTheta ) const ;
       
+      /** Like getSector( int layer, double phi, double cosTheta ), but for the hot path of making hits: it doesn't throw.
+       * Values out of range are clamped to the nearest valid layer or division and counted (see getNOutOfRange).
+       */
+      int getSectorClamped( int layer, double phi, double cosTheta ) const noexcept ;
+      
+      /** @return the number of times getSectorClamped had to clamp */
+      unsigned long getNOutOfRange() const { return _nOutOfRange; }
+      
+      void resetNOutOfRange() { _nOutOfRange = 0; }
+      
       unsigned getPhiSectors() const ;
 
       unsigned getThetaSectors() const ;
+      
+      /** @return whether the theta divisions are uniform in cos(theta) */
+      bool hasUniformTheta() const { return _uniformTheta; }
+      
+      /** @return the boundaries of the theta divisions in cos(theta), from -1 to 1 */
+      const std::vector< double >& getCosThetaBoundaries() const { return _cosThetaBoundaries; }
+      
+      /** @return the lower boundary in cos(theta) of the theta division */
+      double getCosThetaLow( unsigned theta ) const { return _cosThetaBoundaries[ theta ]; }
+      
+      /** @return the upper boundary in cos(theta) of the theta division */
+      double getCosThetaHigh( unsigned theta ) const { return _cosThetaBoundaries[ theta + 1 ]; }
+      
+      /** @return the position of cos(theta) in units of theta divisions: the integer part is the division, the 
+       * fraction the position within it (linear in cos(theta)). Outside of -1 to 1 the first or last division 
+       * is continued, so the position is < 0 or >= getThetaSectors() there.
+       */
+      double getThetaPosition( double cosTheta ) const noexcept ;
 
       unsigned getNLayers() const ;
 
@@ -78,8 +120,71 @@ namespace KiTrackMarlin{
       unsigned _nDivisionsInPhi ;
       unsigned _nDivisionsInTheta ;
       
+      /** the number of sectors per theta division */
+      unsigned _nLayersTimesPhi ;
+      
+      /** divisions per radian in phi and per unit of cos(theta) */
+      double _phiScale ;
+      double _cosThetaScale ;
+      
+      bool _uniformTheta ;
+      std::vector< double > _cosThetaBoundaries ;
+      
+      /** For divisions that aren't uniform: the theta division at the lower edge of every cell of a fine uniform 
+       * grid in cos(theta), so the division of a cos(theta) is found with a lookup and a few steps. */
+      std::vector< unsigned > _thetaLookup ;
+      double _thetaLookupScale ;
+      
+      mutable std::atomic< unsigned long > _nOutOfRange ;
+      
       void checkSectorIsInRange( int sector ) const ;
       
+      void init( unsigned nLayers , unsigned nDivisionsInPhi , unsigned nDivisionsInTheta );
+      
+   };
+   
+   
+   
+   /** The sector encoding of SectorSystemEndcap for division counts fixed at compile time. 
+    * 
+    * All methods are constexpr and the divisions in the decoding are by constants, so the compiler can replace them.
+    * Gives the same sectors as a SectorSystemEndcap( NLayers, NDivisionsInPhi, NDivisionsInTheta ), so the theta
+    * divisions are uniform.
+    */
+   template< unsigned NLayers, unsigned NDivisionsInPhi, unsigned NDivisionsInTheta >
+   struct SectorEncodingEndcap{
+      
+      static constexpr int getSector( int layer, int phi, int theta ) noexcept {
+         return layer + int( NLayers )*phi + int( NLayers*NDivisionsInPhi )*theta ;
+      }
+      
+      /** Clamps out of range values like SectorSystemEndcap::getSectorClamped (but doesn't count them) */
+      static constexpr int getSectorClamped( int layer, double phi, double cosTheta ) noexcept {
+         return getSector( clamp( layer, NLayers ), clamp( phi * ( NDivisionsInPhi / ( 2*M_PI ) ), NDivisionsInPhi ), 
+                           clamp( ( cosTheta + 1. ) * ( NDivisionsInTheta / 2. ), NDivisionsInTheta ) );
+      }
+      
+      /** @return whether getSectorClamped would not need to clamp */
+      static constexpr bool isInRange( int layer, double phi, double cosTheta ) noexcept {
+         return ( layer >= 0 ) && ( layer < int( NLayers ) )
+             && isInRange( phi * ( NDivisionsInPhi / ( 2*M_PI ) ), NDivisionsInPhi ) 
+             && isInRange( ( cosTheta + 1. ) * ( NDivisionsInTheta / 2. ), NDivisionsInTheta );
+      }
+      
+      static constexpr unsigned getLayer( int sector ) noexcept { return unsigned( sector ) % NLayers; }
+      
+      static constexpr unsigned getPhi( int sector ) noexcept { return ( unsigned( sector ) / NLayers ) % NDivisionsInPhi; }
+      
+      static constexpr unsigned getTheta( int sector ) noexcept { return unsigned( sector ) / ( NLayers*NDivisionsInPhi ); }
+      
+   private:
+      
+      static constexpr int clamp( int i, unsigned n ) noexcept { return ( i < 0 ) ? 0 : ( ( i >= int( n ) ) ? int( n ) - 1 : i ); }
+      
+      static constexpr int clamp( double x, unsigned n ) noexcept { return !( x >= 0. ) ? 0 : ( ( x >= n ) ? int( n ) - 1 : int( x ) ); }
+      
+      static constexpr bool isInRange( double x, unsigned n ) noexcept { return ( x >= 0. ) && ( x < n ); }
+      
    };
 
 
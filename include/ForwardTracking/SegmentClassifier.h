@@ -0,0 +1,221 @@
+#ifndef SegmentClassifier_h
+#define SegmentClassifier_h
+
+#include <string>
+#include <vector>
+
+
+namespace KiTrackMarlin{
+
+
+   /** A classifier trained offline, that tells from the values of the criteria for two segments whether to connect them.
+    *
+    * Instead of a window (min and max) for every value of the criteria on its own, the values of several criteria
+    * (the features) are combined into one score. A connection is kept if the score is at least the threshold.
+    *
+    * The features are values calculated by KiTrack criteria, with the names they have in their map of values
+    * (ICriterion::getMapOfValues()). These are the names of the branches of the trees written by the
+    * TrueTrackCritAnalyser, so a classifier can be trained on its ROOT output.
+    *
+    * The classifiers are read from plain text files with readFile(). Lines starting with # are comments.
+    * A file starts with the type and the header, each a keyword followed by its values on one line:
+    *
+    * @verbatim
+      classifier MLP                               (or BDT)
+      hits 3                                       (the number of hits the classifier is for: 2, 3 or 4)
+      threshold 0.5                                (connections with a lower score are dropped)
+      criteria Crit3_ChangeRZRatio Crit3_3DAngle   (the criteria that calculate the features)
+      features Crit3_ChangeRZRatio Crit3_3DAngle   (the names of the values used, in the order of the model)
+      @endverbatim
+    *
+    * and the model follows, see MLPSegmentClassifier and BDTSegmentClassifier.
+    */
+   class SegmentClassifier{
+
+
+   public:
+
+      /** Reads a classifier from a file.
+       *
+       * @return the classifier, to be deleted by the caller
+       *
+       * @throws std::runtime_error, if the file can't be read or isn't a valid classifier
+       */
+      static SegmentClassifier* readFile( const std::string& fileName );
+
+
+      /** Scores a batch of pairs of segments.
+       *
+       * @param features the features of all pairs: getNFeatures() values per pair, one pair after the other
+       *
+       * @param nPairs the number of pairs
+       *
+       * @param scores set to the score of every pair, must have room for nPairs values
+       */
+      virtual void score( const float* features , unsigned nPairs , float* scores ) const = 0;
+
+      /** @return the score of a single pair */
+      float score( const std::vector< float >& features ) const;
+
+      /** @return the number of hits of the connections the classifier is for (2, 3 or 4) */
+      unsigned getNHits() const { return _nHits; }
+
+      float getThreshold() const { return _threshold; }
+
+      /** @return the names of the KiTrack criteria, that calculate the features */
+      const std::vector< std::string >& getCriteriaNames() const { return _criteriaNames; }
+
+      /** @return the names of the features, as in the maps of values of the criteria */
+      const std::vector< std::string >& getFeatureNames() const { return _featureNames; }
+
+      unsigned getNFeatures() const { return _featureNames.size(); }
+
+      /** @return the type of the classifier: MLP or BDT */
+      virtual std::string getType() const = 0;
+
+      virtual ~SegmentClassifier(){}
+
+
+   protected:
+
+      SegmentClassifier( unsigned nHits , float threshold , const std::vector< std::string >& criteriaNames ,
+                         const std::vector< std::string >& featureNames );
+
+      unsigned _nHits;
+      float _threshold;
+      std::vector< std::string > _criteriaNames;
+      std::vector< std::string > _featureNames;
+
+   };
+
+
+   /** A multilayer perceptron.
+    *
+    * The features are first normalised, x' = ( x - offset ) * scale, then passed through the layers. Every layer
+    * calculates out = activation( weights * in + biases ). The score is the (only) output of the last layer.
+    *
+    * In the file the header is followed by
+    *
+    * @verbatim
+      offsets 0.98 1.2      (optional, one per feature, default 0)
+      scales 10 0.5         (optional, one per feature, default 1)
+      layer 8 2 relu        (the number of outputs and inputs and the activation: linear, relu, tanh or sigmoid)
+      ...                   (nOut * nIn weights, row by row (one output after the other), then nOut biases)
+      layer 1 8 sigmoid
+      ...
+      @endverbatim
+    *
+    * The numbers after a layer line can be spread over any number of lines.
+    */
+   class MLPSegmentClassifier : public SegmentClassifier{
+
+
+   public:
+
+      enum Activation{ LINEAR , RELU , TANH , SIGMOID };
+
+      /** A layer of the perceptron */
+      struct Layer{
+
+         unsigned nIn;
+         unsigned nOut;
+         Activation activation;
+
+         /** nOut * nIn weights, the ones of output 0 first */
+         std::vector< float > weights;
+
+         /** one per output */
+         std::vector< float > biases;
+
+      };
+
+      /**
+       * @param offsets the offsets of the features for the normalisation, empty = 0 for all
+       *
+       * @param scales the scales of the features for the normalisation, empty = 1 for all
+       *
+       * @param layers the layers, the first one has as many inputs as there are features and the last one a single output
+       *
+       * @throws std::invalid_argument, if the sizes don't fit
+       */
+      MLPSegmentClassifier( unsigned nHits , float threshold , const std::vector< std::string >& criteriaNames ,
+                            const std::vector< std::string >& featureNames ,
+                            const std::vector< float >& offsets , const std::vector< float >& scales ,
+                            const std::vector< Layer >& layers );
+
+      virtual void score( const float* features , unsigned nPairs , float* scores ) const;
+
+      using SegmentClassifier::score;
+
+      virtual std::string getType() const { return "MLP"; }
+
+
+   private:
+
+      std::vector< float > _offsets;
+      std::vector< float > _scales;
+      std::vector< Layer > _layers;
+
+   };
+
+
+   /** Boosted decision trees.
+    *
+    * The score is the sum of the values of the leaves the features lead to in all the trees. In a tree every node
+    * either has a cut on a feature (go to the left child if the feature is below the cut, else to the right one)
+    * or is a leaf with a value. Node 0 is the root, the children of a node come after it.
+    *
+    * In the file the header is followed by the trees:
+    *
+    * @verbatim
+      tree 3                (the number of nodes)
+      0 1.5 1 2 0           (one node per line: feature, cut, left, right, value. Feature -1 = a leaf, only the value is used)
+      -1 0 0 0 -0.8
+      -1 0 0 0 0.6
+      tree ...
+      @endverbatim
+    */
+   class BDTSegmentClassifier : public SegmentClassifier{
+
+
+   public:
+
+      /** A node of a tree */
+      struct Node{
+
+         /** the index of the feature, -1 for a leaf */
+         int feature;
+         float cut;
+         unsigned left;
+         unsigned right;
+         float value;
+
+      };
+
+      typedef std::vector< Node > Tree;
+
+      /**
+       * @throws std::invalid_argument, if a tree is empty or a node has a feature that doesn't exist or a child that doesn't come after it
+       */
+      BDTSegmentClassifier( unsigned nHits , float threshold , const std::vector< std::string >& criteriaNames ,
+                            const std::vector< std::string >& featureNames , const std::vector< Tree >& trees );
+
+      virtual void score( const float* features , unsigned nPairs , float* scores ) const;
+
+      using SegmentClassifier::score;
+
+      virtual std::string getType() const { return "BDT"; }
+
+
+   private:
+
+      std::vector< Tree > _trees;
+
+   };
+
+
+}
+
+
+#endif
+
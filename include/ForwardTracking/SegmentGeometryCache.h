@@ -0,0 +1,114 @@
+#ifndef SegmentGeometryCache_h
+#define SegmentGeometryCache_h
+
+#include <unordered_map>
+
+#include "KiTrack/Segment.h"
+
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+   
+   
+   /** Quantities of a segment that criteria need again and again, calculated once per segment.
+    * 
+    * The hits of a segment are ordered from the inside out, hit 0 is the innermost one.
+    */
+   struct SegmentGeometry{
+      
+      /** the number of hits of the segment */
+      unsigned nHits;
+      
+      /** the position of the innermost hit */
+      double xInner;
+      double yInner;
+      double zInner;
+      
+      /** whether the innermost hit is virtual (the IP) */
+      bool innerIsVirtual;
+      
+      /** phi of the innermost hit */
+      double phiInner;
+      
+      /** cos(theta) of the innermost hit */
+      double cosThetaInner;
+      
+      
+      /** The circle through the two innermost hits b (hit 0) and c (hit 1) and a third point: the third hit for
+       * segments with 3 hits and the IP for segments with 2 hits. Not set for other segments. */
+      bool hasCircle;
+      
+      /** whether the three points are on a straight line, the circle is not set then */
+      bool isLine;
+      
+      double xCentre;
+      double yCentre;
+      double radius;
+      
+      /** the angle of hit b around the centre */
+      double psiB;
+      
+      /** the angle from hit c to hit b around the centre, in (-pi,pi] */
+      double deltaPsi;
+      
+      /** the position of the hits b and c */
+      double xb;
+      double yb;
+      double zb;
+      double xc;
+      double yc;
+      double zc;
+      
+   };
+   
+   
+   /** A cache of the SegmentGeometry of segments.
+    * 
+    * In the automaton every segment is checked against all its possible partners, so criteria that calculate
+    * the same thing from one of the segments do it many times. With the cache the geometry of a segment is 
+    * calculated on the first request and read afterwards.
+    * 
+    * The segments are identified by their address: the cache has to be cleared before segments it has seen get deleted
+    * (for the automaton: before every lengthenSegments()).
+    * 
+    * Every thread has its own cache (getThreadCache()), so criteria shared by several threads can use it.
+    */
+   class SegmentGeometryCache{
+      
+      
+   public:
+      
+      /** @return the geometry of the segment, calculated if it isn't in the cache yet. The reference stays valid until clear() */
+      const SegmentGeometry& getGeometry( Segment* segment );
+      
+      /** Forgets all segments */
+      void clear(){ _geometries.clear(); }
+      
+      /** @return the number of segments in the cache */
+      unsigned getNSegments() const { return _geometries.size(); }
+      
+      /** @return the number of requests answered from the cache since it was made */
+      unsigned long getNReused() const { return _nReused; }
+      
+      /** @return the cache of the calling thread */
+      static SegmentGeometryCache& getThreadCache();
+      
+      
+   private:
+      
+      /** Calculates the geometry of a segment */
+      static void calculateGeometry( Segment* segment , SegmentGeometry& geometry );
+      
+      std::unordered_map< Segment* , SegmentGeometry > _geometries;
+      
+      unsigned long _nReused=0;
+      
+   };
+   
+   
+}
+
+
+#endif
+
@@ -0,0 +1,88 @@
+#ifndef SegmentPredictionCriterion_h
+#define SegmentPredictionCriterion_h
+
+
+#include "Criteria/ICriterion.h"
+
+#include "SegmentGeometryCache.h"
+#include "PrecisionValidator.h"
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+   
+   
+   /** A criterion for lengthening segments: the outer hits of a segment predict where its next hit on the inside
+    * has to be.
+    * 
+    * For 3 hits (2 2-hit segments) the helix through the IP and the two outer hits is used, for 4 hits
+    * (2 3-hit segments) the helix through the three outer hits. The helix is followed to the z of the inner hit
+    * and the inner hit has to be within a window in phi and cos(theta) around the predicted position.
+    * 
+    * The prediction is cheap compared to most other criteria. When it is put first into the criteria of the
+    * automaton, the other criteria only get evaluated for the hits within the predicted window.
+    * 
+    * Connections to the (virtual) IP hit are always accepted.
+    * 
+    * The circle of a parent segment is taken from the SegmentGeometryCache of the thread, so it is calculated once
+    * and not for every child. The cache has to be cleared before the automaton lengthens its segments.
+    * 
+    * The prediction can be calculated in single (float) instead of double precision, see setPrecision(). The circle
+    * of the cache stays in double, only the prediction of every pair of segments is done in float then.
+    */
+   class SegmentPredictionCriterion : public ICriterion{
+      
+      
+   public:
+      
+      /**
+       * @param nHits the number of hits the criterion is for: 3 or 4
+       * 
+       * @param phiWindowMax the maximum difference in phi between the predicted and the real hit
+       * 
+       * @param cosThetaWindowMax the maximum difference in cos(theta) between the predicted and the real hit
+       */
+      SegmentPredictionCriterion( unsigned nHits, float phiWindowMax, float cosThetaWindowMax );
+      
+      virtual bool areCompatible( Segment* parent , Segment* child );
+      
+      /** Sets the precision of the prediction.
+       * 
+       * @param useFloat whether the prediction is calculated in float instead of double precision
+       * 
+       * @param validator if not NULL, the prediction is calculated in both precisions and the decisions are compared
+       * there (under the name SegmentPrediction3Hit or SegmentPrediction4Hit). The segments are still decided by the 
+       * precision chosen with useFloat. The validator is not owned.
+       */
+      void setPrecision( bool useFloat , PrecisionValidator* validator = NULL ){ _useFloat = useFloat; _validator = validator; }
+      
+      virtual ~SegmentPredictionCriterion(){};
+      
+      
+   private:
+      
+      /** Predicts the inner hit of the child from the parent in precision T.
+       * 
+       * @param deltaPhi set to the difference in phi between the predicted and the real hit
+       * 
+       * @param deltaCosTheta set to the difference in cos(theta) between the predicted and the real hit
+       * 
+       * @return whether the hit is within the windows
+       */
+      template< class T >
+      bool isInWindow( const SegmentGeometry& parentGeometry , const SegmentGeometry& childGeometry , double& deltaPhi , double& deltaCosTheta ) const;
+      
+      unsigned _nHits;
+      float _phiWindowMax;
+      float _cosThetaWindowMax;
+      
+      bool _useFloat;
+      PrecisionValidator* _validator;
+      
+      
+   };
+   
+}
+
+#endif
+
@@ -12,11 +12,25 @@
 
 #include "KiTrack/Segment.h"
 #include "KiTrack/ITrack.h"
+#include "KiTrack/Automaton.h"
 #include "Criteria/Criteria.h"
 #include "ILDImpl/SectorSystemFTD.h"
 #include "ILDImpl/SectorSystemVXD.h"
 #include "SectorSystemEndcap.h"
+#include "ThetaOccupancyProfile.h"
+#include "EndcapSectorConnector.h"
+#include "GeometricAcceptanceTable.h"
+#include "CellIDDecoder.h"
+#include "HitTableRegistry.h"
+#include "HitTimeFilter.h"
+#include "HitProximityGrid.h"
+#include "LooperFinder.h"
 #include "EndcapHitSimple.h"
+#include "CriteriaSet.h"
+#include "CriteriaProfiler.h"
+#include "PrecisionValidator.h"
+#include "SegmentClassifier.h"
+#include "BestFirstTrackExtractor.h"
 
 
 using namespace lcio ;
@@ -98,6 +112,51 @@ typedef std::vector< IHit* > RawTrack;
  * If there are no further new values for the criteria, the event will be skipped.<br>
  * (default value 100000 )
  * 
+ * @param MaxPathsPerSegment If > 0, the raw tracks are not all taken from the automaton, but extracted best first
+ * (straightest paths first) from every outermost segment, keeping at most this many per segment. This bounds the number
+ * of track candidates that need to be fitted. How often the limit was hit is reported at the end.<br>
+ * (default value 0, i.e. all paths are taken)
+ * 
+ * @param StreamRawTracks If true (and MaxPathsPerSegment > 0), segment building, automaton and the extraction of the
+ * raw tracks run in a second thread, while the processor fits the raw tracks already extracted. Not used with
+ * NPhiWedges > 1, nor with debug output or CED drawing (they are not thread-safe).<br>
+ * (default value false)
+ * 
+ * @param RawTrackQueueSize The maximum number of raw tracks waiting for the fit with StreamRawTracks. The extraction
+ * waits when it is reached.<br>
+ * (default value 1000)
+ * 
+ * @param NPhiWedges If > 1, the detector is split into this many wedges in phi. Segment building and automaton run
+ * independently for every wedge in a thread of its own (not with debug output or CED drawing, which are not thread-safe).
+ * The raw tracks of all wedges are fitted afterwards in the processor's thread.<br>
+ * (default value 1)
+ * 
+ * @param PhiWedgeHalo The number of phi divisions a wedge reaches into its neighbours, so that tracks crossing the borders
+ * of the wedges are still found. A track is kept only by the wedge whose core holds its outermost hit. A wedge together 
+ * with the halo on both sides must not be larger than the whole circle.<br>
+ * (default value 8)
+ * 
+ * @param LayerZPositions The |z| positions of the layers in mm, one per layer, starting with the IP (layer 0). If set,
+ * the phi and theta windows of the sector connector are derived for every pair of layers from the field and ConnectionPtMin
+ * instead of the fixed +-8 phi and +-1 theta divisions. How many candidate pairs of hits this saves is reported at the end.<br>
+ * (default value empty, i.e. fixed windows)
+ * 
+ * @param ConnectionPtMin The minimum transverse momentum in GeV of the tracks the sector connector shall connect, if 
+ * LayerZPositions are set.<br>
+ * (default value 0.1)
+ * 
+ * @param SubdetLayerOffsets The offset added to the layer from the cellID of a hit for every subdetector (index = subdet),
+ * so that the layers of all subdetectors are numbered consecutively.<br>
+ * (default value 0 0 0 6 6 8 8)
+ * 
+ * @param PredictionPhiWindow If > 0, lengthening a segment uses its outer hits to predict the next hit on the inside (see
+ * SegmentPredictionCriterion): only hits within this window in phi (rad) and PredictionCosThetaWindow in cos(theta) are
+ * passed on to the 3-hit and 4-hit criteria.<br>
+ * (default value 0, i.e. no prediction)
+ * 
+ * @param PredictionCosThetaWindow The window in cos(theta) around the predicted hit.<br>
+ * (default value 0.05)
+ * 
  * @param MaxHitsPerSector If on any single sector there are more hits than this, all the hits in the sector get dropped.
  * This is to prevent combinatorial breakdown (It is a second safety mechanism, the first one being MaxConnectionsAutomaton.
  * But if there are soooo many hits, that already the first round of the Cellular Automaton would take forever, this mechanism
@@ -212,6 +271,98 @@ class SiliconEndcapTracking : public Processor {
                                                                      const SectorSystemEndcap* secSysEndcap,
                                                                      float distMax);
    
+   /** Counters of one search for track candidates. They are summed up into the members of the processor
+    * afterwards, so that searches in different phi wedges can run in parallel. */
+   struct CandidateSearchStats{
+      
+      unsigned nTrackCandidates=0;
+      unsigned nTrackCandidatesPlus=0;
+      unsigned nExtractionStartSegments=0;
+      unsigned nExtractionLimitHit=0;
+      unsigned long nPairsChecked=0;
+      unsigned long nPairsRejectedByAcceptance=0;
+      
+   };
+   
+   /** Runs the SegmentBuilder and the Cellular Automaton on the passed hits, fits the resulting track candidates
+    * and returns the ones surviving the helix and Kalman fit cuts.
+    * 
+    * @param map_sector_hits the hits (including the virtual IP hit) sorted by sectors
+    * 
+    * @param map_hitFront_hitsBack the hits from overlapping petals, see getOverlapConnectionMap
+    * 
+    * @param trkSystem the tracking system used for fitting the candidates
+    * 
+    * @param firstRound the round of the criteria to start with (later rounds follow if there are too many connections)
+    * 
+    * @param stats counters to be increased
+    */
+   std::vector< ITrack* > findTrackCandidates( std::map< int , std::vector< IHit* > >& map_sector_hits,
+                                               std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                               MarlinTrk::IMarlinTrkSystem* trkSystem,
+                                               unsigned firstRound,
+                                               CandidateSearchStats& stats );
+   
+   /** Adds the hits from overlapping petals to a raw track, fits the versions and adds the ones surviving the helix 
+    * and Kalman fit cuts (or only the best one with TakeBestVersionOfTrack) to trackCandidates.
+    */
+   void addTrackCandidates( const RawTrack& rawTrack,
+                            std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                            MarlinTrk::IMarlinTrkSystem* trkSystem,
+                            std::vector< ITrack* >& trackCandidates,
+                            CandidateSearchStats& stats );
+   
+   /** Runs the SegmentBuilder and the Cellular Automaton on the passed hits (with later rounds of the criteria if there 
+    * are too many connections) and passes every raw track of the automaton to the consumer. Doesn't fit anything.
+    */
+   void findRawTracks( std::map< int , std::vector< IHit* > >& map_sector_hits,
+                       unsigned firstRound,
+                       CandidateSearchStats& stats,
+                       const BestFirstTrackExtractor::TrackConsumer& consumer );
+   
+   /** Like findTrackCandidates, but findRawTracks runs in a worker thread and hands every raw track through a BoundedQueue
+    * of RawTrackQueueSize to the calling thread, which fits it with addTrackCandidates. So the fit starts with the first raw 
+    * track, the raw tracks are never all in memory and the fit stays in the calling thread.
+    */
+   std::vector< ITrack* > streamTrackCandidates( std::map< int , std::vector< IHit* > >& map_sector_hits,
+                                                 std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                                 MarlinTrk::IMarlinTrkSystem* trkSystem,
+                                                 unsigned firstRound,
+                                                 CandidateSearchStats& stats );
+   
+   /** @return whether work may be done in more than one thread: not with CED drawing or with debug output */
+   bool canRunInThreads() const ;
+   
+   /** Splits _map_sector_hits into _nPhiWedges wedges in phi (plus a halo of _phiWedgeHalo phi divisions on either side)
+    * and runs findRawTracks for every wedge in its own thread. Raw tracks found in the halo of a wedge are dropped, they 
+    * belong to the wedge holding their outermost hit in its core. The others are then fitted in the calling thread 
+    * with _trkSystem, one after the other.
+    */
+   std::vector< ITrack* > findTrackCandidatesInPhiWedges( std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                                          unsigned firstRound,
+                                                          CandidateSearchStats& stats );
+   
+   /** @return the best subset of compatible tracks of the candidates (according to BestSubsetFinder). The rejected candidates are deleted. */
+   std::vector< ITrack* > getBestSubset( std::vector< ITrack* >& trackCandidates );
+   
+   /** Removes the (real) hits of the tracks from the sectors and from the connections of overlapping hits,
+    * so a following pass only sees the hits that are still free.
+    * 
+    * @return the number of removed hits
+    */
+   unsigned removeHitsOfTracks( const std::vector< ITrack* >& tracks,
+                                std::map< int , std::vector< IHit* > >& map_sector_hits,
+                                std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack );
+   
+   /** Adds the counters of a search for track candidates to the ones summed over all events */
+   void countCandidateSearch( const CandidateSearchStats& stats );
+   
+   /** @return whether a hit closer than _duplicateHitDistMax to the hit in the row is already in its sector of _map_sector_hits */
+   bool isDuplicateHit( const HitTable* hitTable, unsigned row );
+   
+   /** @return whether the phi division iPhi is in the wedge, or at most halo phi divisions away from it */
+   bool isInPhiWedge( unsigned iPhi, unsigned wedge, unsigned halo ) const ;
+   
    /** Adds hits from overlapping areas to a RawTrack in every possible combination.
    * 
    * @return all of the resulting RawTracks
@@ -229,24 +380,24 @@ class SiliconEndcapTracking : public Processor {
    */
    void finaliseTrack( TrackImpl* trackImpl );
    
-   /** Sets the cut off values for all the criteria
+   /** @return the automaton with the 1-hit segments of the hits, connected where the 2-hit criteria of the round accept them.
+    * Uses the EndcapSegmentBuilder with the batch criteria, or KiTrack's SegmentBuilder if BatchSegmentBuilding is off.
+    */
+   Automaton get1SegAutomaton( std::map< int , std::vector< IHit* > >& map_sector_hits, const CriteriaSet& criteria,
+                               CandidateSearchStats& stats );
+   
+   /** Makes the criteria for all rounds
     * 
-    * This method is necessary for cases where the CA just finds too much.
+    * This is necessary for cases where the CA just finds too much.
     * Therefore it is possible to enter a whole list of cut off values for every criterion (for every min and every max to be more precise),
     * that are then used one after the other. 
     * If the CA finds way too many connections, we can thus make the cuts tighter and rerun it. If there are still too many
     * connections, just tighten them again.
     * 
-    * This method will set the according values. It will read the passed (as steering parameter) cut off values, create
-    * criteria from them and store them in the corresponding vectors.
-    * 
-    * If there are no new cut off values for a criterion, the last one remains.
-    * 
-    * @return whether any new cut off value was set. false == there are no new cutoff values anymore
-    * 
-    * @param round The number of the round we are in. I.e. the nth time we run the Cellular Automaton.
+    * This method reads the passed (as steering parameter) cut off values once and stores a set of criteria for every
+    * round in _criteriaSets (see makeCriteriaSets), with the segment prediction in front if it is used.
     */
-   bool setCriteria( unsigned round );
+   void buildCriteriaSets();
   
    // void getCellID0Info(TrackerHit*& trackerHit );
    void getCellID0Info(LCCollection*& col );
@@ -271,6 +422,18 @@ class SiliconEndcapTracking : public Processor {
 
    int _nDivisionsInPhi=0;
    int _nDivisionsInTheta=0;
+   
+   /** the boundaries of the theta divisions in cos(theta), empty = uniform */
+   FloatVec _thetaBoundaries{};
+   
+   /** a file with an occupancy profile to make the theta divisions from */
+   std::string _thetaOccupancyProfileInput{};
+   
+   /** a file to write the occupancy profile of the run to */
+   std::string _thetaOccupancyProfileOutput{};
+   
+   /** the occupancy of the hits in cos(theta), accumulated if ThetaOccupancyProfileOutput is set */
+   ThetaOccupancyProfile _thetaOccupancyProfile{};
    /* double _dPhi; */
    /* double _dTheta; */
 
@@ -314,22 +477,64 @@ class SiliconEndcapTracking : public Processor {
    /** Map containing the name of a criterion and a vector of the maximum cut offs for it */
    std::map< std::string , std::vector<float> > _critMaxima{};
    
+   /** The cut off values of the criteria per theta division, for the criteria that have them */
+   ThetaCutTable _thetaCutTable{};
+   
    /** Minimum number of hits a track has to have in order to be stored */
    int _hitsPerTrackMin{};
    
-   /** A vector of criteria for 2 hits (2 1-hit segments) */
-   std::vector <ICriterion*> _crit2Vec{};
+   /** The criteria for every round of the automaton, made in init. Only their order changes after the warm-up */
+   std::vector< CriteriaSet > _criteriaSets{};
+   
+   /** whether the 2-hit criteria are checked in batches by the EndcapSegmentBuilder */
+   bool _batchSegmentBuilding=false;
+   
+   /** whether the 2-hit criteria are checked by a compiled pipeline, if there is one for them */
+   bool _compiledCriteria=true;
+   
+   /** whether the batch criteria and the segment prediction are calculated in float instead of double precision */
+   bool _floatPrecisionCriteria=false;
+   
+   /** whether they are calculated in both precisions and the decisions compared by _precisionValidator */
+   bool _validateFloatPrecision=false;
+   
+   /** compares the decisions in float and double precision, if _validateFloatPrecision */
+   PrecisionValidator _precisionValidator{};
    
-   /** A vector of criteria for 3 hits (2 2-hit segments) */
-   std::vector <ICriterion*> _crit3Vec{};
+   /** how the classifiers are used: Off, Before or Instead (of the criteria of the steering) */
+   std::string _segmentClassifierMode{};
    
-   /** A vector of criteria for 4 hits (2 3-hit segments) */
-  std::vector <ICriterion*> _crit4Vec{};
+   /** the files the classifiers are read from */
+   std::vector< std::string > _segmentClassifierFiles{};
+   
+   /** the classifiers read in init */
+   std::vector< SegmentClassifier* > _segmentClassifiers{};
+   
+   /** the number of events the criteria are measured in before they are ordered by rejections per ns, 0 = steering file order */
+   int _criteriaWarmUpEvents=0;
+   
+   /** measures the criteria during the warm-up and orders them afterwards */
+   CriteriaProfiler _criteriaProfiler{};
    
    
    // const SectorSystemFTD* _sectorSystemFTD;
    const SectorSystemEndcap* _sectorSystemEndcap=NULL;
    
+   /** Decodes the cellIDs of the hits, made once in init */
+   const CellIDDecoder* _cellIDDecoder=NULL;
+   
+   /** the offsets of the layers of every subdetector */
+   IntVec _subdetLayerOffsets{};
+   
+   /** The label of the HitTables filled by this processor: the layers and sectors depend on it, see HitTableRegistry */
+   std::string _hitTableLabel{};
+   
+   /** Connects the sectors for the SegmentBuilder, its table of targets is made once in init */
+   EndcapSectorConnector* _sectorConnector=NULL;
+   
+   /** Rejects pairs of hits before the 2-hit criteria, made once in init if GeometricAcceptance is on. NULL = not used */
+   GeometricAcceptanceTable* _acceptanceTable=NULL;
+   
    
    bool _useCED=false;
    
@@ -348,6 +553,123 @@ class SiliconEndcapTracking : public Processor {
    /** The method used to find the best subset of tracks */
    std::string _bestSubsetFinder{};
    
+   /** the number of wedges in phi, that are reconstructed in parallel */
+   int _nPhiWedges=1;
+   
+   /** the number of phi divisions a wedge reaches into its neighbours */
+   int _phiWedgeHalo=8;
+   
+   /** the |z| positions of the layers, used to derive the windows of the sector connector */
+   FloatVec _layerZPositions{};
+   
+   /** the minimum pt of the tracks the sector connector shall connect */
+   float _connectionPtMin=0.;
+   
+   /** whether pairs of hits are rejected by the GeometricAcceptanceTable before the 2-hit criteria */
+   bool _geometricAcceptance=false;
+   
+   /** the difference in phi always accepted by the GeometricAcceptanceTable */
+   float _geometricAcceptancePhiTolerance=0.;
+   
+   /** the window in phi around the hit predicted by a segment, 0 = no prediction */
+   float _predictionPhiWindow=0.;
+   
+   /** the window in cos(theta) around the hit predicted by a segment */
+   float _predictionCosThetaWindow=0.;
+   
+   /** the number of pairs of hits in connected sectors with the windows of the connector (summed over all events) */
+   unsigned long _nCandidatePairs=0;
+   
+   /** the number of pairs of hits in connected sectors the fixed windows would have given (summed over all events) */
+   unsigned long _nCandidatePairsFixedWindows=0;
+   
+   /** the number of hit tables calculated from the TrackerHits (summed over all events) */
+   unsigned long _nHitTablesFilled=0;
+   
+   /** the number of hit tables copied from a table with another label (summed over all events) */
+   unsigned long _nHitTablesCopied=0;
+   
+   /** the number of hit tables another processor had already filled the same way (summed over all events) */
+   unsigned long _nHitTablesReused=0;
+   
+   /** the lower ends of the time windows for hits, empty = no time filter */
+   FloatVec _hitTimeWindowMin{};
+   
+   /** the upper ends of the time windows for hits */
+   FloatVec _hitTimeWindowMax{};
+   
+   /** whether the time of flight from the IP is subtracted from the hit time */
+   bool _hitTimeCorrectTOF=true;
+   
+   /** drops hits out of the time windows, NULL if no windows are set */
+   HitTimeFilter* _hitTimeFilter=NULL;
+   
+   /** the criteria round every pass of the tracking starts with. Each pass after the first only sees the hits not used by the tracks found before */
+   IntVec _passFirstRounds{};
+   
+   /** the number of tracks found in every pass (summed over all events) */
+   std::vector< unsigned long > _nTracksPerPass{};
+   
+   /** the number of hits masked for the passes after the first (summed over all events) */
+   unsigned long _nHitsMaskedForPasses=0;
+   
+   /** the minimum number of hits around a sector for it to be dense in the looper search, 0 = no looper search */
+   int _looperMinHits=0;
+   
+   /** the minimum number of dense sectors with the same phi and theta for their hits to be looper hits */
+   int _looperMinLayers=3;
+   
+   /** the maximum number of looper hits to be searched for tracks on their own, 0 = never */
+   int _looperPassMaxHits=0;
+   
+   /** takes the hits of loopers out of the track search, NULL if there is no looper search */
+   LooperFinder* _looperFinder=NULL;
+   
+   /** the number of hits taken out of the track search as looper hits (summed over all events) */
+   unsigned long _nLooperHitsMasked=0;
+   
+   /** the number of searches for tracks in the looper hits */
+   unsigned _nLooperPasses=0;
+   
+   /** the number of events whose looper hits were too many to be searched */
+   unsigned _nLooperPassesSkipped=0;
+   
+   /** the number of track candidates found in the looper hits */
+   unsigned long _nLooperPassCandidates=0;
+   
+   /** whether hits that were combined into a hit of another input collection are dropped */
+   bool _suppressCombinedHits=false;
+   
+   /** hits closer than this to a hit already read in are dropped, 0 = no check */
+   double _duplicateHitDistMax=0.;
+   
+   /** the hits read in so far in the event, to find duplicates (only with DuplicateHitDistMax > 0) */
+   HitProximityGrid* _duplicateHitGrid=NULL;
+   
+   /** the number of hits dropped as duplicates per input collection (summed over all events) */
+   std::map< std::string , unsigned long > _nDuplicateHits{};
+   
+   /** the maximum number of raw tracks extracted per outermost segment of the automaton, 0 = no limit */
+   int _maxPathsPerSegment=0;
+   
+   /** whether the extracted raw tracks are fitted in a worker thread while the extraction goes on */
+   bool _streamRawTracks=false;
+   
+   /** the maximum number of raw tracks waiting for the fit when they are streamed */
+   int _rawTrackQueueSize=1000;
+   
+   /** the number of outermost segments raw tracks were extracted from (summed over all events) */
+   unsigned _nExtractionStartSegments=0;
+   
+   /** the number of outermost segments, where MaxPathsPerSegment was hit (summed over all events) */
+   unsigned _nExtractionLimitHit=0;
+   
+   /** the number of pairs of hits checked by the batch 2-hit criteria (summed over all events) */
+   unsigned long _nPairsChecked=0;
+   
+   /** the number of pairs of hits rejected by the GeometricAcceptanceTable (summed over all events) */
+   unsigned long _nPairsRejectedByAcceptance=0;
+   
    unsigned _nTrackCandidates=0;
    unsigned _nTrackCandidatesPlus=0;
 
@@ -0,0 +1,117 @@
+#ifndef ThetaBinnedCriterion_h
+#define ThetaBinnedCriterion_h
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Criteria/ICriterion.h"
+
+#include "SectorSystemEndcap.h"
+#include "IBatchCriterion.h"
+
+
+using namespace KiTrack;
+
+namespace KiTrackMarlin{
+
+
+   /** Cut off values of criteria, that depend on the theta division of the SectorSystemEndcap.
+    *
+    * For a criterion there are nThetaSectors values per round: the first nThetaSectors values are for round 0
+    * (theta division 0, 1, ...), the next ones for round 1 and so on. If there are fewer rounds, the last one
+    * remains. A criterion can have a table for its minima, its maxima or both, the other one comes from the
+    * global cut off values then.
+    */
+   struct ThetaCutTable{
+
+      const SectorSystemEndcap* sectorSystem=NULL;
+
+      /** the minima per theta division and round, by criterion */
+      std::map< std::string , std::vector< float > > minima;
+
+      /** the maxima per theta division and round, by criterion */
+      std::map< std::string , std::vector< float > > maxima;
+
+      /** @return whether the criterion has a table */
+      bool hasTable( const std::string& critName ) const { return minima.count( critName ) || maxima.count( critName ); }
+
+      /** @return the number of rounds of the tables of the criterion */
+      unsigned getNRounds( const std::string& critName ) const ;
+
+      /** @return the cut off value of the table for the round and theta division, or globalValue, if there is no table */
+      static float getValue( const std::map< std::string , std::vector< float > >& table , const std::string& critName ,
+                             unsigned round , unsigned iTheta , unsigned nThetaSectors , float globalValue );
+
+   };
+
+
+   /** A criterion with its own cut off values in every theta division.
+    *
+    * It holds one criterion per theta division of the SectorSystemEndcap and passes the segments on to the one
+    * of the theta division of the parent: the division of the innermost hit of the parent segment (for 2 hits
+    * the outer hit).
+    */
+   class ThetaBinnedCriterion : public ICriterion{
+
+
+   public:
+
+      /**
+       * @param criteria the criterion for every theta division, they are owned and must all be the same criterion
+       */
+      ThetaBinnedCriterion( const SectorSystemEndcap* sectorSystem , const std::vector< ICriterion* >& criteria );
+
+      virtual bool areCompatible( Segment* parent , Segment* child );
+
+      virtual ~ThetaBinnedCriterion();
+
+
+   private:
+
+      ThetaBinnedCriterion( const ThetaBinnedCriterion& );
+      ThetaBinnedCriterion& operator=( const ThetaBinnedCriterion& );
+
+      const SectorSystemEndcap* _sectorSystem;
+      std::vector< ICriterion* > _criteria;
+
+   };
+
+
+   /** The batch version of ThetaBinnedCriterion: every pair is checked by the batch criterion of the theta division
+    * of hit a (the outer hit, the parent).
+    */
+   class ThetaBinnedBatchCriterion : public IBatchCriterion{
+
+
+   public:
+
+      /**
+       * @param criteria the batch criterion for every theta division, they are owned
+       */
+      ThetaBinnedBatchCriterion( const SectorSystemEndcap* sectorSystem , const std::vector< IBatchCriterion* >& criteria );
+
+      virtual void filter( const HitPairBatch& batch , std::vector< char >& pass ) const;
+
+      /** Sets the precision of the criteria of all theta divisions */
+      virtual void setPrecision( bool useFloat , PrecisionValidator* validator = NULL );
+
+      virtual ~ThetaBinnedBatchCriterion();
+
+
+   private:
+
+      ThetaBinnedBatchCriterion( const ThetaBinnedBatchCriterion& );
+      ThetaBinnedBatchCriterion& operator=( const ThetaBinnedBatchCriterion& );
+
+      const SectorSystemEndcap* _sectorSystem;
+      std::vector< IBatchCriterion* > _criteria;
+
+   };
+
+
+}
+
+
+#endif
+
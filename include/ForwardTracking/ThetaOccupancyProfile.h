@@ -0,0 +1,84 @@
+#ifndef ThetaOccupancyProfile_h
+#define ThetaOccupancyProfile_h
+
+#include <string>
+#include <vector>
+
+
+namespace KiTrackMarlin{
+
+
+   /** The number of hits in fine bins of cos(theta), accumulated over the events of a calibration run.
+    *
+    * From it boundaries for the theta divisions of a SectorSystemEndcap can be suggested, that give every division
+    * the same number of expected hits (see suggestBoundaries). Within a bin the hits are taken as uniform in cos(theta).
+    *
+    * A profile is saved as a text file:
+    *
+    * \verbatim
+    # a comment
+    events <number of events>
+    bins <number of bins>
+    <hits in bin 0> <hits in bin 1> ...
+    \endverbatim
+    *
+    * The bins are uniform in cos(theta) from -1 to 1.
+    */
+   class ThetaOccupancyProfile{
+
+
+   public:
+
+      /** @param nBins the number of bins in cos(theta) from -1 to 1 */
+      ThetaOccupancyProfile( unsigned nBins = 200 );
+
+      /** Adds a hit, hits outside of -1 to 1 go into the first or last bin */
+      void fill( double cosTheta );
+
+      /** Counts an event (the hits are filled separately) */
+      void addEvent(){ _nEvents++; }
+
+      /** Adds the hits and events of another profile with the same bins */
+      void add( const ThetaOccupancyProfile& profile );
+
+      unsigned getNBins() const { return _counts.size(); }
+
+      double getCount( unsigned bin ) const { return _counts[ bin ]; }
+
+      unsigned long getNEvents() const { return _nEvents; }
+
+      /** @return the total number of hits */
+      double getNHits() const ;
+
+      /** @return boundaries in cos(theta) of nDivisions divisions with the same number of hits, from -1 to 1.
+       * Without hits the divisions are uniform.
+       */
+      std::vector< double > suggestBoundaries( unsigned nDivisions ) const ;
+
+      /** @return the number of hits per event in every division between the passed boundaries */
+      std::vector< double > getExpectedHits( const std::vector< double >& boundaries ) const ;
+
+      /** Writes the profile to a file, throws std::runtime_error if that fails */
+      void write( const std::string& fileName ) const ;
+
+      /** Reads a profile from a file, throws std::runtime_error if that fails */
+      static ThetaOccupancyProfile read( const std::string& fileName );
+
+
+   private:
+
+      /** @return the number of hits below cosTheta */
+      double getNHitsBelow( double cosTheta ) const ;
+
+      std::vector< double > _counts;
+
+      unsigned long _nEvents;
+
+   };
+
+
+}
+
+
+#endif
+
@@ -17,6 +17,7 @@
 #include "TFile.h"
 
 #include "Tools/KiTrackMarlinTools.h"
+#include "CellIDDecoder.h"
 
 
 
@@ -31,7 +32,7 @@ using namespace marlin ;
 StepAnalyser aStepAnalyser ;
 
 
-StepAnalyser::StepAnalyser() : Processor("StepAnalyser") {
+StepAnalyser::StepAnalyser() : Processor("StepAnalyser"), _cellIDDecoder( NULL ) {
    
    // modify processor description
    _description = "StepAnalyser: Stores information about the path of a particle" ;
@@ -71,6 +72,9 @@ void StepAnalyser::init() {
    _nRun = 0 ;
    _nEvt = 0 ;
    
+   // parse the cellID encoding only once
+   _cellIDDecoder = new KiTrackMarlin::CellIDDecoder( LCTrackerCellID::encoding_string() );
+   
    
 
       
@@ -154,15 +158,13 @@ void StepAnalyser::processEvent( LCEvent * evt ) {
       for( unsigned j = 0; j < trackerHits.size() ; j++ ){ // over all hits (start with the outer ones)
       
          
-         BitField64  cellID( LCTrackerCellID::encoding_string() );
-         
-         cellID.setValue( trackerHits[j]->getCellID0() );
+         long64 cellID = trackerHits[j]->getCellID0();
          
-//          int detector = cellID[ LCTrackerCellID::subdet() ];
-//          int side         = cellID[ LCTrackerCellID::side()   ];
-         int layer        = cellID[ LCTrackerCellID::layer()  ];
-         int module   = cellID[ LCTrackerCellID::module() ];
-         int sensor   = cellID[ LCTrackerCellID::sensor() ];
+//          int detector = _cellIDDecoder->getSubdet( cellID );
+//          int side         = _cellIDDecoder->getSide( cellID );
+         int layer        = _cellIDDecoder->getLayer( cellID );
+         int module   = _cellIDDecoder->getModule( cellID );
+         int sensor   = _cellIDDecoder->getSensor( cellID );
          
          if (j == 0) lastLayerBeforeIP = layer;
          
@@ -234,6 +236,9 @@ void StepAnalyser::check( LCEvent* ) {
 
 void StepAnalyser::end(){ 
    
+   delete _cellIDDecoder;
+   _cellIDDecoder = NULL;
+   
    //   streamlog_out( DEBUG ) << "MyProcessor::end()  " << name() 
    //      << " processed " << _nEvt << " events in " << _nRun << " runs "
    //      << std::endl ;
@@ -0,0 +1,108 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <cstdlib>
+
+#include "ThetaOccupancyProfile.h"
+
+
+using namespace KiTrackMarlin;
+
+
+
+/** Prints the expected hits per event of the divisions and their maximum and mean */
+void printExpectedHits( const std::string& title, const std::vector< double >& expectedHits, unsigned nDivisionsInPhi ){
+
+
+   std::cout << title << "\n";
+
+   for( unsigned i=0; i < expectedHits.size(); i++ ){
+
+      std::cout << "   division " << i << ": " << expectedHits[i] << " hits per event";
+      if( nDivisionsInPhi > 1 ) std::cout << ", " << expectedHits[i] / nDivisionsInPhi << " per sector (summed over the layers)";
+      std::cout << "\n";
+
+   }
+
+   double max = *std::max_element( expectedHits.begin(), expectedHits.end() );
+   double mean = 0.;
+   for( unsigned i=0; i < expectedHits.size(); i++ ) mean += expectedHits[i] / expectedHits.size();
+
+   std::cout << "   maximum " << max << ", mean " << mean << " hits per event and division (maximum / mean = " << ( mean > 0. ? max / mean : 0. ) << ")\n\n";
+
+
+}
+
+
+/** Suggests boundaries of the theta divisions of the SectorSystemEndcap, that give every division the same number of hits.
+ *
+ * @param argv[1] the file with the occupancy profile (ThetaOccupancyProfileOutput of the SiliconEndcapTracking)
+ *
+ * @param argv[2] the number of divisions in theta
+ *
+ * @param argv[3] the number of divisions in phi, optional: only to show the expected hits per sector
+ *
+ */
+int main(int argc,char *argv[]){
+
+
+   if( argc < 3 ){
+
+      std::cout << "Usage: ThetaBinningSuggester <occupancy profile file> <NDivisionsInTheta> [NDivisionsInPhi]\n";
+      return 1;
+
+   }
+
+   std::string profileFile = argv[1];
+   int nDivisionsInTheta = atoi( argv[2] );
+   int nDivisionsInPhi = ( argc >= 4 ) ? atoi( argv[3] ) : 1;
+
+   if( nDivisionsInTheta <= 0 || nDivisionsInPhi <= 0 ){
+
+      std::cout << "The numbers of divisions have to be positive\n";
+      return 1;
+
+   }
+
+
+   ThetaOccupancyProfile profile;
+
+   try{
+
+      profile = ThetaOccupancyProfile::read( profileFile );
+
+   }
+   catch( std::runtime_error& e ){
+
+      std::cout << e.what() << "\n";
+      return 1;
+
+   }
+
+   std::cout << "Read " << profile.getNHits() << " hits in " << profile.getNEvents() << " events from " << profileFile << "\n\n";
+
+
+   std::vector< double > uniform;
+   for( int i=0; i <= nDivisionsInTheta; i++ ) uniform.push_back( -1. + i * 2. / nDivisionsInTheta );
+
+   std::vector< double > suggested = profile.suggestBoundaries( nDivisionsInTheta );
+
+   printExpectedHits( "Uniform divisions:", profile.getExpectedHits( uniform ), nDivisionsInPhi );
+   printExpectedHits( "Suggested divisions:", profile.getExpectedHits( suggested ), nDivisionsInPhi );
+
+
+   // in the form of the steering file
+   std::stringstream s;
+   s.precision( 8 );
+   for( unsigned i=0; i < suggested.size(); i++ ) s << ( i > 0 ? " " : "" ) << suggested[i];
+
+   std::cout << "<parameter name=\"NDivisionsInTheta\" type=\"int\">" << nDivisionsInTheta << "</parameter>\n";
+   std::cout << "<parameter name=\"ThetaBoundaries\" type=\"FloatVec\">" << s.str() << "</parameter>\n";
+
+
+   return 0;
+
+
+}
@@ -0,0 +1,192 @@
+#include "BatchCriteria.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <sstream>
+
+#include "FusedBatchCriterion.h"
+
+
+using namespace KiTrackMarlin;
+
+
+void KiTrackMarlin::recordPrecisionDecisions( const std::string& checkName , const HitPairBatch& batch , const std::vector< char >& pass ,
+                                              const std::vector< char >& passFloat , const std::vector< char >& passDouble , PrecisionValidator* validator ){
+   
+   
+   unsigned long nDecisions = 0;
+   unsigned long nDiffering = 0;
+   
+   for( unsigned i=0; i < batch.size(); i++ ){
+      
+      if( !pass[i] ) continue; // rejected before, not decided by this check
+      
+      nDecisions++;
+      
+      if( passFloat[i] == passDouble[i] ) continue;
+      
+      nDiffering++;
+      
+      if( validator->wantsExample( checkName ) ){
+         
+         std::stringstream s;
+         s.precision( 9 ); // enough to tell floats apart
+         s << "A = (" << batch.xA[i] << "," << batch.yA[i] << "," << batch.zA[i] << "), B = (" << batch.xB[i] << "," << batch.yB[i] << "," << batch.zB[i] 
+           << "): " << ( passFloat[i] ? "float passes, double rejects" : "float rejects, double passes" );
+         
+         validator->addExample( checkName, s.str() );
+         
+      }
+      
+   }
+   
+   validator->record( checkName, nDecisions, nDiffering );
+   
+   
+}
+
+
+BatchCrit2_DeltaRho::BatchCrit2_DeltaRho( float deltaRhoMin , float deltaRhoMax ){
+   
+   _name = getCritName();
+   
+   _cuts.deltaRhoMin = deltaRhoMin;
+   _cuts.deltaRhoMax = deltaRhoMax;
+   
+}
+
+
+void BatchCrit2_DeltaRho::filter( const HitPairBatch& batch , std::vector< char >& pass ) const {
+   
+   filterBatchInPrecision( _cuts, batch, pass, _useFloat, _validator, _name );
+   
+}
+
+
+BatchCrit2_RZRatio::BatchCrit2_RZRatio( float ratioMin , float ratioMax ){
+   
+   _name = getCritName();
+   
+   _cuts.ratioMin2 = double( ratioMin ) * ratioMin;
+   _cuts.ratioMax2 = double( ratioMax ) * ratioMax;
+   _cuts.zeroInRange = ( _cuts.ratioMin2 <= 0. ) && ( _cuts.ratioMax2 >= 0. );
+   
+}
+
+
+void BatchCrit2_RZRatio::filter( const HitPairBatch& batch , std::vector< char >& pass ) const {
+   
+   filterBatchInPrecision( _cuts, batch, pass, _useFloat, _validator, _name );
+   
+}
+
+
+BatchCrit2_StraightTrackRatio::BatchCrit2_StraightTrackRatio( float ratioMin , float ratioMax ){
+   
+   _name = getCritName();
+   
+   _cuts.ratioMin2 = double( ratioMin ) * ratioMin;
+   _cuts.ratioMax2 = double( ratioMax ) * ratioMax;
+   
+}
+
+
+void BatchCrit2_StraightTrackRatio::filter( const HitPairBatch& batch , std::vector< char >& pass ) const {
+   
+   filterBatchInPrecision( _cuts, batch, pass, _useFloat, _validator, _name );
+   
+}
+
+
+BatchCrit2_DeltaPhi::BatchCrit2_DeltaPhi( float deltaPhiMin , float deltaPhiMax ){
+   
+   
+   _name = getCritName();
+   
+   // the angle is in [0,180] degrees, where the cosine falls monotonically
+   double degToRad = M_PI / 180.;
+   _cuts.cosDeltaPhiMin = std::cos( degToRad * std::min( std::max( double( deltaPhiMin ), 0. ), 180. ) );
+   _cuts.cosDeltaPhiMax = std::cos( degToRad * std::min( std::max( double( deltaPhiMax ), 0. ), 180. ) );
+   
+   _cuts.zeroInWindow = ( deltaPhiMin <= 0.f ) && ( deltaPhiMax >= 0.f );
+   
+   
+}
+
+
+void BatchCrit2_DeltaPhi::filter( const HitPairBatch& batch , std::vector< char >& pass ) const {
+   
+   filterBatchInPrecision( _cuts, batch, pass, _useFloat, _validator, _name );
+   
+}
+
+
+BatchCriterionAdapter::BatchCriterionAdapter( ICriterion* criterion ):
+   _criterion( criterion ){
+   
+   _name = criterion->getName();
+   
+}
+
+
+void BatchCriterionAdapter::filter( const HitPairBatch& batch , std::vector< char >& pass ) const {
+   
+   
+   for( unsigned i=0; i < batch.size(); i++ ){
+      
+      if( pass[i] && !_criterion->areCompatible( batch.segA[i], batch.segB[i] ) ) pass[i] = 0;
+      
+   }
+   
+   
+}
+
+
+IBatchCriterion* KiTrackMarlin::createBatchCriterion( const std::string& critName , float min , float max , ICriterion* criterion ){
+   
+   
+   if( critName == BatchCrit2_DeltaRho::getCritName() ) return new BatchCrit2_DeltaRho( min, max );
+   if( critName == BatchCrit2_RZRatio::getCritName() ) return new BatchCrit2_RZRatio( min, max );
+   if( critName == BatchCrit2_StraightTrackRatio::getCritName() ) return new BatchCrit2_StraightTrackRatio( min, max );
+   if( critName == BatchCrit2_DeltaPhi::getCritName() ) return new BatchCrit2_DeltaPhi( min, max );
+   
+   return new BatchCriterionAdapter( criterion );
+   
+   
+}
+
+
+IBatchCriterion* KiTrackMarlin::createFusedBatchCriterion( const std::vector< std::string >& critNames, 
+                                                           const std::vector< float >& critMins, 
+                                                           const std::vector< float >& critMaxs ){
+   
+   
+   typedef std::map< std::string , std::pair< float , float > > CutMap;
+   
+   CutMap cuts;
+   
+   for( unsigned i=0; i < critNames.size(); i++ ){
+      
+      if( cuts.count( critNames[i] ) ) return NULL; // a criterion twice: not compiled
+      
+      cuts[ critNames[i] ] = std::make_pair( critMins[i], critMaxs[i] );
+      
+   }
+   
+   
+   // The compiled pipelines, the first one matching is used. 
+   // To add one, add a line with the batch criteria as template arguments.
+   IBatchCriterion* fused = NULL;
+   
+   // the 2-hit criteria of the standard steering
+   if( !fused ) fused = createFusedIfMatching< BatchCrit2_DeltaPhi, BatchCrit2_StraightTrackRatio, BatchCrit2_DeltaRho, BatchCrit2_RZRatio >( cuts );
+   if( !fused ) fused = createFusedIfMatching< BatchCrit2_DeltaPhi, BatchCrit2_StraightTrackRatio, BatchCrit2_RZRatio >( cuts );
+   if( !fused ) fused = createFusedIfMatching< BatchCrit2_StraightTrackRatio, BatchCrit2_RZRatio >( cuts );
+   if( !fused ) fused = createFusedIfMatching< BatchCrit2_DeltaPhi, BatchCrit2_StraightTrackRatio >( cuts );
+   
+   return fused;
+   
+   
+}
+
@@ -0,0 +1,228 @@
+#include "BestFirstTrackExtractor.h"
+
+#include <queue>
+#include <list>
+#include <cmath>
+
+
+using namespace KiTrackMarlin;
+
+
+BestFirstTrackExtractor::BestFirstTrackExtractor( unsigned pathsPerSegmentMax , unsigned minHits ){
+
+   _pathsPerSegmentMax = pathsPerSegmentMax;
+   _minHits = minHits;
+
+   _nStartSegments = 0;
+   _nLimitHit = 0;
+   _stopped = false;
+
+}
+
+
+std::vector < std::vector< IHit* > > BestFirstTrackExtractor::getTracks( Automaton& automaton ){
+
+
+   std::vector < std::vector< IHit* > > tracks;
+
+   extractTracks( automaton, [ &tracks ]( std::vector< IHit* >& track ){ tracks.push_back( track ); return true; } );
+
+   return tracks;
+
+}
+
+
+void BestFirstTrackExtractor::extractTracks( Automaton& automaton, const TrackConsumer& consumer ){
+
+
+   _nStartSegments = 0;
+   _nLimitHit = 0;
+   _stopped = false;
+   _nHitsBelow.clear();
+
+   std::vector< const Segment* > segments = automaton.getSegments();
+
+   for( unsigned i=0; i < segments.size() && !_stopped; i++ ){
+
+      Segment* segment = const_cast< Segment* >( segments[i] );
+
+      if( !segment->getParents().empty() ) continue; // only segments without parents are outer ends of tracks
+
+      _nStartSegments++;
+
+      if( extractFromSegment( segment, consumer ) ) _nLimitHit++;
+
+   }
+
+}
+
+
+bool BestFirstTrackExtractor::extractFromSegment( Segment* startSegment, const TrackConsumer& consumer ){
+
+
+   std::priority_queue< PathNode*, std::vector< PathNode* >, PathNodeCompare > queue;
+
+   PathNode* start = new PathNode();
+   start->cost = 0.;
+   start->hits.push_back( startSegment->getHits().back() ); // the outer hit of the segment
+   start->segment = startSegment;
+   queue.push( start );
+
+   unsigned nPaths = 0;
+
+   while( !queue.empty() && nPaths < _pathsPerSegmentMax && !_stopped ){
+
+
+      PathNode* node = queue.top();
+      queue.pop();
+
+
+      if( node->segment == NULL ){ // a complete path: as it is the cheapest one left, we can take it
+
+         std::vector< IHit* > track;
+         for( unsigned j=0; j < node->hits.size(); j++ ){
+
+            if( !node->hits[j]->isVirtual() ) track.push_back( node->hits[j] );
+
+         }
+
+         if( track.size() >= _minHits ){
+
+            nPaths++;
+            if( !consumer( track ) ) _stopped = true;
+
+         }
+
+         delete node;
+         continue;
+
+      }
+
+
+      std::list< Segment* > children = node->segment->getChildren();
+
+      if( children.empty() ){ // the bottom of the tree: add the remaining hits of the segment and requeue as complete path
+
+         std::vector< IHit* > segHits = node->segment->getHits();
+
+         for( int j = int( segHits.size() ) - 2; j >= 0; j-- ){
+
+            unsigned n = node->hits.size();
+            if( n >= 2 ) node->cost += kinkCost( node->hits[n-2], node->hits[n-1], segHits[j] );
+            node->hits.push_back( segHits[j] );
+
+         }
+
+         node->segment = NULL;
+         queue.push( node );
+         continue;
+
+      }
+
+
+      for( std::list< Segment* >::iterator itChild = children.begin(); itChild != children.end(); itChild++ ){
+
+         Segment* child = *itChild;
+         IHit* hit = child->getHits().back(); // the outer hit of the child
+
+         PathNode* newNode = new PathNode();
+         newNode->hits = node->hits;
+         newNode->cost = node->cost;
+
+         unsigned n = newNode->hits.size();
+         if( n >= 2 ) newNode->cost += kinkCost( newNode->hits[n-2], newNode->hits[n-1], hit );
+
+         newNode->hits.push_back( hit );
+         newNode->segment = child;
+         queue.push( newNode );
+
+      }
+
+      delete node;
+
+   }
+
+
+   // Whatever is left in the queue are paths we didn't take (unless the consumer stopped the extraction).
+   // The limit was only hit, if one of them could still become a path with enough real hits.
+   bool limitHit = false;
+
+   while( !queue.empty() ){
+
+      if( !limitHit && !_stopped ) limitHit = canReachMinHits( queue.top() );
+
+      delete queue.top();
+      queue.pop();
+
+   }
+
+   return limitHit;
+
+}
+
+
+bool BestFirstTrackExtractor::canReachMinHits( const PathNode* node ){
+
+
+   unsigned nHits = 0;
+   for( unsigned j=0; j < node->hits.size(); j++ ) if( !node->hits[j]->isVirtual() ) nHits++;
+
+   if( node->segment != NULL ) nHits += getNHitsBelow( node->segment );
+
+   return nHits >= _minHits;
+
+}
+
+
+unsigned BestFirstTrackExtractor::getNHitsBelow( Segment* segment ){
+
+
+   std::unordered_map< Segment* , unsigned >::const_iterator it = _nHitsBelow.find( segment );
+   if( it != _nHitsBelow.end() ) return it->second;
+
+   unsigned nHitsBelow = 0;
+
+   std::list< Segment* > children = segment->getChildren();
+
+   if( children.empty() ){ // the bottom of the tree: the remaining hits of the segment
+
+      std::vector< IHit* > segHits = segment->getHits();
+      for( int j = int( segHits.size() ) - 2; j >= 0; j-- ) if( !segHits[j]->isVirtual() ) nHitsBelow++;
+
+   }
+   else{ // the outer hit of a child and the hits below it
+
+      for( std::list< Segment* >::iterator itChild = children.begin(); itChild != children.end(); itChild++ ){
+
+         unsigned nHits = ( (*itChild)->getHits().back()->isVirtual() ? 0 : 1 ) + getNHitsBelow( *itChild );
+         if( nHits > nHitsBelow ) nHitsBelow = nHits;
+
+      }
+
+   }
+
+   _nHitsBelow[ segment ] = nHitsBelow;
+
+   return nHitsBelow;
+
+}
+
+
+double BestFirstTrackExtractor::kinkCost( IHit* a, IHit* b, IHit* c ){
+
+
+   double ux = b->getX() - a->getX();
+   double uy = b->getY() - a->getY();
+   double uz = b->getZ() - a->getZ();
+
+   double vx = c->getX() - b->getX();
+   double vy = c->getY() - b->getY();
+   double vz = c->getZ() - b->getZ();
+
+   double norm = sqrt( ( ux*ux + uy*uy + uz*uz ) * ( vx*vx + vy*vy + vz*vz ) );
+
+   if( norm <= 0. ) return 0.;
+
+   return 1. - ( ux*vx + uy*vy + uz*vz ) / norm;
+
+}
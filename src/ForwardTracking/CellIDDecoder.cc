@@ -0,0 +1,42 @@
+#include "CellIDDecoder.h"
+
+#include "UTIL/BitField64.h"
+#include "UTIL/LCTrackerConf.h"
+
+
+using namespace KiTrackMarlin;
+
+
+CellIDDecoder::CellIDDecoder( const std::string& encodingString, const std::vector< int >& layerOffsets ){
+   
+   
+   _encodingString = encodingString;
+   _layerOffsets = layerOffsets;
+   
+   _subdet = getField( UTIL::LCTrackerCellID::subdet() );
+   _side = getField( UTIL::LCTrackerCellID::side() );
+   _layer = getField( UTIL::LCTrackerCellID::layer() );
+   _module = getField( UTIL::LCTrackerCellID::module() );
+   _sensor = getField( UTIL::LCTrackerCellID::sensor() );
+   
+   
+}
+
+
+CellIDDecoder::Field CellIDDecoder::getField( const std::string& name ) const {
+   
+   
+   UTIL::BitField64 bitField( _encodingString );
+   
+   const UTIL::BitFieldValue& value = bitField[ name ];
+   
+   Field field;
+   field.offset = value.offset();
+   field.width = value.width();
+   field.isSigned = value.isSigned();
+   
+   return field;
+   
+   
+}
+
@@ -0,0 +1,182 @@
+#include "ClassifierCriterion.h"
+
+#include <sstream>
+#include <map>
+#include <atomic>
+#include <unordered_map>
+
+#include "Criteria/Criteria.h"
+
+
+using namespace KiTrackMarlin;
+
+
+namespace{
+
+
+   std::atomic< unsigned long > nextClassifierCriterionId( 0 );
+
+
+   /** Reads the values of a criterion without copying them: getMapOfValues() returns a copy */
+   struct CriterionValues : public ICriterion{
+
+      static const std::map< std::string , float >& get( ICriterion* criterion ){
+
+         return criterion->*( &CriterionValues::_map_name_value );
+
+      }
+
+   };
+
+
+}
+
+
+ClassifierCriterion::ClassifierCriterion( const SegmentClassifier* classifier ):
+   _classifier( classifier ), _id( nextClassifierCriterionId++ ){
+
+
+   _name = "Classifier";
+
+   std::stringstream type;
+   type << classifier->getNHits() << "Hit";
+   _type = type.str();
+
+   _saveValues = false;
+
+
+}
+
+
+ClassifierCriterion::~ClassifierCriterion(){
+
+
+}
+
+
+ClassifierCriterion::FeatureCache& ClassifierCriterion::getFeatureCache(){
+
+
+   static thread_local std::unordered_map< unsigned long , FeatureCache > caches;
+
+   // the same criterion is asked many times in a row
+   static thread_local unsigned long lastId = 0;
+   static thread_local FeatureCache* lastCache = NULL;
+
+   if( lastCache != NULL && lastId == _id ) return *lastCache;
+
+
+   FeatureCache& cache = caches[ _id ];
+
+   if( cache.criteria.empty() ){
+
+      const std::vector< std::string >& critNames = _classifier->getCriteriaNames();
+
+      for( unsigned i=0; i < critNames.size(); i++ ){
+
+         ICriterion* crit = Criteria::createCriterion( critNames[i] );
+         crit->setSaveValues( true );
+
+         cache.criteria.push_back( crit );
+
+      }
+
+      cache.features.resize( _classifier->getNFeatures() );
+
+   }
+
+   lastId = _id;
+   lastCache = &cache; // elements of an unordered_map keep their address
+
+   return cache;
+
+
+}
+
+
+void ClassifierCriterion::getFeatures( Segment* parent , Segment* child , float* features ){
+
+
+   std::vector< ICriterion* >& criteria = getFeatureCache().criteria;
+
+   const std::vector< std::string >& featureNames = _classifier->getFeatureNames();
+
+   for( unsigned f=0; f < featureNames.size(); f++ ) features[f] = 0.f;
+
+
+   for( unsigned i=0; i < criteria.size(); i++ ){
+
+      criteria[i]->areCompatible( parent, child ); // only to calculate the values
+
+      const std::map< std::string , float >& values = CriterionValues::get( criteria[i] );
+
+      for( unsigned f=0; f < featureNames.size(); f++ ){
+
+         std::map< std::string , float >::const_iterator it = values.find( featureNames[f] );
+         if( it != values.end() ) features[f] = it->second;
+
+      }
+
+   }
+
+
+}
+
+
+bool ClassifierCriterion::areCompatible( Segment* parent , Segment* child ){
+
+
+   std::vector< float >& features = getFeatureCache().features;
+
+   getFeatures( parent, child, features.data() );
+
+   float score = _classifier->score( features );
+
+   if( _saveValues ) _map_name_value[ "Classifier_score" ] = score;
+
+   return score >= _classifier->getThreshold();
+
+
+}
+
+
+BatchClassifierCriterion::BatchClassifierCriterion( ClassifierCriterion* criterion ):
+   _criterion( criterion ){
+
+   _name = criterion->getName();
+
+}
+
+
+void BatchClassifierCriterion::filter( const HitPairBatch& batch , std::vector< char >& pass ) const {
+
+
+   const SegmentClassifier* classifier = _criterion->getClassifier();
+   const unsigned nFeatures = classifier->getNFeatures();
+
+   // the pairs still in
+   std::vector< unsigned > indices;
+   for( unsigned i=0; i < batch.size(); i++ ) if( pass[i] ) indices.push_back( i );
+
+   if( indices.empty() ) return;
+
+   std::vector< float > features( indices.size() * nFeatures );
+
+   for( unsigned j=0; j < indices.size(); j++ ){
+
+      _criterion->getFeatures( batch.segA[ indices[j] ], batch.segB[ indices[j] ], &features[ j*nFeatures ] );
+
+   }
+
+   std::vector< float > scores( indices.size() );
+   classifier->score( features.data(), indices.size(), scores.data() );
+
+   for( unsigned j=0; j < indices.size(); j++ ){
+
+      if( scores[j] < classifier->getThreshold() ) pass[ indices[j] ] = 0;
+
+   }
+
+
+}
+
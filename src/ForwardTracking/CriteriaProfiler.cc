@@ -0,0 +1,136 @@
+#include "CriteriaProfiler.h"
+
+#include <algorithm>
+
+
+using namespace KiTrackMarlin;
+
+
+namespace{
+   
+   /** The vectors of criteria of a CriteriaSet, in the order of _profiledCriteria */
+   std::vector< ICriterion* > CriteriaSet::* const critVecs[3] = { &CriteriaSet::crit2Vec, &CriteriaSet::crit3Vec, &CriteriaSet::crit4Vec };
+   
+   
+   /** Sorts the criteria, that were called, by rejections per ns, the ones never called go to the back */
+   bool isBetterFirst( const ProfiledCriterion* a , const ProfiledCriterion* b ){
+      
+      if( a->getNCalls() == 0 || b->getNCalls() == 0 ) return a->getNCalls() > 0 && b->getNCalls() == 0;
+      
+      return a->getRejectionPerTime() > b->getRejectionPerTime();
+      
+   }
+   
+}
+
+
+CriteriaProfiler::~CriteriaProfiler(){
+   
+   for( unsigned i=0; i < _profiledCriteria.size(); i++ ){
+      
+      for( unsigned j=0; j < _profiledCriteria[i].size(); j++ ) delete _profiledCriteria[i][j];
+      
+   }
+   
+}
+
+
+void CriteriaProfiler::startProfiling( std::vector< CriteriaSet >& criteriaSets ){
+   
+   
+   if( _isProfiling ) return;
+   
+   for( unsigned i=0; i < _profiledCriteria.size(); i++ ){
+      
+      for( unsigned j=0; j < _profiledCriteria[i].size(); j++ ) delete _profiledCriteria[i][j];
+      
+   }
+   
+   _profiledCriteria.assign( 3 * criteriaSets.size(), std::vector< ProfiledCriterion* >() );
+   
+   
+   for( unsigned round=0; round < criteriaSets.size(); round++ ){
+      
+      for( unsigned k=0; k < 3; k++ ){
+         
+         std::vector< ICriterion* >& criteria = criteriaSets[round].*critVecs[k];
+         std::vector< ProfiledCriterion* >& profiledCriteria = _profiledCriteria[ 3*round + k ];
+         
+         for( unsigned i=0; i < criteria.size(); i++ ){
+            
+            profiledCriteria.push_back( new ProfiledCriterion( criteria[i] ) );
+            criteria[i] = profiledCriteria.back();
+            
+         }
+         
+      }
+      
+   }
+   
+   _isProfiling = true;
+   
+   
+}
+
+
+void CriteriaProfiler::stopProfiling( std::vector< CriteriaSet >& criteriaSets ){
+   
+   
+   if( !_isProfiling ) return;
+   
+   for( unsigned round=0; round < criteriaSets.size(); round++ ){
+      
+      for( unsigned k=0; k < 3; k++ ){
+         
+         std::vector< ICriterion* >& criteria = criteriaSets[round].*critVecs[k];
+         std::vector< ProfiledCriterion* >& profiledCriteria = _profiledCriteria[ 3*round + k ];
+         
+         std::stable_sort( profiledCriteria.begin(), profiledCriteria.end(), isBetterFirst );
+         
+         for( unsigned i=0; i < criteria.size(); i++ ) criteria[i] = profiledCriteria[i]->getCriterion();
+         
+      }
+      
+   }
+   
+   _isProfiling = false;
+   
+   
+}
+
+
+void CriteriaProfiler::print( std::ostream& os ) const {
+   
+   
+   const char* types[3] = { "2Hit", "3Hit", "4Hit" };
+   
+   for( unsigned i=0; i < _profiledCriteria.size(); i++ ){
+      
+      const std::vector< ProfiledCriterion* >& profiledCriteria = _profiledCriteria[i];
+      
+      if( profiledCriteria.empty() ) continue;
+      
+      os << "Round " << i/3 << ", " << types[ i%3 ] << " criteria:\n";
+      
+      for( unsigned j=0; j < profiledCriteria.size(); j++ ){
+         
+         ProfiledCriterion* crit = profiledCriteria[j];
+         
+         os << "   " << j+1 << ". " << crit->getName() << ": " << crit->getNCalls() << " calls, " << crit->getNRejected() << " rejected";
+         
+         if( crit->getNCalls() > 0 ){
+            
+            os << " (" << 100. * crit->getNRejected() / crit->getNCalls() << "%), " << crit->getTimePerCall() 
+               << " ns per call (" << crit->getNTimedCalls() << " timed), " << crit->getRejectionPerTime() << " rejected per ns";
+            
+         }
+         
+         os << "\n";
+         
+      }
+      
+   }
+   
+   
+}
+
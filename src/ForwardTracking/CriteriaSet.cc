@@ -0,0 +1,225 @@
+#include "CriteriaSet.h"
+
+#include <algorithm>
+
+#include "Criteria/Criteria.h"
+#include "BatchCriteria.h"
+#include "ClassifierCriterion.h"
+#include "ThetaBinnedCriterion.h"
+#include "marlin/VerbosityLevels.h"
+
+
+using namespace KiTrackMarlin;
+
+
+std::vector< CriteriaSet > KiTrackMarlin::makeCriteriaSets( const std::vector< std::string >& criteriaNames,
+                                                            const std::map< std::string , std::vector< float > >& critMinima,
+                                                            const std::map< std::string , std::vector< float > >& critMaxima,
+                                                            bool fuseBatchCriteria,
+                                                            const ThetaCutTable* thetaCuts ){
+   
+   
+   // There are as many rounds as the criterion with the most cut off values has values
+   unsigned nRounds = 0;
+   
+   for( unsigned i=0; i<criteriaNames.size(); i++ ){
+      
+      nRounds = std::max( nRounds, unsigned( critMinima.at( criteriaNames[i] ).size() ) );
+      nRounds = std::max( nRounds, unsigned( critMaxima.at( criteriaNames[i] ).size() ) );
+      
+      if( thetaCuts != NULL ) nRounds = std::max( nRounds, thetaCuts->getNRounds( criteriaNames[i] ) );
+      
+   }
+   
+   std::vector< CriteriaSet > criteriaSets( nRounds );
+   
+   
+   for( unsigned round=0; round < nRounds; round++ ){
+      
+      CriteriaSet& criteria = criteriaSets[ round ];
+      
+      // the names and cut off values of the 2-hit criteria of the round
+      std::vector< std::string > crit2Names;
+      std::vector< float > crit2Mins;
+      std::vector< float > crit2Maxs;
+      
+      // whether a 2-hit criterion of the round has cut off values per theta division (no fused criterion then)
+      bool thetaBinned2Hit = false;
+      
+      for( unsigned i=0; i<criteriaNames.size(); i++ ){
+         
+         const std::string& critName = criteriaNames[i];
+         
+         const std::vector< float >& minima = critMinima.at( critName );
+         const std::vector< float >& maxima = critMaxima.at( critName );
+         
+         // use the value corresponding to the round, if there are no new ones for this criterion the last value stays in place
+         float min = minima[ std::min( round, unsigned( minima.size() ) - 1 ) ];
+         float max = maxima[ std::min( round, unsigned( maxima.size() ) - 1 ) ];
+         
+         ICriterion* crit = NULL;
+         IBatchCriterion* batchCrit = NULL;
+         
+         if( thetaCuts != NULL && thetaCuts->hasTable( critName ) ){
+            
+            
+            // a criterion for every theta division, with the values of the tables
+            const unsigned nThetaSectors = thetaCuts->sectorSystem->getThetaSectors();
+            
+            std::vector< ICriterion* > thetaCrits;
+            std::vector< IBatchCriterion* > thetaBatchCrits;
+            
+            for( unsigned iTheta=0; iTheta < nThetaSectors; iTheta++ ){
+               
+               float thetaMin = ThetaCutTable::getValue( thetaCuts->minima, critName, round, iTheta, nThetaSectors, min );
+               float thetaMax = ThetaCutTable::getValue( thetaCuts->maxima, critName, round, iTheta, nThetaSectors, max );
+               
+               ICriterion* thetaCrit = Criteria::createCriterion( critName, thetaMin , thetaMax );
+               thetaCrits.push_back( thetaCrit );
+               
+               if( thetaCrit->getType() == "2Hit" ) thetaBatchCrits.push_back( createBatchCriterion( critName, thetaMin, thetaMax, thetaCrit ) );
+               
+               streamlog_out( DEBUG3 ) <<  "Criterion " << critName << ", theta division " << iTheta 
+               << ": Min = " << thetaMin
+               << ", Max = " << thetaMax
+               << ", round " << round << "\n";
+               
+            }
+            
+            crit = new ThetaBinnedCriterion( thetaCuts->sectorSystem, thetaCrits );
+            
+            if( !thetaBatchCrits.empty() ){
+               
+               batchCrit = new ThetaBinnedBatchCriterion( thetaCuts->sectorSystem, thetaBatchCrits );
+               thetaBinned2Hit = true;
+               
+            }
+            
+            
+         }
+         else{
+            
+            crit = Criteria::createCriterion( critName, min , max );
+            
+         }
+         
+         // Some debug output about the created criterion
+         std::string type = crit->getType();
+         
+         streamlog_out( DEBUG3 ) <<  "Added: Criterion " << critName << " (type =  " << type 
+         << " ). Min = " << min
+         << ", Max = " << max
+         << ", round " << round << "\n";
+         
+         
+         // Add the new criterion to the corresponding vector
+         if( type == "2Hit" ){
+            
+            if( batchCrit == NULL ) batchCrit = createBatchCriterion( critName, min, max, crit );
+            
+            criteria.crit2Vec.push_back( crit );
+            criteria.batch2Vec.push_back( batchCrit );
+            
+            crit2Names.push_back( critName );
+            crit2Mins.push_back( min );
+            crit2Maxs.push_back( max );
+            
+         }
+         else if( type == "3Hit" ){
+            
+            criteria.crit3Vec.push_back( crit );
+            
+         }
+         else if( type == "4Hit" ){
+            
+            criteria.crit4Vec.push_back( crit );
+            
+         }
+         else delete crit;
+         
+      }
+      
+      
+      IBatchCriterion* fused = ( fuseBatchCriteria && !thetaBinned2Hit ) ? createFusedBatchCriterion( crit2Names, crit2Mins, crit2Maxs ) : NULL;
+      
+      if( fused != NULL ){
+         
+         for ( unsigned i=0; i< criteria.batch2Vec.size(); i++) delete criteria.batch2Vec[i];
+         criteria.batch2Vec.assign( 1, fused );
+         
+         streamlog_out( DEBUG3 ) << "The 2-hit criteria of round " << round << " are checked by " << fused->getName() << "\n";
+         
+      }
+      
+   }
+   
+   
+   return criteriaSets;
+   
+}
+
+
+void KiTrackMarlin::addClassifierCriteria( std::vector< CriteriaSet >& criteriaSets , const SegmentClassifier* classifier , bool replaceCuts ){
+   
+   
+   for( unsigned round=0; round < criteriaSets.size(); round++ ){
+      
+      CriteriaSet& criteria = criteriaSets[ round ];
+      
+      std::vector< ICriterion* >* critVec = NULL;
+      
+      if( classifier->getNHits() == 2 ) critVec = &criteria.crit2Vec;
+      else if( classifier->getNHits() == 3 ) critVec = &criteria.crit3Vec;
+      else critVec = &criteria.crit4Vec;
+      
+      ClassifierCriterion* classifierCrit = new ClassifierCriterion( classifier );
+      
+      if( replaceCuts ){
+         
+         for( unsigned i=0; i < critVec->size(); i++ ) delete (*critVec)[i];
+         critVec->clear();
+         
+      }
+      
+      critVec->insert( critVec->begin(), classifierCrit );
+      
+      
+      if( classifier->getNHits() == 2 ){
+         
+         if( replaceCuts ){
+            
+            for( unsigned i=0; i < criteria.batch2Vec.size(); i++ ) delete criteria.batch2Vec[i];
+            criteria.batch2Vec.clear();
+            
+         }
+         
+         criteria.batch2Vec.insert( criteria.batch2Vec.begin(), new BatchClassifierCriterion( classifierCrit ) );
+         
+      }
+      
+      streamlog_out( DEBUG3 ) << "Added: " << classifier->getType() << " classifier (type = " << classifierCrit->getType() << ")" 
+                              << ( replaceCuts ? " instead of the criteria" : " in front of the criteria" ) << ", round " << round << "\n";
+      
+   }
+   
+   
+}
+
+
+void KiTrackMarlin::deleteCriteriaSets( std::vector< CriteriaSet >& criteriaSets ){
+   
+   for( unsigned round=0; round < criteriaSets.size(); round++ ){
+      
+      CriteriaSet& criteria = criteriaSets[ round ];
+      
+      for ( unsigned i=0; i< criteria.crit2Vec.size(); i++) delete criteria.crit2Vec[i];
+      for ( unsigned i=0; i< criteria.crit3Vec.size(); i++) delete criteria.crit3Vec[i];
+      for ( unsigned i=0; i< criteria.crit4Vec.size(); i++) delete criteria.crit4Vec[i];
+      for ( unsigned i=0; i< criteria.batch2Vec.size(); i++) delete criteria.batch2Vec[i];
+      
+   }
+   
+   criteriaSets.clear();
+   
+}
+
@@ -1,11 +1,16 @@
+
 #include "EndcapSectorConnector.h"
 
+#include <cmath>
+#include <algorithm>
+
 
 using namespace KiTrackMarlin;
 
 
 // Constructor
-EndcapSectorConnector::EndcapSectorConnector( const SectorSystemEndcap* sectorSystemEndcap , unsigned layerStepMax, unsigned lastLayerToIP ){
+EndcapSectorConnector::EndcapSectorConnector( const SectorSystemEndcap* sectorSystemEndcap , unsigned layerStepMax, unsigned lastLayerToIP,
+                                              const std::vector< float >& layerZ, double Bz, double ptMin ){
    
    _sectorSystemEndcap = sectorSystemEndcap ;
    _layerStepMax = layerStepMax ;
@@ -14,6 +19,26 @@ EndcapSectorConnector::EndcapSectorConnector( const SectorSystemEndcap* sectorSy
    _nLayers = sectorSystemEndcap->getNLayers();
    _nDivisionsInPhi = sectorSystemEndcap->getPhiSectors();
    _nDivisionsInTheta = sectorSystemEndcap->getThetaSectors();
+   
+   _layerZ = layerZ;
+   _usePhysicsWindows = ( _layerZ.size() == _nLayers ) && ( fabs( Bz ) > 0. ) && ( ptMin > 0. );
+   
+   // R = pt / ( 0.3 * B ), in mm for pt in GeV and B in Tesla
+   _radiusMin = _usePhysicsWindows ? 1000. * ptMin / ( 0.3 * fabs( Bz ) ) : 0.;
+
+   // The targets only depend on the geometry: calculate them once for every sector
+   // (with the physics windows the fixed windows get their own table, so the pairs they would give can be counted)
+   unsigned nSectors = _nLayers*_nDivisionsInPhi*_nDivisionsInTheta;
+
+   for( unsigned sector = 0; sector < nSectors; sector++ ){
+
+      _table.appendSector( calculateTargetSectors( sector, false ) );
+      
+      if( _usePhysicsWindows ) _tableFixedWindows.appendSector( calculateTargetSectors( sector, true ) );
+
+   }
+   
+   _nConnectionsFixedWindows = _usePhysicsWindows ? _tableFixedWindows.getNConnections() : _table.getNConnections();
 
 }
 
@@ -21,10 +46,49 @@ EndcapSectorConnector::EndcapSectorConnector( const SectorSystemEndcap* sectorSy
 
 std::set< int > EndcapSectorConnector::getTargetSectors ( int sector ){
    
+   return _table.getTargetSectors( sector );
    
-   std::set <int> targetSectors;
+}
+
 
-   //std::cout << " check : n layers " << _nLayers << " n phi divisions " << _nDivisionsInPhi << " n theta divisions " << _nDivisionsInTheta << std::endl ;
+
+unsigned long EndcapSectorConnector::countCandidatePairs( const std::map< int , std::vector< IHit* > >& map_sector_hits, bool fixedWindows ) const {
+   
+   
+   const SectorConnectionTable& table = ( fixedWindows && _usePhysicsWindows ) ? _tableFixedWindows : _table;
+   
+   unsigned long nPairs = 0;
+   
+   std::map< int , std::vector< IHit* > >::const_iterator it;
+   
+   for( it = map_sector_hits.begin(); it != map_sector_hits.end(); it++ ){
+      
+      
+      unsigned nHits = it->second.size();
+      
+      const int* targetsEnd = table.getTargetsEnd( it->first );
+      
+      for( const int* itTarg = table.getTargetsBegin( it->first ); itTarg != targetsEnd; itTarg++ ){
+         
+         std::map< int , std::vector< IHit* > >::const_iterator itB = map_sector_hits.find( *itTarg );
+         if( itB != map_sector_hits.end() ) nPairs += nHits * itB->second.size();
+         
+      }
+      
+   }
+   
+   
+   return nPairs;
+   
+   
+}
+
+
+
+std::set< int > EndcapSectorConnector::calculateTargetSectors ( int sector, bool fixedWindows ) const {
+   
+   
+   std::set <int> targetSectors;
 
    // Decode the sector integer,  and take the layer, phi and theta bin
    
@@ -34,55 +98,45 @@ std::set< int > EndcapSectorConnector::getTargetSectors ( int sector ){
    
    int layer = sector - (iTheta*_nLayers*_nDivisionsInPhi) - (iPhi*_nLayers) ; 
 
-   // search for sectors at the neighbouring theta nad phi bins
-
-   int iPhi_Up    = iPhi + 8;
-   int iPhi_Low   = iPhi - 8;
-   int iTheta_Up  = iTheta + 1; 
-   int iTheta_Low = iTheta - 1;
-   if (iTheta_Low < 0) iTheta_Low = 0;
-   if (iTheta_Up  >= int(_nDivisionsInTheta)) iTheta_Up = _nDivisionsInTheta-1;
-   
    //*************************************************************************************
 
    
    for( unsigned layerStep = 1; layerStep <= _layerStepMax; layerStep++ ){
      
-     //streamlog_out(DEBUG3) << " EndcapSectorConnector: layer " << layer << std::endl ;
      if ( layer >= int(layerStep) ){ // +1 makes sense if I use IP as innermost layer
        
        unsigned layerTarget = layer - layerStep;
+       
+       // search for sectors at the neighbouring theta and phi bins
+       int phiHalfWidth = 0;
+       int iTheta_Low = 0;
+       int iTheta_Up = 0;
+       calculateWindow( layer, layerTarget, iTheta, fixedWindows, phiHalfWidth, iTheta_Low, iTheta_Up );
+       
+       // don't go around more than once
+       int nPhiWindow = 2*phiHalfWidth + 1;
+       if( nPhiWindow > int(_nDivisionsInPhi) ) nPhiWindow = _nDivisionsInPhi;
+       
+	 for (int ip = iPhi - phiHalfWidth ; ip < iPhi - phiHalfWidth + nPhiWindow ; ip++){
 
-       //streamlog_out(DEBUG3) << " EndcapSectorConnector: layer " << layer << " layerTarget " << layerTarget << std::endl ;
-
-       //if (layerTarget >= 0 && layerTarget < 7 ){   // just a test to run cellular automaton over the whole VXD - SIT
-	 
-	 for (int ip = iPhi_Low ; ip <= iPhi_Up ; ip++){
-
-	   // catch wrap-around
-	   if (ip < 0) ip = _nDivisionsInPhi-1;          
-	   if (ip >= int(_nDivisionsInPhi)) ip = ip - _nDivisionsInPhi;
+	   // catch wrap-around (without touching the loop variable)
+	   int ipWrapped = ip % int(_nDivisionsInPhi);
+	   if (ipWrapped < 0) ipWrapped += _nDivisionsInPhi;
 	   
 	   for (int iT = iTheta_Low ; iT <= iTheta_Up ; iT++){
 	     
-	     targetSectors.insert( _sectorSystemEndcap->getSector ( layerTarget , ip , iT ) ); 
+	     targetSectors.insert( _sectorSystemEndcap->getSector ( layerTarget , ipWrapped , iT ) ); 
 	     
 	   }
 	 }
-	 //}
      }
    }
    
 
    if ( layer > 0 && ( layer <= int(_lastLayerToIP) ) ){
       
-     for (int ip = iPhi_Low ; ip <= iPhi_Up ; ip++){
-       
-       for (int iT = iTheta_Low ; iT <= iTheta_Up ; iT++){
-	 
-	 targetSectors.insert( 0 ) ;
-       }
-     }
+     targetSectors.insert( 0 ) ;
+     
    }
    
 										 
@@ -92,3 +146,103 @@ std::set< int > EndcapSectorConnector::getTargetSectors ( int sector ){
 }
 
 
+
+void EndcapSectorConnector::calculateWindow( int layer, int layerTarget, int iTheta, bool fixedWindows, 
+                                             int& phiHalfWidth, int& iThetaLow, int& iThetaHigh ) const {
+   
+   
+   // the fixed windows
+   phiHalfWidth = 8;
+   iThetaLow = iTheta - 1;
+   iThetaHigh = iTheta + 1;
+   
+   double zA = fabs( _layerZ.empty() ? 0. : _layerZ[ layer ] );
+   double zB = fabs( _layerZ.empty() ? 0. : _layerZ[ layerTarget ] );
+   
+   // Only derive the windows if the target layer is further inside. 
+   if( _usePhysicsWindows && !fixedWindows && ( zB < zA ) ){
+      
+      
+      double dPhi = 2.*M_PI / _nDivisionsInPhi;
+      
+      double cosLow = _sectorSystemEndcap->getCosThetaLow( iTheta );
+      double cosHigh = _sectorSystemEndcap->getCosThetaHigh( iTheta );
+      
+      // the |cos(theta)| in the division that is closest to 90 degrees gives the widest turn
+      double cosAbsMin = 0.;
+      if( cosLow > 0. ) cosAbsMin = cosLow;
+      else if( cosHigh < 0. ) cosAbsMin = -cosHigh;
+      
+      double turningAngle = -1.;
+      if( cosAbsMin > 0. ) turningAngle = calculateTurningAngle( zA, sqrt( 1. - cosAbsMin*cosAbsMin ) / cosAbsMin );
+      
+      
+      if( turningAngle < 0. ) phiHalfWidth = _nDivisionsInPhi; // may curl: look everywhere
+      else{
+         
+         // the azimuth of the position on a helix from the IP is half the turning angle, which grows linear with z
+         double deltaPhi = 0.5 * turningAngle * ( 1. - zB / zA );
+         phiHalfWidth = int( ceil( deltaPhi / dPhi ) ) + 1;
+         
+      }
+      
+      
+      // The position of a curved track gets closer to 90 degrees further inside, a straight one keeps its theta. 
+      // So the edge of the division away from 90 degrees stays and only the edge closer to 90 degrees is moved 
+      // (all the way to 90 degrees, if the track may curl before it gets there).
+      double cosTargetLow = cosLow;
+      double cosTargetHigh = cosHigh;
+      
+      if( cosLow > 0. ) cosTargetLow = std::min( cosLow, calculateCosThetaAt( zA, zB, cosLow ) );
+      else if( cosHigh < 0. ) cosTargetHigh = std::max( cosHigh, -calculateCosThetaAt( zA, zB, -cosHigh ) );
+      
+      // half a division more on either side for the spread of the vertex and multiple scattering
+      iThetaLow = int( floor( _sectorSystemEndcap->getThetaPosition( cosTargetLow ) - 0.5 ) );
+      iThetaHigh = int( floor( _sectorSystemEndcap->getThetaPosition( cosTargetHigh ) + 0.5 ) );
+      
+   }
+   
+   
+   if( iThetaLow < 0 ) iThetaLow = 0;
+   if( iThetaHigh >= int(_nDivisionsInTheta) ) iThetaHigh = _nDivisionsInTheta - 1;
+   
+   
+}
+
+
+
+double EndcapSectorConnector::calculateTurningAngle( double z, double tanTheta ) const {
+   
+   
+   // the distance from the z axis after turning by alpha is r = 2 R sin( alpha / 2 )
+   double sinHalfAlpha = z * tanTheta / ( 2. * _radiusMin );
+   
+   if( sinHalfAlpha > 1. ) return -1.;
+   
+   return 2. * asin( sinHalfAlpha );
+   
+   
+}
+
+
+
+double EndcapSectorConnector::calculateCosThetaAt( double z, double zTarget, double cosTheta ) const {
+   
+   
+   if( cosTheta <= 0. ) return 0.;
+   if( cosTheta >= 1. ) return 1.;
+   
+   double turningAngle = calculateTurningAngle( z, sqrt( 1. - cosTheta*cosTheta ) / cosTheta );
+   
+   if( turningAngle < 0. ) return 0.; // may curl: could be anywhere down to 90 degrees
+   
+   // the turning angle grows linear with z, at the IP tan(theta) of the position is the one of the momentum
+   double alphaTarget = turningAngle * zTarget / z;
+   double tanThetaTarget = ( zTarget > 0. ) ? 2. * _radiusMin * sin( 0.5 * alphaTarget ) / zTarget : _radiusMin * turningAngle / z;
+   
+   return 1. / sqrt( 1. + tanThetaTarget*tanThetaTarget );
+   
+   
+}
+
+
@@ -0,0 +1,176 @@
+#include "EndcapSegmentBuilder.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+
+#include "HitPairBatch.h"
+#include "PhiSortedHits.h"
+
+
+using namespace KiTrackMarlin;
+
+
+EndcapSegmentBuilder::EndcapSegmentBuilder( const std::map< int , std::vector< IHit* > >& map_sector_hits , const SectorConnectionTable& connectionTable ):
+   _map_sector_hits( map_sector_hits ),
+   _connectionTable( connectionTable ),
+   _acceptanceTable( NULL ),
+   _nPairsChecked( 0 ),
+   _nPairsRejectedByAcceptance( 0 ){
+   
+}
+
+
+void EndcapSegmentBuilder::addCriteria( const std::vector< IBatchCriterion* >& criteria ){
+   
+   _criteria.insert( _criteria.end(), criteria.begin(), criteria.end() );
+   
+}
+
+
+Automaton EndcapSegmentBuilder::get1SegAutomaton(){
+   
+   
+   Automaton automaton;
+   
+   std::map< int , std::vector< IHit* > >::const_iterator itSecHit;
+   
+   
+   // A 1-hit segment for every hit, and its azimuth and distance from the z axis for the acceptance table
+   struct HitInfo{ Segment* segment; float phi; float rho; };
+   std::unordered_map< IHit* , HitInfo > map_hit_info;
+   
+   // The phis of the hits of every sector (in the order of the hits) and the largest distance from the z axis.
+   // If the hits are sorted by phi (see sortHitsByPhi), the ones in the window of the acceptance table are found by a binary search.
+   struct SectorInfo{ std::vector< float > phis; float rhoMax; bool sortedByPhi; };
+   std::unordered_map< int , SectorInfo > map_sector_info;
+   
+   for( itSecHit = _map_sector_hits.begin(); itSecHit != _map_sector_hits.end(); itSecHit++ ){
+      
+      const std::vector< IHit* >& hits = itSecHit->second;
+      
+      SectorInfo& sectorInfo = map_sector_info[ itSecHit->first ];
+      sectorInfo.rhoMax = 0.f;
+      
+      for( unsigned i=0; i < hits.size(); i++ ){
+         
+         Segment* segment = new Segment( hits[i] );
+         segment->setLayer( hits[i]->getSectorSystem()->getLayer( itSecHit->first ) );
+         
+         automaton.addSegment( segment );
+         
+         HitInfo& info = map_hit_info[ hits[i] ];
+         info.segment = segment;
+         info.phi = getHitPhi( hits[i] );
+         info.rho = std::sqrt( hits[i]->getX()*hits[i]->getX() + hits[i]->getY()*hits[i]->getY() );
+         
+         sectorInfo.phis.push_back( info.phi );
+         sectorInfo.rhoMax = std::max( sectorInfo.rhoMax, info.rho );
+         
+      }
+      
+      sectorInfo.sortedByPhi = std::is_sorted( sectorInfo.phis.begin(), sectorInfo.phis.end() );
+      
+   }
+   
+   
+   // For every hit the pairs with the hits of the target sectors are checked in one batch
+   HitPairBatch batch;
+   std::vector< char > pass;
+   
+   for( itSecHit = _map_sector_hits.begin(); itSecHit != _map_sector_hits.end(); itSecHit++ ){
+      
+      const int* targetsBegin = _connectionTable.getTargetsBegin( itSecHit->first );
+      const int* targetsEnd = _connectionTable.getTargetsEnd( itSecHit->first );
+      
+      if( targetsBegin == targetsEnd ) continue;
+      
+      const float* slopesBegin = ( _acceptanceTable != NULL ) ? _acceptanceTable->getSlopesBegin( itSecHit->first ) : NULL;
+      
+      const std::vector< IHit* >& hitsA = itSecHit->second;
+      
+      for( unsigned iA=0; iA < hitsA.size(); iA++ ){
+         
+         IHit* hitA = hitsA[iA];
+         const HitInfo& infoA = map_hit_info[ hitA ];
+         
+         batch.clear();
+         
+         for( const int* target = targetsBegin; target != targetsEnd; target++ ){
+            
+            std::map< int , std::vector< IHit* > >::const_iterator itTarget = _map_sector_hits.find( *target );
+            if( itTarget == _map_sector_hits.end() ) continue;
+            
+            const std::vector< IHit* >& hitsB = itTarget->second;
+            
+            // the slope of the connection, a negative one accepts every pair
+            float slope = ( slopesBegin != NULL ) ? slopesBegin[ target - targetsBegin ] : -1.f;
+            
+            IndexRange ranges[2] = { IndexRange( 0, hitsB.size() ), IndexRange( 0, 0 ) };
+            unsigned nRanges = 1;
+            
+            const SectorInfo& sectorInfoB = map_sector_info[ *target ];
+            
+            if( ( slope >= 0.f ) && sectorInfoB.sortedByPhi ){
+               
+               // only the hits within the largest difference in phi the table accepts for the sector
+               float halfWidth = _acceptanceTable->getPhiHalfWidth( slope, std::max( infoA.rho, sectorInfoB.rhoMax ) );
+               nRanges = findPhiRanges( sectorInfoB.phis, infoA.phi, halfWidth, ranges );
+               
+               unsigned nInRanges = 0;
+               for( unsigned r=0; r < nRanges; r++ ) nInRanges += ranges[r].second - ranges[r].first;
+               
+               _nPairsRejectedByAcceptance += hitsB.size() - nInRanges;
+               
+            }
+            
+            for( unsigned r=0; r < nRanges; r++ ){
+               
+               for( unsigned iB = ranges[r].first; iB < ranges[r].second; iB++ ){
+                  
+                  const HitInfo& infoB = map_hit_info[ hitsB[iB] ];
+                  
+                  if( ( slope >= 0.f ) && !_acceptanceTable->isAccepted( slope, infoA.phi, infoA.rho, infoB.phi, infoB.rho ) ){
+                     
+                     _nPairsRejectedByAcceptance++;
+                     continue;
+                     
+                  }
+                  
+                  batch.add( hitA, infoA.segment, hitsB[iB], infoB.segment );
+                  
+               }
+               
+            }
+            
+         }
+         
+         if( batch.size() == 0 ) continue;
+         
+         _nPairsChecked += batch.size();
+         
+         pass.assign( batch.size(), 1 );
+         
+         for( unsigned iCrit=0; iCrit < _criteria.size(); iCrit++ ) _criteria[iCrit]->filter( batch, pass );
+         
+         
+         for( unsigned i=0; i < batch.size(); i++ ){
+            
+            if( !pass[i] ) continue;
+            
+            // the outer hit is the parent
+            batch.segA[i]->addChild( batch.segB[i] );
+            batch.segB[i]->addParent( batch.segA[i] );
+            
+         }
+         
+      }
+      
+   }
+   
+   
+   return automaton;
+   
+   
+}
+
@@ -1,6 +1,7 @@
 #include "ForwardTracking.h"
 
 #include <algorithm>
+#include <sstream>
 
 #include "EVENT/TrackerHit.h"
 #include "EVENT/Track.h"
@@ -134,6 +135,28 @@ ForwardTracking::ForwardTracking() : Processor("ForwardTracking") {
                                int( 100000 ) );
    
    
+   registerProcessorParameter( "CriteriaWarmUpEvents",
+                               "The number of events in which the time and the rejections of every criterion are measured. Afterwards the criteria are checked in the order of most rejections per ns. 0 = the order of the steering file",
+                               _criteriaWarmUpEvents,
+                               int( 0 ) );
+   
+   
+   registerProcessorParameter( "HitTimeWindowMin",
+                               "The lower ends of the time windows for hits in ns, one for all layers or one per layer. Empty = no time filter",
+                               _hitTimeWindowMin,
+                               FloatVec() );
+   
+   registerProcessorParameter( "HitTimeWindowMax",
+                               "The upper ends of the time windows for hits in ns, one for all layers or one per layer",
+                               _hitTimeWindowMax,
+                               FloatVec() );
+   
+   registerProcessorParameter( "HitTimeCorrectTOF",
+                               "Whether the time of flight from the IP (at the speed of light) is subtracted from the hit time before the window is applied",
+                               _hitTimeCorrectTOF,
+                               bool( true ) );
+   
+   
    registerProcessorParameter("MaxHitsPerSector",
                               "Maximal number of hits allowed on a sector. More will cause drop of hits in sector",
                               _maxHitsPerSector,
@@ -252,6 +275,38 @@ void ForwardTracking::init() {
    
    _sectorSystemFTD = new SectorSystemFTD( nLayers, nModules , nSensors );
    
+   _hitTimeFilter = NULL;
+   
+   // Only hits in time enter the track search, if time windows are set
+   if( !_hitTimeWindowMin.empty() || !_hitTimeWindowMax.empty() ){
+      
+      assert( _hitTimeWindowMin.size() == _hitTimeWindowMax.size() );
+      _hitTimeFilter = new HitTimeFilter( _hitTimeWindowMin, _hitTimeWindowMax, _hitTimeCorrectTOF );
+      
+   }
+   
+   // Hit tables of other processors can be reused, if they calculated layers and sectors the same way
+   std::stringstream hitTableLabel;
+   hitTableLabel << "SectorSystemFTD " << nLayers << " " << nModules << " " << nSensors;
+   _hitTableLabel = hitTableLabel.str();
+   
+   
+   // The sector connections only depend on the geometry: ask the connectors once for every sector and keep
+   // the answers in tables. (The sector system has 2 sides.)
+   unsigned nSectors = 2*nLayers*nModules*nSensors;
+   
+   unsigned layerStepMax = 1; // how many layers to go at max
+   unsigned petalStepMax = 1; // how many petals to go at max
+   unsigned lastLayerToIP = 5;// layer 1,2,3 and 4 get connected directly to the IP
+   FTDSectorConnector secCon( _sectorSystemFTD , layerStepMax , petalStepMax , lastLayerToIP );
+   _sectorConnectionTable = new SectorConnectionTable( &secCon, nSectors );
+   
+   FTDNeighborPetalSecCon neighborPetalSecCon( _sectorSystemFTD );
+   _neighborPetalTable = new SectorConnectionTable( &neighborPetalSecCon, nSectors );
+   
+   streamlog_out( DEBUG4 ) << "Sector connection tables: " << _sectorConnectionTable->getNConnections() << " connections and "
+                           << _neighborPetalTable->getNConnections() << " neighbouring petal connections between " << nSectors << " sectors\n";
+   
    
    // Get the B Field in z direction
 
@@ -309,6 +364,10 @@ void ForwardTracking::init() {
       
    }
    
+   // The criteria of all rounds are made once here, processEvent only picks the set of the round
+   _criteriaSets = makeCriteriaSets( _criteriaNames, _critMinima, _critMaxima );
+   
+   if( _criteriaWarmUpEvents > 0 ) _criteriaProfiler.startProfiling( _criteriaSets );
    
    
 
@@ -331,6 +390,15 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
  
    streamlog_out( DEBUG4 ) << "processing event number " << _nEvt << "\n";
    
+   // after the warm-up the criteria are checked in the learned order
+   if( _criteriaProfiler.isProfiling() && _nEvt >= _criteriaWarmUpEvents ){
+      
+      _criteriaProfiler.stopProfiling( _criteriaSets );
+      
+      streamlog_out( DEBUG4 ) << "The criteria were measured in " << _nEvt << " events and are ordered by rejections per ns now\n";
+      
+   }
+   
    //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
    //                                                                                                              //
    //                                 ForwardTracking                                                              //
@@ -372,6 +440,8 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
    
    streamlog_out( DEBUG4 ) << "\t\t---Reading in Collections---\n" ;
    
+   // The hit tables are shared with the other processors via the event
+   HitTableRegistry* hitTableRegistry = HitTableRegistry::getRegistry( evt );
    
    for( unsigned iCol=0; iCol < _FTDHitCollections.size(); iCol++ ){ //read in all input collections
       
@@ -396,6 +466,22 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
       streamlog_out( DEBUG4 ) << "Number of hits in collection " << _FTDHitCollections[iCol] << ": " << nHits <<"\n";
       
       
+      // If no processor made a table of the collection with the FTD sector system yet, it is made here (or
+      // completed, when the positions were already copied from another sector system)
+      HitTable* hitTable = hitTableRegistry->getTable( _FTDHitCollections[iCol], _hitTableLabel );
+      bool fillTable = ( hitTable == NULL );
+      bool addRows = false;
+      
+      if( fillTable ){
+         
+         hitTable = hitTableRegistry->createTable( _FTDHitCollections[iCol], _hitTableLabel );
+         addRows = hitTable->empty();
+         if( addRows ) hitTable->reserve( nHits );
+         
+      }
+      
+      unsigned row = 0;
+      
       for(unsigned i=0; i< nHits ; i++){
          
          
@@ -415,6 +501,25 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
          FTDHit01* ftdHit = new FTDHit01 ( trackerHit , _sectorSystemFTD );
          hitsTBD.push_back(ftdHit); //so we can easily delete every created hit afterwards
          
+         // FTDHit01 decodes layer and sector itself, the table takes them over to keep the derived quantities of all hits in one place
+         if( fillTable ){
+            
+            if( addRows ) hitTable->addHit( trackerHit );
+            hitTable->setLayer( row, ftdHit->getLayer() );
+            hitTable->setSector( row, ftdHit->getSector() );
+            
+         }
+         
+         row++;
+         
+         if( _hitTimeFilter != NULL ){
+            
+            const double* pos = trackerHit->getPosition();
+            double distance = sqrt( pos[0]*pos[0] + pos[1]*pos[1] + pos[2]*pos[2] );
+            if( !_hitTimeFilter->accept( trackerHit->getTime(), distance, ftdHit->getLayer() ) ) continue;
+            
+         }
+         
          _map_sector_hits[ ftdHit->getSector() ].push_back( ftdHit );         
          
       }
@@ -458,7 +563,7 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
       
       streamlog_out( DEBUG4 ) << "\t\t---Overlapping Hits---\n" ;
       
-      std::map< IHit* , std::vector< IHit* > > map_hitFront_hitsBack = getOverlapConnectionMap( _map_sector_hits, _sectorSystemFTD, _overlappingHitsDistMax);
+      std::map< IHit* , std::vector< IHit* > > map_hitFront_hitsBack = getOverlapConnectionMap( _map_sector_hits, _neighborPetalTable, _overlappingHitsDistMax);
       
       
      
@@ -489,8 +594,10 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
       // so the loop will be left. If however there are too many connections we stay in the loop and use 
       // (hopefully) tighter cut offs (if provided in the steering). This should prevent combinatorial breakdown
       // for very evil events.
-      while( setCriteria( round ) ){
+      while( round < _criteriaSets.size() ){
          
+         // the criteria of the round were made in init and are only read here
+         const CriteriaSet& criteria = _criteriaSets[ round ];
          
          round++; // count up the round we are in
          
@@ -504,16 +611,10 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
          //Create a segmentbuilder
          SegmentBuilder segBuilder( _map_sector_hits );
          
-         segBuilder.addCriteria ( _crit2Vec ); // Add the criteria on when to connect two hits. The vector has been filled by the method setCriteria
+         segBuilder.addCriteria ( criteria.crit2Vec ); // Add the criteria on when to connect two hits.
          
-         //Also load hit connectors
-         unsigned layerStepMax = 1; // how many layers to go at max
-         unsigned petalStepMax = 1; // how many petals to go at max
-         unsigned lastLayerToIP = 5;// layer 1,2,3 and 4 get connected directly to the IP
-         FTDSectorConnector secCon( _sectorSystemFTD , layerStepMax , petalStepMax , lastLayerToIP );
-         
-         
-         segBuilder.addSectorConnector ( & secCon ); // Add the sector connector (so the SegmentBuilder knows what hits from different sectors it is allowed to look for connections)
+         //Also load hit connectors (the table of the FTDSectorConnector is made in init)
+         segBuilder.addSectorConnector ( _sectorConnectionTable ); // Add the sector connector (so the SegmentBuilder knows what hits from different sectors it is allowed to look for connections)
          
          
          // And get out the Cellular Automaton with the 1-segments 
@@ -550,7 +651,7 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
          streamlog_out(DEBUG4) << "Automaton has " << automaton.getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
          
          automaton.clearCriteria();
-         automaton.addCriteria( _crit3Vec );  // Add the criteria for 3 hits (i.e. 2 2-hit segments )
+         automaton.addCriteria( criteria.crit3Vec );  // Add the criteria for 3 hits (i.e. 2 2-hit segments )
          
          
          // Let the automaton lengthen its 1-hit-segments to 2-hit-segments
@@ -589,7 +690,7 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
          
          
          automaton.clearCriteria();
-         automaton.addCriteria( _crit4Vec );      
+         automaton.addCriteria( criteria.crit4Vec );      
          
          
          // Lengthen the 2-hit-segments to 3-hits-segments
@@ -985,13 +1086,41 @@ void ForwardTracking::check( LCEvent * ) {}
 
 void ForwardTracking::end(){
    
- 
-   for ( unsigned i=0; i< _crit2Vec.size(); i++) delete _crit2Vec[i];
-   for ( unsigned i=0; i< _crit3Vec.size(); i++) delete _crit3Vec[i];
-   for ( unsigned i=0; i< _crit4Vec.size(); i++) delete _crit4Vec[i];
-   _crit2Vec.clear();
-   _crit3Vec.clear();
-   _crit4Vec.clear();
+   
+   if( _criteriaWarmUpEvents > 0 ){
+      
+      // if there were fewer events than the warm-up, the criteria are put back before they get deleted
+      _criteriaProfiler.stopProfiling( _criteriaSets );
+      
+      std::stringstream s;
+      _criteriaProfiler.print( s );
+      streamlog_out( MESSAGE ) << "Order of the criteria learned in " << std::min( _nEvt, _criteriaWarmUpEvents ) << " events:\n" << s.str();
+      
+   }
+   
+   deleteCriteriaSets( _criteriaSets );
+   
+   delete _sectorConnectionTable;
+   _sectorConnectionTable = NULL;
+   
+   if( _hitTimeFilter != NULL ){
+      
+      for( unsigned layer=0; layer < _hitTimeFilter->getNLayers(); layer++ ){
+         
+         unsigned long nRejected = _hitTimeFilter->getNRejected( layer );
+         unsigned long nAll = nRejected + _hitTimeFilter->getNAccepted( layer );
+         
+         if( nAll > 0 ) streamlog_out( MESSAGE ) << "Hit time filter: layer " << layer << ": " << nRejected << " of " << nAll << " hits rejected\n";
+         
+      }
+      
+      delete _hitTimeFilter;
+      _hitTimeFilter = NULL;
+      
+   }
+   
+   delete _neighborPetalTable;
+   _neighborPetalTable = NULL;
    
    delete _sectorSystemFTD;
    _sectorSystemFTD = NULL;
@@ -1008,7 +1137,7 @@ void ForwardTracking::end(){
 
 std::map< IHit* , std::vector< IHit* > > ForwardTracking::getOverlapConnectionMap( 
             const std::map< int , std::vector< IHit* > > & map_sector_hits, 
-            const SectorSystemFTD* secSysFTD,
+            const SectorConnectionTable* neighborPetalTable,
             float distMax){
    
    
@@ -1026,12 +1155,11 @@ std::map< IHit* , std::vector< IHit* > > ForwardTracking::getOverlapConnectionMa
       int sector = it->first;
       
       // get the neighbouring petals
-      FTDNeighborPetalSecCon secCon( secSysFTD );
-      std::set< int > targetSectors = secCon.getTargetSectors( sector );
+      const int* targetsEnd = neighborPetalTable->getTargetsEnd( sector );
       
       
       //for all neighbouring petals
-      for ( std::set<int>::iterator itTarg = targetSectors.begin(); itTarg!=targetSectors.end(); itTarg++ ){
+      for ( const int* itTarg = neighborPetalTable->getTargetsBegin( sector ); itTarg!=targetsEnd; itTarg++ ){
          
          
         //fg: this blows up the map with empty vectors ! 
@@ -1218,83 +1346,6 @@ std::vector < RawTrack > ForwardTracking::getRawTracksPlusOverlappingHits( RawTr
 }
 
 
-bool ForwardTracking::setCriteria( unsigned round ){
- 
-   // delete the old ones
-   for ( unsigned i=0; i< _crit2Vec.size(); i++) delete _crit2Vec[i];
-   for ( unsigned i=0; i< _crit3Vec.size(); i++) delete _crit3Vec[i];
-   for ( unsigned i=0; i< _crit4Vec.size(); i++) delete _crit4Vec[i];
-   _crit2Vec.clear();
-   _crit3Vec.clear();
-   _crit4Vec.clear();
-   
-   
-   
-   bool newValuesGotUsed = false; // if new values are used
-   
-   for( unsigned i=0; i<_criteriaNames.size(); i++ ){
-      
-      std::string critName = _criteriaNames[i];
-      
-      
-      float min = _critMinima[critName].back();
-      float max = _critMaxima[critName].back();
-      
-      
-      
-      // use the value corresponding to the round, if there are no new ones for this criterion, just do nothing (the previous value stays in place)
-      if( round + 1 <= _critMinima[critName].size() ){
-         
-         min =  _critMinima[critName][round];
-         newValuesGotUsed = true;
-         
-      }
-      
-      if( round + 1 <= _critMaxima[critName].size() ){
-         
-         max =  _critMaxima[critName][round];
-         newValuesGotUsed = true;
-         
-      }
-      
-      ICriterion* crit = Criteria::createCriterion( critName, min , max );
-      
-      // Some debug output about the created criterion
-      std::string type = crit->getType();
-      
-      streamlog_out( DEBUG3 ) <<  "Added: Criterion " << critName << " (type =  " << type 
-      << " ). Min = " << min
-      << ", Max = " << max
-      << ", round " << round << "\n";
-      
-      
-      // Add the new criterion to the corresponding vector
-      if( type == "2Hit" ){
-         
-         _crit2Vec.push_back( crit );
-         
-      }
-      else if( type == "3Hit" ){
-         
-         _crit3Vec.push_back( crit );
-         
-      }
-      else if( type == "4Hit" ){
-         
-         _crit4Vec.push_back( crit );
-         
-      }
-      else delete crit;
-      
-      
-   }
-   
-   return newValuesGotUsed;
-   
-   
-}
-
-
 void ForwardTracking::finaliseTrack( TrackImpl* trackImpl ){
    
    
@@ -0,0 +1,85 @@
+#include "GeometricAcceptanceTable.h"
+
+#include <algorithm>
+
+
+using namespace KiTrackMarlin;
+
+
+GeometricAcceptanceTable::GeometricAcceptanceTable( const SectorSystemEndcap* sectorSystemEndcap , const SectorConnectionTable& connectionTable ,
+                                                    const std::vector< float >& layerZ , double Bz , double ptMin , double phiTolerance ):
+   _sectorSystemEndcap( sectorSystemEndcap ),
+   _phiTolerance( phiTolerance ){
+
+
+   // R = pt / ( 0.3 * B ), in mm for pt in GeV and B in Tesla
+   _radiusMin = ( std::fabs( Bz ) > 0. ) ? 1000. * ptMin / ( 0.3 * std::fabs( Bz ) ) : 0.;
+
+   unsigned nSectors = connectionTable.getNSectors();
+
+   std::vector< double > rhoMax( nSectors );
+   for( unsigned sector=0; sector < nSectors; sector++ ) rhoMax[ sector ] = calculateRhoMax( sector, layerZ );
+
+
+   _offsets.push_back( 0 );
+
+   for( unsigned sector=0; sector < nSectors; sector++ ){
+
+      const int* targetsEnd = connectionTable.getTargetsEnd( sector );
+
+      for( const int* target = connectionTable.getTargetsBegin( sector ); target != targetsEnd; target++ ){
+
+         double slope = -1.;
+
+         if( ( _radiusMin > 0. ) && ( rhoMax[ sector ] >= 0. ) && ( rhoMax[ *target ] >= 0. ) ){
+
+            // the slope of asin( r / 2R ) at the largest r of the two sectors
+            double x = std::max( rhoMax[ sector ], rhoMax[ *target ] ) / ( 2. * _radiusMin );
+
+            if( x < 1. ) slope = 1. / ( 2. * _radiusMin * std::sqrt( 1. - x*x ) );
+
+         }
+
+         _slopes.push_back( slope );
+
+      }
+
+      _offsets.push_back( _slopes.size() );
+
+   }
+
+
+}
+
+
+unsigned GeometricAcceptanceTable::getNRestrictedConnections() const {
+
+   return std::count_if( _slopes.begin(), _slopes.end(), []( float slope ){ return slope >= 0.f; } );
+
+}
+
+
+double GeometricAcceptanceTable::calculateRhoMax( int sector , const std::vector< float >& layerZ ) const {
+
+
+   unsigned layer = _sectorSystemEndcap->getLayer( sector );
+   unsigned iTheta = _sectorSystemEndcap->getTheta( sector );
+
+   // the IP (layer 0) or a layer without a z position
+   if( ( layer == 0 ) || ( layer >= layerZ.size() ) ) return -1.;
+
+   double cosLow = _sectorSystemEndcap->getCosThetaLow( iTheta );
+   double cosHigh = _sectorSystemEndcap->getCosThetaHigh( iTheta );
+
+   // the |cos(theta)| in the division that is closest to 90 degrees gives the largest r
+   double cosAbsMin = 0.;
+   if( cosLow > 0. ) cosAbsMin = cosLow;
+   else if( cosHigh < 0. ) cosAbsMin = -cosHigh;
+
+   if( cosAbsMin <= 0. ) return -1.;
+
+   return std::fabs( layerZ[ layer ] ) * std::sqrt( 1. - cosAbsMin*cosAbsMin ) / cosAbsMin;
+
+
+}
+
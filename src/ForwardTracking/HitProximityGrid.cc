@@ -0,0 +1,77 @@
+#include "HitProximityGrid.h"
+
+#include <cmath>
+
+
+using namespace KiTrackMarlin;
+
+
+HitProximityGrid::HitProximityGrid( double distMax ):
+   _distMax( distMax ){
+
+}
+
+
+void HitProximityGrid::add( IHit* hit ){
+
+   _cells[ getCellKey( getCellIndex( hit->getX() ), getCellIndex( hit->getY() ), getCellIndex( hit->getZ() ) ) ].push_back( hit );
+
+}
+
+
+bool HitProximityGrid::hasCloseHit( double x , double y , double z , int sector ) const {
+
+
+   long long ix = getCellIndex( x );
+   long long iy = getCellIndex( y );
+   long long iz = getCellIndex( z );
+
+   double distMax2 = _distMax*_distMax;
+
+   for( long long jx = ix-1; jx <= ix+1; jx++ ){
+      for( long long jy = iy-1; jy <= iy+1; jy++ ){
+         for( long long jz = iz-1; jz <= iz+1; jz++ ){
+
+            std::unordered_map< long long , std::vector< IHit* > >::const_iterator it = _cells.find( getCellKey( jx, jy, jz ) );
+            if( it == _cells.end() ) continue;
+
+            const std::vector< IHit* >& hits = it->second;
+
+            for( unsigned i=0; i < hits.size(); i++ ){
+
+               if( hits[i]->getSector() != sector ) continue;
+
+               double dx = hits[i]->getX() - x;
+               double dy = hits[i]->getY() - y;
+               double dz = hits[i]->getZ() - z;
+
+               if( dx*dx + dy*dy + dz*dz < distMax2 ) return true;
+
+            }
+
+         }
+      }
+   }
+
+   return false;
+
+
+}
+
+
+long long HitProximityGrid::getCellIndex( double coordinate ) const {
+
+   return (long long)( std::floor( coordinate / _distMax ) );
+
+}
+
+
+long long HitProximityGrid::getCellKey( long long ix , long long iy , long long iz ){
+
+   // 21 bits per axis
+   const long long mask = ( 1LL << 21 ) - 1;
+
+   return ( ( ix & mask ) << 42 ) | ( ( iy & mask ) << 21 ) | ( iz & mask );
+
+}
+
@@ -0,0 +1,82 @@
+#include "HitTable.h"
+
+#include <cmath>
+
+
+using namespace KiTrackMarlin;
+
+
+void HitTable::clear(){
+
+   _x.clear();
+   _y.clear();
+   _z.clear();
+   _r.clear();
+   _invR.clear();
+   _phi.clear();
+   _cosTheta.clear();
+   _layer.clear();
+   _sector.clear();
+   _trackerHit.clear();
+
+}
+
+
+void HitTable::reserve( unsigned nRows ){
+
+   _x.reserve( nRows );
+   _y.reserve( nRows );
+   _z.reserve( nRows );
+   _r.reserve( nRows );
+   _invR.reserve( nRows );
+   _phi.reserve( nRows );
+   _cosTheta.reserve( nRows );
+   _layer.reserve( nRows );
+   _sector.reserve( nRows );
+   _trackerHit.reserve( nRows );
+
+}
+
+
+void HitTable::copyRows( const HitTable& other ){
+
+   _x = other._x;
+   _y = other._y;
+   _z = other._z;
+   _r = other._r;
+   _invR = other._invR;
+   _phi = other._phi;
+   _cosTheta = other._cosTheta;
+   _layer.assign( other.size(), -1 );
+   _sector.assign( other.size(), -1 );
+   _trackerHit = other._trackerHit;
+
+}
+
+
+unsigned HitTable::addHit( TrackerHit* trackerHit ){
+
+
+   const double* pos = trackerHit->getPosition();
+
+   double r = sqrt( pos[0]*pos[0] + pos[1]*pos[1] );
+   double radius = sqrt( r*r + pos[2]*pos[2] );
+
+   double phi = atan2( pos[1], pos[0] );
+   if( phi < 0. ) phi += 2*M_PI;
+
+   _x.push_back( pos[0] );
+   _y.push_back( pos[1] );
+   _z.push_back( pos[2] );
+   _r.push_back( r );
+   _invR.push_back( r > 0. ? 1./r : 0. );
+   _phi.push_back( phi );
+   _cosTheta.push_back( radius > 0. ? pos[2]/radius : 0. );
+   _layer.push_back( -1 );
+   _sector.push_back( -1 );
+   _trackerHit.push_back( trackerHit );
+
+   return _trackerHit.size() - 1;
+
+}
+
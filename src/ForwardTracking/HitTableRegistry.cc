@@ -0,0 +1,59 @@
+#include "HitTableRegistry.h"
+
+
+using namespace KiTrackMarlin;
+
+
+HitTableRegistry::~HitTableRegistry(){
+
+   std::map< std::pair< std::string , std::string > , HitTable* >::iterator it;
+   for( it = _tables.begin(); it != _tables.end(); it++ ) delete it->second;
+
+}
+
+
+HitTableRegistry* HitTableRegistry::getRegistry( LCEvent* evt ){
+
+   HitTableRegistry* registry = evt->runtime().ext< HitTableRegistryExtension >();
+
+   if( registry == NULL ){
+
+      registry = new HitTableRegistry();
+      evt->runtime().ext< HitTableRegistryExtension >() = registry; // the event owns it from now on
+
+   }
+
+   return registry;
+
+}
+
+
+HitTable* HitTableRegistry::getTable( const std::string& colName , const std::string& label ) const {
+
+   std::map< std::pair< std::string , std::string > , HitTable* >::const_iterator it = _tables.find( std::make_pair( colName, label ) );
+
+   if( it == _tables.end() ) return NULL;
+
+   return it->second;
+
+}
+
+
+HitTable* HitTableRegistry::createTable( const std::string& colName , const std::string& label ){
+
+   HitTable* hitTable = getTable( colName, label );
+   if( hitTable != NULL ) return hitTable; // others may already use it, so it is not replaced
+
+   hitTable = new HitTable();
+
+   // the tables of a collection lie next to each other in the map
+   std::map< std::pair< std::string , std::string > , HitTable* >::iterator it = _tables.lower_bound( std::make_pair( colName, std::string() ) );
+
+   if( it != _tables.end() && it->first.first == colName ) hitTable->copyRows( *it->second );
+
+   _tables[ std::make_pair( colName, label ) ] = hitTable;
+
+   return hitTable;
+
+}
+
@@ -0,0 +1,84 @@
+#include "HitTimeFilter.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+using namespace KiTrackMarlin;
+
+
+namespace{
+
+   /** the speed of light in mm/ns */
+   const double speedOfLight = 299.792458;
+
+}
+
+
+HitTimeFilter::HitTimeFilter( const std::vector< float >& timeMin , const std::vector< float >& timeMax , bool correctTOF ):
+   _timeMin( timeMin ),
+   _timeMax( timeMax ),
+   _correctTOF( correctTOF ){
+
+   if( _timeMin.empty() || _timeMin.size() != _timeMax.size() ){
+
+      throw std::invalid_argument( "HitTimeFilter: the lower and upper ends of the time windows must be given for the same layers" );
+
+   }
+
+}
+
+
+double HitTimeFilter::getCorrectedTime( double time , double distance ) const {
+
+   if( _correctTOF ) return time - distance / speedOfLight;
+
+   return time;
+
+}
+
+
+bool HitTimeFilter::accept( double time , double distance , int layer ){
+
+
+   if( layer < 0 ) layer = 0;
+
+   unsigned iWindow = std::min( unsigned( layer ), unsigned( _timeMin.size() - 1 ) );
+
+   double t = getCorrectedTime( time, distance );
+
+   bool inTime = ( t >= _timeMin[ iWindow ] ) && ( t <= _timeMax[ iWindow ] );
+
+
+   if( unsigned( layer ) >= _nAccepted.size() ){
+
+      _nAccepted.resize( layer + 1, 0 );
+      _nRejected.resize( layer + 1, 0 );
+
+   }
+
+   if( inTime ) _nAccepted[ layer ]++;
+   else _nRejected[ layer ]++;
+
+   return inTime;
+
+}
+
+
+unsigned long HitTimeFilter::getNAccepted( int layer ) const {
+
+   if( layer < 0 || unsigned( layer ) >= _nAccepted.size() ) return 0;
+
+   return _nAccepted[ layer ];
+
+}
+
+
+unsigned long HitTimeFilter::getNRejected( int layer ) const {
+
+   if( layer < 0 || unsigned( layer ) >= _nRejected.size() ) return 0;
+
+   return _nRejected[ layer ];
+
+}
+
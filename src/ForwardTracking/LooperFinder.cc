@@ -0,0 +1,96 @@
+#include "LooperFinder.h"
+
+#include <set>
+
+
+using namespace KiTrackMarlin;
+
+
+LooperFinder::LooperFinder( const SectorSystemEndcap* sectorSystemEndcap , unsigned minHits , unsigned minLayers ):
+   _sectorSystemEndcap( sectorSystemEndcap ),
+   _minHits( minHits ),
+   _minLayers( minLayers ){
+
+}
+
+
+unsigned LooperFinder::countHitsAround( int sector , const std::map< int , std::vector< IHit* > >& map_sector_hits ) const {
+
+
+   int nPhi = _sectorSystemEndcap->getPhiSectors();
+   int nTheta = _sectorSystemEndcap->getThetaSectors();
+
+   int layer = _sectorSystemEndcap->getLayer( sector );
+   int iPhi = _sectorSystemEndcap->getPhi( sector );
+   int iTheta = _sectorSystemEndcap->getTheta( sector );
+
+   unsigned nHits = 0;
+
+   for( int iT = iTheta - 1; iT <= iTheta + 1; iT++ ){
+
+      if( iT < 0 || iT >= nTheta ) continue;
+
+      for( int dPhi = -1; dPhi <= 1; dPhi++ ){
+
+         int iP = ( iPhi + dPhi + nPhi ) % nPhi;
+
+         std::map< int , std::vector< IHit* > >::const_iterator it = map_sector_hits.find( _sectorSystemEndcap->getSector( layer, iP, iT ) );
+         if( it != map_sector_hits.end() ) nHits += it->second.size();
+
+         if( nPhi == 1 ) break; // the same sector again otherwise
+
+      }
+
+   }
+
+   return nHits;
+
+}
+
+
+unsigned LooperFinder::maskLoopers( std::map< int , std::vector< IHit* > >& map_sector_hits ,
+                                    std::map< int , std::vector< IHit* > >& map_sector_loopers ) const {
+
+
+   int nLayers = _sectorSystemEndcap->getNLayers();
+
+   // the dense sectors and the number of dense sectors per column (= sector / nLayers, as the layer is the lowest digit)
+   std::set< int > denseSectors;
+   std::map< int , unsigned > map_column_nDense;
+
+   std::map< int , std::vector< IHit* > >::const_iterator it;
+
+   for( it = map_sector_hits.begin(); it != map_sector_hits.end(); it++ ){
+
+      if( it->second.empty() || _sectorSystemEndcap->getLayer( it->first ) == 0 ) continue;
+
+      if( countHitsAround( it->first, map_sector_hits ) >= _minHits ){
+
+         denseSectors.insert( it->first );
+         map_column_nDense[ it->first / nLayers ]++;
+
+      }
+
+   }
+
+
+   unsigned nMasked = 0;
+
+   for( std::set< int >::const_iterator itDense = denseSectors.begin(); itDense != denseSectors.end(); itDense++ ){
+
+      if( map_column_nDense[ *itDense / nLayers ] < _minLayers ) continue;
+
+      std::vector< IHit* >& hits = map_sector_hits[ *itDense ];
+      std::vector< IHit* >& looperHits = map_sector_loopers[ *itDense ];
+
+      looperHits.insert( looperHits.end(), hits.begin(), hits.end() );
+      nMasked += hits.size();
+
+      map_sector_hits.erase( *itDense );
+
+   }
+
+   return nMasked;
+
+}
+
@@ -0,0 +1,76 @@
+#include "PhiSortedHits.h"
+
+#include <algorithm>
+
+
+using namespace KiTrackMarlin;
+
+
+void KiTrackMarlin::sortHitsByPhi( std::map< int , std::vector< IHit* > >& map_sector_hits ){
+   
+   
+   std::map< int , std::vector< IHit* > >::iterator it;
+   
+   for( it = map_sector_hits.begin(); it != map_sector_hits.end(); it++ ){
+      
+      std::vector< IHit* >& hits = it->second;
+      
+      // the phi of every hit is calculated only once
+      std::vector< std::pair< float , IHit* > > phiHits;
+      phiHits.reserve( hits.size() );
+      for( unsigned i=0; i < hits.size(); i++ ) phiHits.push_back( std::make_pair( getHitPhi( hits[i] ), hits[i] ) );
+      
+      // stable, so hits at the same phi keep the order they were added in
+      std::stable_sort( phiHits.begin(), phiHits.end(), []( const std::pair< float , IHit* >& a , const std::pair< float , IHit* >& b ){ return a.first < b.first; } );
+      
+      for( unsigned i=0; i < hits.size(); i++ ) hits[i] = phiHits[i].second;
+      
+   }
+   
+   
+}
+
+
+unsigned KiTrackMarlin::findPhiRanges( const std::vector< float >& phis , float phi , float halfWidth , IndexRange ranges[2] ){
+   
+   
+   const unsigned n = phis.size();
+   
+   if( !( halfWidth < float( M_PI ) ) ){
+      
+      ranges[0] = IndexRange( 0, n );
+      return 1;
+      
+   }
+   
+   float low = phi - halfWidth;
+   float high = phi + halfWidth;
+   
+   // the positions of the first phi >= x and of the first phi > x
+   auto lowerBound = [ &phis ]( float x ){ return unsigned( std::lower_bound( phis.begin(), phis.end(), x ) - phis.begin() ); };
+   auto upperBound = [ &phis ]( float x ){ return unsigned( std::upper_bound( phis.begin(), phis.end(), x ) - phis.begin() ); };
+   
+   if( low < -float( M_PI ) ){
+      
+      ranges[0] = IndexRange( 0, upperBound( high ) );
+      ranges[1] = IndexRange( lowerBound( low + float( 2.*M_PI ) ), n );
+      ranges[1].first = std::max( ranges[1].first, ranges[0].second ); // no position twice
+      return 2;
+      
+   }
+   
+   if( high > float( M_PI ) ){
+      
+      ranges[0] = IndexRange( 0, upperBound( high - float( 2.*M_PI ) ) );
+      ranges[1] = IndexRange( lowerBound( low ), n );
+      ranges[1].first = std::max( ranges[1].first, ranges[0].second ); // no position twice
+      return 2;
+      
+   }
+   
+   ranges[0] = IndexRange( lowerBound( low ), upperBound( high ) );
+   return 1;
+   
+   
+}
+
@@ -0,0 +1,105 @@
+#include "PrecisionValidator.h"
+
+
+using namespace KiTrackMarlin;
+
+
+void PrecisionValidator::record( const std::string& checkName , unsigned long nDecisions , unsigned long nDiffering ){
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   Decisions& decisions = _decisions[ checkName ];
+   decisions.nDecisions += nDecisions;
+   decisions.nDiffering += nDiffering;
+
+}
+
+
+void PrecisionValidator::addExample( const std::string& checkName , const std::string& description ){
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   std::vector< std::string >& examples = _decisions[ checkName ].examples;
+   if( examples.size() < _maxExamples ) examples.push_back( description );
+
+}
+
+
+bool PrecisionValidator::wantsExample( const std::string& checkName ){
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   return _decisions[ checkName ].examples.size() < _maxExamples;
+
+}
+
+
+unsigned long PrecisionValidator::getNDecisions( const std::string& checkName ) const {
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   std::map< std::string , Decisions >::const_iterator it = _decisions.find( checkName );
+
+   return ( it != _decisions.end() ) ? it->second.nDecisions : 0;
+
+}
+
+
+unsigned long PrecisionValidator::getNDiffering( const std::string& checkName ) const {
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   std::map< std::string , Decisions >::const_iterator it = _decisions.find( checkName );
+
+   return ( it != _decisions.end() ) ? it->second.nDiffering : 0;
+
+}
+
+
+unsigned long PrecisionValidator::getNDiffering() const {
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   unsigned long nDiffering = 0;
+
+   std::map< std::string , Decisions >::const_iterator it;
+   for( it = _decisions.begin(); it != _decisions.end(); it++ ) nDiffering += it->second.nDiffering;
+
+   return nDiffering;
+
+}
+
+
+void PrecisionValidator::clear(){
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   _decisions.clear();
+
+}
+
+
+void PrecisionValidator::print( std::ostream& os ) const {
+
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   std::map< std::string , Decisions >::const_iterator it;
+
+   for( it = _decisions.begin(); it != _decisions.end(); it++ ){
+
+      const Decisions& decisions = it->second;
+
+      os << "   " << it->first << ": " << decisions.nDecisions << " decisions, " << decisions.nDiffering << " differing";
+
+      if( decisions.nDecisions > 0 ) os << " (" << 100. * decisions.nDiffering / decisions.nDecisions << "%)";
+
+      os << "\n";
+
+      for( unsigned i=0; i < decisions.examples.size(); i++ ) os << "      " << decisions.examples[i] << "\n";
+
+   }
+
+
+}
+
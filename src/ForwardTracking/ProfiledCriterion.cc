@@ -0,0 +1,106 @@
+#include "ProfiledCriterion.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+
+using namespace KiTrackMarlin;
+
+
+const unsigned ProfiledCriterion::_timingInterval = 16;
+
+
+ProfiledCriterion::ProfiledCriterion( ICriterion* criterion ):
+   _criterion( criterion ),
+   _nCalls( 0 ),
+   _nRejected( 0 ),
+   _nTimedCalls( 0 ),
+   _time( 0 ){
+   
+   
+   _name = criterion->getName();
+   _type = criterion->getType();
+   
+   _saveValues = false;
+   
+   
+}
+
+
+bool ProfiledCriterion::areCompatible( Segment* parent , Segment* child ){
+   
+   
+   bool compatible = true;
+   
+   if( _nCalls++ % _timingInterval == 0 ){
+      
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      
+      compatible = _criterion->areCompatible( parent, child );
+      
+      std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+      
+      _time += std::chrono::duration_cast< std::chrono::nanoseconds >( stop - start ).count();
+      _nTimedCalls++;
+      
+   }
+   else compatible = _criterion->areCompatible( parent, child );
+   
+   if( !compatible ) _nRejected++;
+   
+   return compatible;
+   
+   
+}
+
+
+double ProfiledCriterion::getTimePerCall() const {
+   
+   if( _nTimedCalls == 0 ) return 0.;
+   
+   double timePerCall = double( _time ) / double( _nTimedCalls ) - getClockOverhead();
+   
+   // at least 1 ns, calls faster than the resolution of the clock would give nothing otherwise
+   return std::max( timePerCall, 1. );
+   
+}
+
+
+double ProfiledCriterion::getRejectionPerTime() const {
+   
+   if( _nCalls == 0 || _nTimedCalls == 0 ) return 0.;
+   
+   return double( _nRejected ) / double( _nCalls ) / getTimePerCall();
+   
+}
+
+
+double ProfiledCriterion::getClockOverhead(){
+   
+   
+   // the median of reading the clock twice in a row, measured at the first use
+   static const double overhead = [](){
+      
+      std::vector< long long > times( 1001 );
+      
+      for( unsigned i=0; i < times.size(); i++ ){
+         
+         std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+         std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+         
+         times[i] = std::chrono::duration_cast< std::chrono::nanoseconds >( stop - start ).count();
+         
+      }
+      
+      std::nth_element( times.begin(), times.begin() + times.size()/2, times.end() );
+      
+      return double( times[ times.size()/2 ] );
+      
+   }();
+   
+   return overhead;
+   
+   
+}
+
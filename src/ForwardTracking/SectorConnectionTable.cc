@@ -0,0 +1,70 @@
+#include "SectorConnectionTable.h"
+
+#include <cstddef>
+
+
+using namespace KiTrackMarlin;
+
+
+SectorConnectionTable::SectorConnectionTable(){
+
+   _offsets.push_back( 0 );
+
+}
+
+
+SectorConnectionTable::SectorConnectionTable( ISectorConnector* connector , unsigned nSectors ){
+
+   _offsets.reserve( nSectors + 1 );
+   _offsets.push_back( 0 );
+
+   for( unsigned sector = 0; sector < nSectors; sector++ ){
+
+      appendSector( connector->getTargetSectors( sector ) );
+
+   }
+
+}
+
+
+void SectorConnectionTable::appendSector( const std::set< int >& targetSectors ){
+
+   _targets.insert( _targets.end(), targetSectors.begin(), targetSectors.end() );
+   _offsets.push_back( _targets.size() );
+
+}
+
+
+const int* SectorConnectionTable::getTargetsBegin( int sector ) const {
+
+   if( !isInTable( sector ) || _targets.empty() ) return NULL;
+
+   return &_targets[0] + _offsets[ sector ];
+
+}
+
+
+const int* SectorConnectionTable::getTargetsEnd( int sector ) const {
+
+   if( !isInTable( sector ) || _targets.empty() ) return NULL;
+
+   return &_targets[0] + _offsets[ sector + 1 ];
+
+}
+
+
+unsigned SectorConnectionTable::getNTargets( int sector ) const {
+
+   if( !isInTable( sector ) ) return 0;
+
+   return _offsets[ sector + 1 ] - _offsets[ sector ];
+
+}
+
+
+std::set< int > SectorConnectionTable::getTargetSectors ( int sector ){
+
+   return std::set< int >( getTargetsBegin( sector ), getTargetsEnd( sector ) );
+
+}
+
@@ -2,19 +2,102 @@
 
 #include <sstream>
 #include <cmath>
+#include <stdexcept>
 
 using namespace KiTrackMarlin;
 
 
 SectorSystemEndcap::SectorSystemEndcap( unsigned nLayers, unsigned nDivisionsInPhi, unsigned nDivisionsInTheta ){   
 
+  init( nLayers, nDivisionsInPhi, nDivisionsInTheta );
+  
+  _uniformTheta = true ;
+  _thetaLookupScale = 0. ;
+  
+  for( unsigned i=0; i <= _nDivisionsInTheta; i++ ) _cosThetaBoundaries.push_back( -1. + i / _cosThetaScale );
+   
+}
+
+
+SectorSystemEndcap::SectorSystemEndcap( unsigned nLayers, unsigned nDivisionsInPhi, const std::vector< double >& cosThetaBoundaries ){   
+
+  if( cosThetaBoundaries.size() < 2 || cosThetaBoundaries.front() != -1. || cosThetaBoundaries.back() != 1. ){
+    
+    throw std::invalid_argument( "SectorSystemEndcap: the boundaries in cos(theta) have to go from -1 to 1" );
+    
+  }
+  
+  for( unsigned i=1; i < cosThetaBoundaries.size(); i++ ){
+    
+    if( !( cosThetaBoundaries[i] > cosThetaBoundaries[i-1] ) ){
+      
+      std::stringstream s;
+      s << "SectorSystemEndcap: the boundaries in cos(theta) have to be strictly increasing, but boundary " << i 
+        << " (" << cosThetaBoundaries[i] << ") is not above boundary " << i-1 << " (" << cosThetaBoundaries[i-1] << ")";
+      throw std::invalid_argument( s.str() );
+      
+    }
+    
+  }
+  
+  init( nLayers, nDivisionsInPhi, cosThetaBoundaries.size() - 1 );
+  
+  _uniformTheta = false ;
+  _cosThetaBoundaries = cosThetaBoundaries ;
+  
+  // a fine grid, so that a cell rarely contains a boundary
+  unsigned nCells = 64*_nDivisionsInTheta ;
+  _thetaLookupScale = nCells/2.0 ;
+  
+  unsigned theta = 0;
+  
+  for( unsigned cell=0; cell < nCells; cell++ ){
+    
+    double cosTheta = -1. + cell / _thetaLookupScale ;
+    while( theta + 1 < _nDivisionsInTheta && cosTheta >= _cosThetaBoundaries[ theta + 1 ] ) theta++ ;
+    
+    _thetaLookup.push_back( theta );
+    
+  }
+   
+}
+
+
+void SectorSystemEndcap::init( unsigned nLayers, unsigned nDivisionsInPhi, unsigned nDivisionsInTheta ){
+
   _nLayers = nLayers;
   _nDivisionsInPhi = nDivisionsInPhi ;
   _nDivisionsInTheta = nDivisionsInTheta ;
   _sectorMax = _nLayers + _nLayers*_nDivisionsInPhi + _nLayers*_nDivisionsInPhi*_nDivisionsInTheta ;
+  
+  _nLayersTimesPhi = _nLayers*_nDivisionsInPhi ;
+  _phiScale = _nDivisionsInPhi/(2*M_PI) ;
+  _cosThetaScale = _nDivisionsInTheta/2.0 ;
+  _nOutOfRange = 0 ;
    
 }
 
+
+double SectorSystemEndcap::getThetaPosition( double cosTheta ) const noexcept {
+  
+  if( _uniformTheta ) return ( cosTheta + 1.0 ) * _cosThetaScale ;
+  
+  const std::vector< double >& b = _cosThetaBoundaries ;
+  
+  // continue the first and last division (this also passes nan on)
+  if( !( cosTheta >= -1. ) ) return ( cosTheta + 1. ) / ( b[1] - b[0] ) ;
+  if( cosTheta >= 1. ) return _nDivisionsInTheta + ( cosTheta - 1. ) / ( b[ _nDivisionsInTheta ] - b[ _nDivisionsInTheta - 1 ] ) ;
+  
+  unsigned cell = unsigned( ( cosTheta + 1. ) * _thetaLookupScale ) ;
+  if( cell >= _thetaLookup.size() ) cell = _thetaLookup.size() - 1 ;
+  
+  unsigned theta = _thetaLookup[ cell ] ;
+  while( theta + 1 < _nDivisionsInTheta && cosTheta >= b[ theta + 1 ] ) theta++ ;
+  
+  return theta + ( cosTheta - b[ theta ] ) / ( b[ theta + 1 ] - b[ theta ] ) ;
+  
+}
+
 unsigned SectorSystemEndcap::getNLayers() const {
 
   return _nLayers ;
@@ -35,44 +118,35 @@ unsigned SectorSystemEndcap::getThetaSectors() const {
 } 
   
 
-unsigned SectorSystemEndcap::getLayer( int sector ) const {
-  
-  //std::cout << " SectorSystemEndcap::getLayer  total no of layers = " << _nLayers << " n divisions in phi = " << _nDivisionsInPhi << " sector = " << sector << std::endl ;
+unsigned SectorSystemEndcap::getLayer( int sector ) const noexcept {
   
-  int theta = sector/(_nLayers*_nDivisionsInPhi) ;
-  
-  int phi = ((sector - (theta*_nLayers*_nDivisionsInPhi)) / _nLayers) ;
-  
-  int Layer = sector - (theta*_nLayers*_nDivisionsInPhi) - (phi*_nLayers) ; 
-
-  //std::cout << " SectorSystemEndcap::getLayer " << Layer << " total no of layers = " << _nLayers << " iPhi = " << phi << " iTheta = " << theta << " n divisions in phi = " << _nDivisionsInPhi << " sector = " << sector << std::endl ;
-  
-  return Layer ;
+  return unsigned( sector ) % _nLayers ;
   
 }
 
 
-unsigned SectorSystemEndcap::getPhi( int sector) const {
+unsigned SectorSystemEndcap::getPhi( int sector) const noexcept {
 
-  int theta = sector/(_nLayers*_nDivisionsInPhi) ;
-
-  int Phi = ((sector - (theta*_nLayers*_nDivisionsInPhi)) / _nLayers) ;
-
-  //std::cout << " SectorSystemEndcap::getPhi " << Phi << std::endl ;
-   
-  return Phi ;
+  return ( unsigned( sector ) / _nLayers ) % _nDivisionsInPhi ;
    
 }
 
 
-unsigned SectorSystemEndcap::getTheta( int sector ) const {
+unsigned SectorSystemEndcap::getTheta( int sector ) const noexcept {
 
-   int Theta = sector/(_nLayers*_nDivisionsInPhi) ;
+  return unsigned( sector ) / _nLayersTimesPhi ;
+      
+}
 
-   //std::cout << " SectorSystemEndcap::getTheta " << Theta << std::endl ;
 
-   return Theta ;
-      
+void SectorSystemEndcap::decodeSector( int sector, unsigned& layer, unsigned& phi, unsigned& theta ) const noexcept {
+  
+  unsigned layerAndPhi = unsigned( sector ) % _nLayersTimesPhi ;
+  
+  theta = unsigned( sector ) / _nLayersTimesPhi ;
+  phi = layerAndPhi / _nLayers ;
+  layer = layerAndPhi % _nLayers ;
+  
 }
 
 
@@ -119,10 +193,8 @@ int SectorSystemEndcap::getSector( int layer , int phi , int theta ) const {
 int SectorSystemEndcap::getSector( int layer , double phi , double cosTheta ) const {
   
 
-  double _dPhi = (2*M_PI)/_nDivisionsInPhi;
-  double _dTheta = 2.0/_nDivisionsInTheta;
-  int iPhi = int(phi / _dPhi);
-  int iTheta = int ((cosTheta + double(1.0))/_dTheta);
+  int iPhi = int(phi * _phiScale);
+  int iTheta = int ( getThetaPosition( cosTheta ) );
 
   //std::cout << "getting sector : layer " << layer << " phi " << iPhi << " theta " << iTheta << std::endl ;
 
@@ -163,6 +235,34 @@ int SectorSystemEndcap::getSector( int layer , double phi , double cosTheta ) co
 
 
 
+int SectorSystemEndcap::getSectorClamped( int layer , double phi , double cosTheta ) const noexcept {
+  
+  
+  bool outOfRange = false;
+  
+  if ( layer < 0 ){ layer = 0; outOfRange = true; }
+  else if ( layer >= int(_nLayers) ){ layer = _nLayers - 1; outOfRange = true; }
+  
+  double phiDivision = phi * _phiScale ;
+  int iPhi = 0;
+  if ( !( phiDivision >= 0. ) ) outOfRange = true; // also catches nan
+  else if ( phiDivision >= _nDivisionsInPhi ){ iPhi = _nDivisionsInPhi - 1; outOfRange = true; }
+  else iPhi = int( phiDivision );
+  
+  double thetaDivision = getThetaPosition( cosTheta ) ;
+  int iTheta = 0;
+  if ( !( thetaDivision >= 0. ) ) outOfRange = true;
+  else if ( thetaDivision >= _nDivisionsInTheta ){ iTheta = _nDivisionsInTheta - 1; outOfRange = true; }
+  else iTheta = int( thetaDivision );
+  
+  if ( outOfRange ) _nOutOfRange++ ;
+  
+  return layer + _nLayersTimesPhi*iTheta + _nLayers*iPhi ;
+  
+}
+
+
+
 void SectorSystemEndcap::checkSectorIsInRange( int sector ) const {
 
 
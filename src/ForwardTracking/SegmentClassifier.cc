@@ -0,0 +1,476 @@
+#include "SegmentClassifier.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+
+using namespace KiTrackMarlin;
+
+
+namespace{
+
+
+   /** The lines of a classifier file, split into words, without comments and empty lines */
+   struct ClassifierFile{
+
+      std::string fileName;
+      std::vector< std::vector< std::string > > lines;
+      std::vector< unsigned > lineNumbers;
+
+      /** the next line to read and the next word in it (for numbers) */
+      unsigned iLine;
+      unsigned iWord;
+
+
+      /** @throws std::runtime_error with the file name and the current line */
+      void fail( const std::string& what ) const {
+
+         std::stringstream s;
+         // the line read last, or the one the numbers are read from
+         unsigned i = ( iWord > 0 ) ? iLine + 1 : iLine;
+
+         s << "SegmentClassifier: " << fileName;
+         if( i > 0 && i <= lines.size() ) s << ", line " << lineNumbers[ i - 1 ];
+         s << ": " << what;
+
+         throw std::runtime_error( s.str() );
+
+      }
+
+      float toFloat( const std::string& word ) const {
+
+         std::stringstream s( word );
+         float value;
+
+         if( !( s >> value ) || !s.eof() ) fail( "\"" + word + "\" is not a number" );
+
+         return value;
+
+      }
+
+      /** @return the next line, it has to start with the keyword and have at least minWords words after it */
+      const std::vector< std::string >& readLine( const std::string& keyword , unsigned minWords ){
+
+         if( iWord > 0 ) fail( "more numbers than expected" );
+         if( iLine >= lines.size() ) fail( "expected \"" + keyword + "\", but the file ended" );
+
+         const std::vector< std::string >& line = lines[ iLine++ ];
+
+         if( line[0] != keyword ) fail( "expected \"" + keyword + "\", found \"" + line[0] + "\"" );
+         if( line.size() < minWords + 1 ) fail( "\"" + keyword + "\" needs a value" );
+
+         return line;
+
+      }
+
+      /** @return the next n numbers, that can be spread over several lines */
+      std::vector< float > readNumbers( unsigned n ){
+
+         std::vector< float > numbers;
+
+         while( numbers.size() < n ){
+
+            if( iLine >= lines.size() ) fail( "the file ended before all numbers were read" );
+
+            const std::vector< std::string >& line = lines[ iLine ];
+
+            numbers.push_back( toFloat( line[ iWord++ ] ) );
+
+            if( iWord == line.size() ){
+
+               iLine++;
+               iWord = 0;
+
+            }
+
+         }
+
+         return numbers;
+
+      }
+
+      /** @return whether all lines were read */
+      bool atEnd() const { return iLine >= lines.size() && iWord == 0; }
+
+      bool nextIs( const std::string& keyword ) const { return iWord == 0 && iLine < lines.size() && lines[ iLine ][0] == keyword; }
+
+   };
+
+
+   MLPSegmentClassifier::Activation toActivation( const ClassifierFile& file , const std::string& name ){
+
+      if( name == "linear" ) return MLPSegmentClassifier::LINEAR;
+      if( name == "relu" ) return MLPSegmentClassifier::RELU;
+      if( name == "tanh" ) return MLPSegmentClassifier::TANH;
+      if( name == "sigmoid" ) return MLPSegmentClassifier::SIGMOID;
+
+      file.fail( "unknown activation \"" + name + "\"" );
+
+      return MLPSegmentClassifier::LINEAR;
+
+   }
+
+
+}
+
+
+SegmentClassifier* SegmentClassifier::readFile( const std::string& fileName ){
+
+
+   std::ifstream in( fileName.c_str() );
+
+   if( !in ) throw std::runtime_error( "SegmentClassifier: can't open the file " + fileName );
+
+
+   ClassifierFile file;
+   file.fileName = fileName;
+   file.iLine = 0;
+   file.iWord = 0;
+
+   std::string text;
+   unsigned lineNumber = 0;
+
+   while( std::getline( in, text ) ){
+
+      lineNumber++;
+
+      std::string::size_type comment = text.find( '#' );
+      if( comment != std::string::npos ) text.erase( comment );
+
+      std::stringstream s( text );
+      std::vector< std::string > words;
+      std::string word;
+      while( s >> word ) words.push_back( word );
+
+      if( words.empty() ) continue;
+
+      file.lines.push_back( words );
+      file.lineNumbers.push_back( lineNumber );
+
+   }
+
+
+   // the header
+   std::string type = file.readLine( "classifier", 1 )[1];
+
+   float nHits = file.toFloat( file.readLine( "hits", 1 )[1] );
+   if( nHits != 2.f && nHits != 3.f && nHits != 4.f ) file.fail( "the number of hits must be 2, 3 or 4" );
+
+   float threshold = file.toFloat( file.readLine( "threshold", 1 )[1] );
+
+   const std::vector< std::string >& criteriaLine = file.readLine( "criteria", 1 );
+   std::vector< std::string > criteriaNames( criteriaLine.begin() + 1, criteriaLine.end() );
+
+   const std::vector< std::string >& featuresLine = file.readLine( "features", 1 );
+   std::vector< std::string > featureNames( featuresLine.begin() + 1, featuresLine.end() );
+
+   unsigned nFeatures = featureNames.size();
+
+
+   // the model
+   try{
+
+      if( type == "MLP" ){
+
+         std::vector< float > offsets;
+         std::vector< float > scales;
+
+         if( file.nextIs( "offsets" ) ){
+
+            const std::vector< std::string >& line = file.readLine( "offsets", nFeatures );
+            for( unsigned i=1; i < line.size(); i++ ) offsets.push_back( file.toFloat( line[i] ) );
+
+         }
+
+         if( file.nextIs( "scales" ) ){
+
+            const std::vector< std::string >& line = file.readLine( "scales", nFeatures );
+            for( unsigned i=1; i < line.size(); i++ ) scales.push_back( file.toFloat( line[i] ) );
+
+         }
+
+         std::vector< MLPSegmentClassifier::Layer > layers;
+
+         while( file.nextIs( "layer" ) ){
+
+            const std::vector< std::string >& line = file.readLine( "layer", 3 );
+
+            MLPSegmentClassifier::Layer layer;
+            layer.nOut = unsigned( file.toFloat( line[1] ) );
+            layer.nIn = unsigned( file.toFloat( line[2] ) );
+            layer.activation = toActivation( file, line[3] );
+
+            layer.weights = file.readNumbers( layer.nOut * layer.nIn );
+            layer.biases = file.readNumbers( layer.nOut );
+
+            layers.push_back( layer );
+
+         }
+
+         if( !file.atEnd() ) file.readLine( "layer", 3 ); // fails
+
+         return new MLPSegmentClassifier( unsigned( nHits ), threshold, criteriaNames, featureNames, offsets, scales, layers );
+
+      }
+      else if( type == "BDT" ){
+
+         std::vector< BDTSegmentClassifier::Tree > trees;
+
+         while( !file.atEnd() ){
+
+            unsigned nNodes = unsigned( file.toFloat( file.readLine( "tree", 1 )[1] ) );
+
+            std::vector< float > numbers = file.readNumbers( 5 * nNodes );
+            if( !file.atEnd() && !file.nextIs( "tree" ) ) file.readLine( "tree", 1 ); // fails
+
+            BDTSegmentClassifier::Tree tree( nNodes );
+
+            for( unsigned i=0; i < nNodes; i++ ){
+
+               tree[i].feature = int( numbers[ 5*i ] );
+               tree[i].cut = numbers[ 5*i + 1 ];
+               tree[i].left = unsigned( numbers[ 5*i + 2 ] );
+               tree[i].right = unsigned( numbers[ 5*i + 3 ] );
+               tree[i].value = numbers[ 5*i + 4 ];
+
+            }
+
+            trees.push_back( tree );
+
+         }
+
+         return new BDTSegmentClassifier( unsigned( nHits ), threshold, criteriaNames, featureNames, trees );
+
+      }
+
+   }
+   catch( std::invalid_argument& e ){
+
+      file.fail( e.what() );
+
+   }
+
+
+   file.iLine = 1;
+   file.iWord = 0;
+   file.fail( "unknown classifier \"" + type + "\", known are MLP and BDT" );
+
+   return NULL;
+
+
+}
+
+
+SegmentClassifier::SegmentClassifier( unsigned nHits , float threshold , const std::vector< std::string >& criteriaNames ,
+                                      const std::vector< std::string >& featureNames ):
+   _nHits( nHits ),
+   _threshold( threshold ),
+   _criteriaNames( criteriaNames ),
+   _featureNames( featureNames ){
+
+}
+
+
+float SegmentClassifier::score( const std::vector< float >& features ) const {
+
+   if( features.size() != getNFeatures() ) throw std::invalid_argument( "SegmentClassifier::score: wrong number of features" );
+
+   float result = 0.f;
+   score( features.data(), 1, &result );
+
+   return result;
+
+}
+
+
+MLPSegmentClassifier::MLPSegmentClassifier( unsigned nHits , float threshold , const std::vector< std::string >& criteriaNames ,
+                                            const std::vector< std::string >& featureNames ,
+                                            const std::vector< float >& offsets , const std::vector< float >& scales ,
+                                            const std::vector< Layer >& layers ):
+   SegmentClassifier( nHits, threshold, criteriaNames, featureNames ),
+   _offsets( offsets ),
+   _scales( scales ),
+   _layers( layers ){
+
+
+   if( _offsets.empty() ) _offsets.assign( getNFeatures(), 0.f );
+   if( _scales.empty() ) _scales.assign( getNFeatures(), 1.f );
+
+   if( _offsets.size() != getNFeatures() || _scales.size() != getNFeatures() ){
+
+      throw std::invalid_argument( "MLPSegmentClassifier: there must be an offset and a scale for every feature" );
+
+   }
+
+   if( _layers.empty() || _layers.back().nOut != 1 ){
+
+      throw std::invalid_argument( "MLPSegmentClassifier: the last layer must have a single output" );
+
+   }
+
+   unsigned nIn = getNFeatures();
+
+   for( unsigned i=0; i < _layers.size(); i++ ){
+
+      const Layer& layer = _layers[i];
+
+      if( layer.nIn != nIn ){
+
+         std::stringstream s;
+         s << "MLPSegmentClassifier: layer " << i << " has " << layer.nIn << " inputs, expected are " << nIn;
+         throw std::invalid_argument( s.str() );
+
+      }
+
+      if( layer.weights.size() != layer.nIn * layer.nOut || layer.biases.size() != layer.nOut ){
+
+         std::stringstream s;
+         s << "MLPSegmentClassifier: layer " << i << " needs " << layer.nIn * layer.nOut << " weights and " << layer.nOut << " biases";
+         throw std::invalid_argument( s.str() );
+
+      }
+
+      nIn = layer.nOut;
+
+   }
+
+
+}
+
+
+void MLPSegmentClassifier::score( const float* features , unsigned nPairs , float* scores ) const {
+
+
+   const unsigned nFeatures = getNFeatures();
+
+   // the whole batch goes through one layer after the other, so the weights of a layer are read once per batch
+   std::vector< float > in( nPairs * nFeatures );
+   std::vector< float > out;
+
+   for( unsigned p=0; p < nPairs; p++ ){
+
+      for( unsigned f=0; f < nFeatures; f++ ){
+
+         in[ p*nFeatures + f ] = ( features[ p*nFeatures + f ] - _offsets[f] ) * _scales[f];
+
+      }
+
+   }
+
+
+   for( unsigned l=0; l < _layers.size(); l++ ){
+
+      const Layer& layer = _layers[l];
+      const float* weights = layer.weights.data();
+
+      out.assign( nPairs * layer.nOut, 0.f );
+
+      for( unsigned p=0; p < nPairs; p++ ){
+
+         const float* x = &in[ p*layer.nIn ];
+         float* y = &out[ p*layer.nOut ];
+
+         for( unsigned o=0; o < layer.nOut; o++ ){
+
+            const float* w = weights + o*layer.nIn;
+
+            float sum = layer.biases[o];
+            for( unsigned i=0; i < layer.nIn; i++ ) sum += w[i] * x[i];
+
+            switch( layer.activation ){
+
+               case RELU:    sum = ( sum > 0.f ) ? sum : 0.f; break;
+               case TANH:    sum = std::tanh( sum ); break;
+               case SIGMOID: sum = 1.f / ( 1.f + std::exp( -sum ) ); break;
+               case LINEAR:  break;
+
+            }
+
+            y[o] = sum;
+
+         }
+
+      }
+
+      in.swap( out );
+
+   }
+
+
+   for( unsigned p=0; p < nPairs; p++ ) scores[p] = in[p];
+
+
+}
+
+
+BDTSegmentClassifier::BDTSegmentClassifier( unsigned nHits , float threshold , const std::vector< std::string >& criteriaNames ,
+                                            const std::vector< std::string >& featureNames , const std::vector< Tree >& trees ):
+   SegmentClassifier( nHits, threshold, criteriaNames, featureNames ),
+   _trees( trees ){
+
+
+   for( unsigned t=0; t < _trees.size(); t++ ){
+
+      const Tree& tree = _trees[t];
+
+      if( tree.empty() ){
+
+         std::stringstream s;
+         s << "BDTSegmentClassifier: tree " << t << " has no nodes";
+         throw std::invalid_argument( s.str() );
+
+      }
+
+      for( unsigned n=0; n < tree.size(); n++ ){
+
+         const Node& node = tree[n];
+
+         if( node.feature < 0 ) continue; // a leaf
+
+         // children after their parent: every path ends at a leaf
+         if( node.feature >= int( getNFeatures() ) || node.left <= n || node.right <= n || node.left >= tree.size() || node.right >= tree.size() ){
+
+            std::stringstream s;
+            s << "BDTSegmentClassifier: node " << n << " of tree " << t << " has a feature or a child that doesn't exist or doesn't come after it";
+            throw std::invalid_argument( s.str() );
+
+         }
+
+      }
+
+   }
+
+
+}
+
+
+void BDTSegmentClassifier::score( const float* features , unsigned nPairs , float* scores ) const {
+
+
+   const unsigned nFeatures = getNFeatures();
+
+   for( unsigned p=0; p < nPairs; p++ ) scores[p] = 0.f;
+
+   // tree after tree, so the nodes of a tree stay in the cache for the whole batch
+   for( unsigned t=0; t < _trees.size(); t++ ){
+
+      const Node* nodes = _trees[t].data();
+
+      for( unsigned p=0; p < nPairs; p++ ){
+
+         const float* x = features + p*nFeatures;
+
+         const Node* node = nodes;
+         while( node->feature >= 0 ) node = nodes + ( ( x[ node->feature ] < node->cut ) ? node->left : node->right );
+
+         scores[p] += node->value;
+
+      }
+
+   }
+
+
+}
+
@@ -0,0 +1,118 @@
+#include "SegmentGeometryCache.h"
+
+#include <cmath>
+#include <vector>
+
+
+using namespace KiTrackMarlin;
+
+
+const SegmentGeometry& SegmentGeometryCache::getGeometry( Segment* segment ){
+   
+   
+   std::unordered_map< Segment* , SegmentGeometry >::iterator it = _geometries.find( segment );
+   
+   if( it != _geometries.end() ){
+      
+      _nReused++;
+      return it->second;
+      
+   }
+   
+   SegmentGeometry& geometry = _geometries[ segment ];
+   calculateGeometry( segment, geometry );
+   
+   return geometry;
+   
+   
+}
+
+
+SegmentGeometryCache& SegmentGeometryCache::getThreadCache(){
+   
+   static thread_local SegmentGeometryCache cache;
+   
+   return cache;
+   
+}
+
+
+void SegmentGeometryCache::calculateGeometry( Segment* segment , SegmentGeometry& geometry ){
+   
+   
+   std::vector< IHit* > hits = segment->getHits();
+   
+   geometry.nHits = hits.size();
+   geometry.hasCircle = false;
+   geometry.isLine = false;
+   
+   if( hits.empty() ) return;
+   
+   
+   IHit* inner = hits[0];
+   
+   geometry.xInner = inner->getX();
+   geometry.yInner = inner->getY();
+   geometry.zInner = inner->getZ();
+   geometry.innerIsVirtual = inner->isVirtual();
+   
+   geometry.phiInner = atan2( geometry.yInner, geometry.xInner );
+   geometry.cosThetaInner = geometry.zInner / sqrt( geometry.xInner*geometry.xInner + geometry.yInner*geometry.yInner + geometry.zInner*geometry.zInner );
+   
+   
+   if( hits.size() != 2 && hits.size() != 3 ) return;
+   
+   geometry.hasCircle = true;
+   
+   // the third point: the IP for 2 hits
+   double x1 = 0.;
+   double y1 = 0.;
+   if( hits.size() == 3 ){
+      
+      x1 = hits[2]->getX();
+      y1 = hits[2]->getY();
+      
+   }
+   
+   double xb = hits[0]->getX();
+   double yb = hits[0]->getY();
+   double xc = hits[1]->getX();
+   double yc = hits[1]->getY();
+   
+   geometry.xb = xb;
+   geometry.yb = yb;
+   geometry.zb = hits[0]->getZ();
+   geometry.xc = xc;
+   geometry.yc = yc;
+   geometry.zc = hits[1]->getZ();
+   
+   
+   // the centre of the circle through (x1,y1), b and c
+   double det = 2. * ( ( xb - x1 )*( yc - y1 ) - ( yb - y1 )*( xc - x1 ) );
+   
+   if( fabs( det ) < 1e-9 ){ // a straight line
+      
+      geometry.isLine = true;
+      return;
+      
+   }
+   
+   double rb2 = ( xb - x1 )*( xb - x1 ) + ( yb - y1 )*( yb - y1 );
+   double rc2 = ( xc - x1 )*( xc - x1 ) + ( yc - y1 )*( yc - y1 );
+   
+   geometry.xCentre = x1 + ( rb2*( yc - y1 ) - rc2*( yb - y1 ) ) / det;
+   geometry.yCentre = y1 + ( rc2*( xb - x1 ) - rb2*( xc - x1 ) ) / det;
+   geometry.radius = sqrt( ( xb - geometry.xCentre )*( xb - geometry.xCentre ) + ( yb - geometry.yCentre )*( yb - geometry.yCentre ) );
+   
+   geometry.psiB = atan2( yb - geometry.yCentre, xb - geometry.xCentre );
+   double psiC = atan2( yc - geometry.yCentre, xc - geometry.xCentre );
+   
+   double deltaPsi = geometry.psiB - psiC;
+   if( deltaPsi > M_PI ) deltaPsi -= 2.*M_PI;
+   if( deltaPsi < -M_PI ) deltaPsi += 2.*M_PI;
+   
+   geometry.deltaPsi = deltaPsi;
+   
+   
+}
+
@@ -0,0 +1,169 @@
+#include "SegmentPredictionCriterion.h"
+
+#include <cmath>
+#include <sstream>
+
+
+
+using namespace KiTrackMarlin;
+
+
+SegmentPredictionCriterion::SegmentPredictionCriterion( unsigned nHits, float phiWindowMax, float cosThetaWindowMax ){
+   
+   
+   _nHits = nHits;
+   _phiWindowMax = phiWindowMax;
+   _cosThetaWindowMax = cosThetaWindowMax;
+   
+   _useFloat = false;
+   _validator = NULL;
+   
+   _name = "SegmentPrediction";
+   _type = ( nHits == 4 ) ? "4Hit" : "3Hit";
+   
+   _saveValues = false;
+   
+   
+}
+
+
+bool SegmentPredictionCriterion::areCompatible( Segment* parent , Segment* child ){
+   
+   
+   // the geometry of the parent (the circle) is the same for all its children, it is only calculated once
+   SegmentGeometryCache& cache = SegmentGeometryCache::getThreadCache();
+   
+   const SegmentGeometry& parentGeometry = cache.getGeometry( parent );
+   const SegmentGeometry& childGeometry = cache.getGeometry( child );
+   
+   if(( parentGeometry.nHits != _nHits - 1 )||( childGeometry.nHits != _nHits - 1 )){
+      
+      std::stringstream s;
+      s << "SegmentPredictionCriterion::This criterion needs 2 segments with " << _nHits - 1 << " hits each, passed was a "
+      <<  parentGeometry.nHits << " hit segment (parent) and a "
+      <<  childGeometry.nHits << " hit segment (child).";
+      
+      throw BadSegmentLength( s.str() );
+      
+   }
+   
+   
+   // the hit to predict (the innermost one of the child), with 3 hits the circle of the parent goes through the IP
+   if( childGeometry.innerIsVirtual ) return true;
+   
+   
+   double deltaPhi = 0.;
+   double deltaCosTheta = 0.;
+   bool compatible = true;
+   
+   if( _validator != NULL ){ // both precisions, compared
+      
+      double deltaPhiFloat = 0.;
+      double deltaCosThetaFloat = 0.;
+      
+      bool compatibleFloat = isInWindow< float >( parentGeometry, childGeometry, deltaPhiFloat, deltaCosThetaFloat );
+      bool compatibleDouble = isInWindow< double >( parentGeometry, childGeometry, deltaPhi, deltaCosTheta );
+      
+      bool differ = ( compatibleFloat != compatibleDouble );
+      
+      _validator->record( _name + _type, 1, differ ? 1 : 0 );
+      
+      if( differ && _validator->wantsExample( _name + _type ) ){
+         
+         std::stringstream s;
+         s.precision( 9 ); // enough to tell floats apart
+         s << "deltaPhi = " << deltaPhi << " (float " << deltaPhiFloat << "), deltaCosTheta = " << deltaCosTheta 
+           << " (float " << deltaCosThetaFloat << "): " << ( compatibleFloat ? "float passes, double rejects" : "float rejects, double passes" );
+         
+         _validator->addExample( _name + _type, s.str() );
+         
+      }
+      
+      if( _useFloat ){
+         
+         compatible = compatibleFloat;
+         deltaPhi = deltaPhiFloat;
+         deltaCosTheta = deltaCosThetaFloat;
+         
+      }
+      else compatible = compatibleDouble;
+      
+   }
+   else if( _useFloat ) compatible = isInWindow< float >( parentGeometry, childGeometry, deltaPhi, deltaCosTheta );
+   else compatible = isInWindow< double >( parentGeometry, childGeometry, deltaPhi, deltaCosTheta );
+   
+   
+   if( _saveValues ){
+      
+      _map_name_value["SegmentPrediction_deltaPhi"] = deltaPhi;
+      _map_name_value["SegmentPrediction_deltaCosTheta"] = deltaCosTheta;
+      
+   }
+   
+   
+   return compatible;
+   
+   
+}
+
+
+template< class T >
+bool SegmentPredictionCriterion::isInWindow( const SegmentGeometry& parentGeometry , const SegmentGeometry& childGeometry , 
+                                             double& deltaPhiOut , double& deltaCosThetaOut ) const {
+   
+   
+   const T pi = T( M_PI );
+   
+   T xb = T( parentGeometry.xb );
+   T yb = T( parentGeometry.yb );
+   T zb = T( parentGeometry.zb );
+   T xc = T( parentGeometry.xc );
+   T yc = T( parentGeometry.yc );
+   T zc = T( parentGeometry.zc );
+   T za = T( childGeometry.zInner );
+   
+   if( zb == zc ) return true; // no prediction in z possible
+   
+   T zRatio = ( za - zb ) / ( zb - zc );
+   
+   T xPred = 0.;
+   T yPred = 0.;
+   
+   
+   if( parentGeometry.isLine ){ // a straight line
+      
+      xPred = xb + ( xb - xc ) * zRatio;
+      yPred = yb + ( yb - yc ) * zRatio;
+      
+   }
+   else{
+      
+      // on a helix the angle around the centre changes linear with z
+      T psiA = T( parentGeometry.psiB ) + T( parentGeometry.deltaPsi ) * zRatio;
+      
+      xPred = T( parentGeometry.xCentre ) + T( parentGeometry.radius ) * std::cos( psiA );
+      yPred = T( parentGeometry.yCentre ) + T( parentGeometry.radius ) * std::sin( psiA );
+      
+   }
+   
+   
+   T deltaPhi = T( childGeometry.phiInner ) - std::atan2( yPred, xPred );
+   if( deltaPhi > pi ) deltaPhi -= 2*pi;
+   if( deltaPhi < -pi ) deltaPhi += 2*pi;
+   
+   T cosThetaPred = za / std::sqrt( xPred*xPred + yPred*yPred + za*za );
+   T deltaCosTheta = T( childGeometry.cosThetaInner ) - cosThetaPred;
+   
+   deltaPhiOut = deltaPhi;
+   deltaCosThetaOut = deltaCosTheta;
+   
+   
+   if( std::fabs( deltaPhi ) > T( _phiWindowMax ) ) return false;
+   if( std::fabs( deltaCosTheta ) > T( _cosThetaWindowMax ) ) return false;
+   
+   
+   return true;
+   
+   
+}
+
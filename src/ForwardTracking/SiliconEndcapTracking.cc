@@ -1,6 +1,11 @@
 #include "SiliconEndcapTracking.h"
 
 #include <algorithm>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+#include <sstream>
+#include <set>
 
 #include "EVENT/TrackerHit.h"
 #include "EVENT/Track.h"
@@ -42,6 +47,12 @@
 // #include "EndcapNeighborSecCon.h" // FIXME: TO BE IMPLEMENTED!!
 #include "EndcapSectorConnector.h"
 #include "EndcapHelixFitter.h"
+#include "BestFirstTrackExtractor.h"
+#include "SegmentPredictionCriterion.h"
+#include "EndcapSegmentBuilder.h"
+#include "SegmentGeometryCache.h"
+#include "PhiSortedHits.h"
+#include "BoundedQueue.h"
 
 
 using namespace lcio ;
@@ -79,6 +90,24 @@ SiliconEndcapTracking::SiliconEndcapTracking() : Processor("SiliconEndcapTrackin
 			      _nDivisionsInTheta,
 			      //int(80));
 			      int(180));
+   
+   
+   registerProcessorParameter( "ThetaBoundaries",
+                               "The boundaries of the theta divisions in cos(theta): NDivisionsInTheta + 1 values, strictly increasing from -1 to 1. If empty, the divisions are uniform in cos(theta) (or come from ThetaOccupancyProfileInput)",
+                               _thetaBoundaries,
+                               FloatVec() );
+   
+   
+   registerProcessorParameter( "ThetaOccupancyProfileInput",
+                               "A file with the occupancy of the hits in cos(theta) (see ThetaOccupancyProfileOutput): if set and ThetaBoundaries is empty, the theta divisions are made to have the same number of hits",
+                               _thetaOccupancyProfileInput,
+                               std::string( "" ) );
+   
+   
+   registerProcessorParameter( "ThetaOccupancyProfileOutput",
+                               "If set, the occupancy of the hits in cos(theta) is accumulated over the run and written to this file at the end (for ThetaOccupancyProfileInput or the ThetaBinningSuggester)",
+                               _thetaOccupancyProfileOutput,
+                               std::string( "" ) );
 
    ////////////////////////
 
@@ -166,6 +195,179 @@ SiliconEndcapTracking::SiliconEndcapTracking() : Processor("SiliconEndcapTrackin
                                int( 920 ) );
    
    
+   registerProcessorParameter( "MaxPathsPerSegment",
+                               "If > 0, raw tracks are extracted best first from the automaton and at most this many are kept per outermost segment. 0 means all paths are taken",
+                               _maxPathsPerSegment,
+                               int( 0 ) );
+   
+   
+   registerProcessorParameter( "StreamRawTracks",
+                               "Whether the raw tracks are fitted in a second thread while they are still being extracted from the automaton (only used with MaxPathsPerSegment > 0)",
+                               _streamRawTracks,
+                               bool( false ) );
+   
+   
+   registerProcessorParameter( "RawTrackQueueSize",
+                               "The maximum number of extracted raw tracks waiting for the fit with StreamRawTracks",
+                               _rawTrackQueueSize,
+                               int( 1000 ) );
+   
+   
+   registerProcessorParameter( "NPhiWedges",
+                               "If > 1, the detector is split into this many wedges in phi, whose segments and automata are made in parallel threads (the fit stays in one thread)",
+                               _nPhiWedges,
+                               int( 1 ) );
+   
+   
+   registerProcessorParameter( "PhiWedgeHalo",
+                               "The number of phi divisions each wedge extends into its neighbours, so tracks crossing the wedge borders are found",
+                               _phiWedgeHalo,
+                               int( 8 ) );
+   
+   
+   registerProcessorParameter( "LayerZPositions",
+                               "The |z| positions of the layers in mm (starting with the IP as layer 0). If set, the windows of the sector connector are derived from the field and ConnectionPtMin",
+                               _layerZPositions,
+                               FloatVec() );
+   
+   
+   registerProcessorParameter( "ConnectionPtMin",
+                               "The minimum pt in GeV of the tracks the sector connector shall connect (only used with LayerZPositions)",
+                               _connectionPtMin,
+                               float( 0.1 ) );
+   
+   
+   registerProcessorParameter( "GeometricAcceptance",
+                               "Whether pairs of hits, that differ too much in phi for a track above ConnectionPtMin from the IP, are rejected before the 2-hit criteria (only used with LayerZPositions and BatchSegmentBuilding)",
+                               _geometricAcceptance,
+                               bool( false ) );
+   
+   
+   registerProcessorParameter( "GeometricAcceptancePhiTolerance",
+                               "The difference in phi (in rad) the geometric acceptance always accepts, for the spread of the vertex and multiple scattering",
+                               _geometricAcceptancePhiTolerance,
+                               float( 0.05 ) );
+   
+   
+   IntVec subdetLayerOffsets;
+   subdetLayerOffsets.push_back( 0 );
+   subdetLayerOffsets.push_back( 0 );
+   subdetLayerOffsets.push_back( 0 );
+   subdetLayerOffsets.push_back( 6 );
+   subdetLayerOffsets.push_back( 6 );
+   subdetLayerOffsets.push_back( 8 );
+   subdetLayerOffsets.push_back( 8 );
+   
+   registerProcessorParameter( "SubdetLayerOffsets",
+                               "The offset added to the layer of a hit for every subdetector (index = subdet in the cellID), so that the layers of the subdetectors are numbered consecutively",
+                               _subdetLayerOffsets,
+                               subdetLayerOffsets );
+   
+   
+   registerProcessorParameter( "PredictionPhiWindow",
+                               "If > 0, the outer hits of a segment predict its next hit when lengthening and only hits within this window in phi (rad) are checked by the other criteria",
+                               _predictionPhiWindow,
+                               float( 0. ) );
+   
+   
+   registerProcessorParameter( "PredictionCosThetaWindow",
+                               "The window in cos(theta) around the predicted next hit of a segment (only used if PredictionPhiWindow > 0)",
+                               _predictionCosThetaWindow,
+                               float( 0.05 ) );
+   
+   
+   registerProcessorParameter( "HitTimeWindowMin",
+                               "The lower ends of the time windows for hits in ns, one for all layers or one per layer. Empty = no time filter",
+                               _hitTimeWindowMin,
+                               FloatVec() );
+   
+   registerProcessorParameter( "HitTimeWindowMax",
+                               "The upper ends of the time windows for hits in ns, one for all layers or one per layer",
+                               _hitTimeWindowMax,
+                               FloatVec() );
+   
+   registerProcessorParameter( "HitTimeCorrectTOF",
+                               "Whether the time of flight from the IP (at the speed of light) is subtracted from the hit time before the window is applied",
+                               _hitTimeCorrectTOF,
+                               bool( true ) );
+   
+   
+   registerProcessorParameter( "PassFirstRounds",
+                               "Iterative tracking: the round of the criteria (index into the Cut values) every pass starts with. After each pass the hits of the found tracks are masked for the next one. One entry = a single pass",
+                               _passFirstRounds,
+                               IntVec( 1, 0 ) );
+   
+   
+   registerProcessorParameter( "BatchSegmentBuilding",
+                               "Whether the 2-hit criteria check all pairs of a hit with the hits of its target sectors in one batch (EndcapSegmentBuilder) instead of pair by pair (KiTrack SegmentBuilder)",
+                               _batchSegmentBuilding,
+                               bool( false ) );
+   
+   
+   registerProcessorParameter( "CompiledCriteria",
+                               "Whether the 2-hit criteria are checked by a compiled pipeline, if there is one for the criteria in the steering (only with BatchSegmentBuilding)",
+                               _compiledCriteria,
+                               bool( true ) );
+   
+   
+   registerProcessorParameter( "FloatPrecisionCriteria",
+                               "Whether the 2-hit batch criteria and the segment prediction are calculated in single instead of double precision",
+                               _floatPrecisionCriteria,
+                               bool( false ) );
+   
+   
+   registerProcessorParameter( "ValidateFloatPrecision",
+                               "Whether the 2-hit batch criteria and the segment prediction are calculated in both precisions and the differing decisions are reported at the end (the decisions of FloatPrecisionCriteria are used)",
+                               _validateFloatPrecision,
+                               bool( false ) );
+   
+   
+   registerProcessorParameter( "SegmentClassifierMode",
+                               "How the classifiers of SegmentClassifierFiles are used: Off, Before (in front of the criteria of the steering) or Instead (replacing the criteria with as many hits)",
+                               _segmentClassifierMode,
+                               std::string( "Off" ) );
+   
+   
+   registerProcessorParameter( "SegmentClassifierFiles",
+                               "Files with classifiers (MLP or BDT, trained on the output of the TrueTrackCritAnalyser) that decide the connections of segments, at most one per number of hits",
+                               _segmentClassifierFiles,
+                               std::vector< std::string >() );
+   
+   
+   registerProcessorParameter( "CriteriaWarmUpEvents",
+                               "The number of events in which the time and the rejections of every criterion are measured. Afterwards the criteria are checked in the order of most rejections per ns. 0 = the order of the steering file",
+                               _criteriaWarmUpEvents,
+                               int( 0 ) );
+   
+   
+   registerProcessorParameter( "LooperMinHits",
+                               "The minimum number of hits in a sector and its phi and theta neighbours for the sector to count as dense in the looper search, 0 = no looper search",
+                               _looperMinHits,
+                               int( 0 ) );
+   
+   registerProcessorParameter( "LooperMinLayers",
+                               "The minimum number of dense sectors with the same phi and theta for their hits to be taken out of the track search as looper hits",
+                               _looperMinLayers,
+                               int( 3 ) );
+   
+   registerProcessorParameter( "LooperPassMaxHits",
+                               "The looper hits are searched for tracks on their own, if there are at most this many of them. 0 = they are not searched",
+                               _looperPassMaxHits,
+                               int( 0 ) );
+   
+   
+   registerProcessorParameter( "SuppressCombinedHits",
+                               "Whether hits that were combined into a hit of another input collection (e.g. strip hits of a spacepoint, found via getRawHits) are dropped",
+                               _suppressCombinedHits,
+                               bool( false ) );
+   
+   
+   registerProcessorParameter( "DuplicateHitDistMax",
+                               "Hits closer than this to a hit already read in (in the same sector) are dropped as duplicates, 0 = no position check",
+                               _duplicateHitDistMax,
+                               double( 0. ) );
+   
+   
    registerProcessorParameter("MaxHitsPerSector",
                               "Maximal number of hits allowed on a sector. More will cause drop of hits in sector",
                               _maxHitsPerSector,
@@ -234,6 +436,24 @@ SiliconEndcapTracking::SiliconEndcapTracking() : Processor("SiliconEndcapTrackin
                                   emptyVec);
       
       
+      std::string critThetaMinString = _criteriaNames[i] + "_thetaMin";
+      
+      registerProcessorParameter( critThetaMinString,
+                                  "Optional minima of " + _criteriaNames[i] + " per theta division: NDivisionsInTheta values per round, "
+                                  "the divisions going from cos(theta) = -1 to 1. Replaces " + critMinString + " where given",
+                                  _thetaCutTable.minima[ _criteriaNames[i] ],
+                                  emptyVec);
+      
+      
+      std::string critThetaMaxString = _criteriaNames[i] + "_thetaMax";
+      
+      registerProcessorParameter( critThetaMaxString,
+                                  "Optional maxima of " + _criteriaNames[i] + " per theta division: NDivisionsInTheta values per round, "
+                                  "the divisions going from cos(theta) = -1 to 1. Replaces " + critMaxString + " where given",
+                                  _thetaCutTable.maxima[ _criteriaNames[i] ],
+                                  emptyVec);
+      
+      
    }
    
 
@@ -279,8 +499,93 @@ void SiliconEndcapTracking::init() {
    streamlog_out( DEBUG2 ) << " nDivisionsInPhi = " << _nDivisionsInPhi << " \n";
    streamlog_out( DEBUG2 ) << " nDivisionsInTheta = " << _nDivisionsInTheta << " \n";
 
-   _sectorSystemEndcap = new SectorSystemEndcap( nLayers, _nDivisionsInPhi , _nDivisionsInTheta );
- 
+   // The theta divisions can have boundaries of their own, to spread the hits evenly over them
+   std::vector< double > thetaBoundaries( _thetaBoundaries.begin(), _thetaBoundaries.end() );
+   
+   if( thetaBoundaries.empty() && !_thetaOccupancyProfileInput.empty() ){
+      
+      try{
+         
+         ThetaOccupancyProfile profile = ThetaOccupancyProfile::read( _thetaOccupancyProfileInput );
+         thetaBoundaries = profile.suggestBoundaries( _nDivisionsInTheta );
+         
+      }
+      catch( std::runtime_error& e ){
+         
+         throw EVENT::Exception( e.what() );
+         
+      }
+      
+      streamlog_out( MESSAGE ) << "The " << _nDivisionsInTheta << " theta divisions are made from the occupancy in " << _thetaOccupancyProfileInput << "\n";
+      
+   }
+   
+   if( !thetaBoundaries.empty() ){
+      
+      if( thetaBoundaries.size() != unsigned( _nDivisionsInTheta ) + 1 ){
+         
+         std::stringstream s;
+         s << "There are " << thetaBoundaries.size() << " ThetaBoundaries, but NDivisionsInTheta + 1 = " << _nDivisionsInTheta + 1 << " are needed";
+         throw EVENT::Exception( s.str() );
+         
+      }
+      
+      try{
+         
+         _sectorSystemEndcap = new SectorSystemEndcap( nLayers, _nDivisionsInPhi , thetaBoundaries );
+         
+      }
+      catch( std::invalid_argument& e ){
+         
+         throw EVENT::Exception( e.what() );
+         
+      }
+      
+      std::stringstream s;
+      for( unsigned i=0; i < thetaBoundaries.size(); i++ ) s << " " << thetaBoundaries[i];
+      streamlog_out( DEBUG4 ) << "Boundaries of the theta divisions in cos(theta):" << s.str() << "\n";
+      
+   }
+   else _sectorSystemEndcap = new SectorSystemEndcap( nLayers, _nDivisionsInPhi , _nDivisionsInTheta );
+   
+   // The cellID encoding is parsed only once, the hits are then decoded with shifts and masks
+   _cellIDDecoder = new CellIDDecoder( LCTrackerCellID::encoding_string(), _subdetLayerOffsets );
+   
+   // Only hits in time enter the track search, if time windows are set
+   if( !_hitTimeWindowMin.empty() || !_hitTimeWindowMax.empty() ){
+      
+      assert( _hitTimeWindowMin.size() == _hitTimeWindowMax.size() );
+      _hitTimeFilter = new HitTimeFilter( _hitTimeWindowMin, _hitTimeWindowMax, _hitTimeCorrectTOF );
+      
+   }
+   
+   // Hits closer than DuplicateHitDistMax to one read in before are found with a grid of the hits
+   if( _duplicateHitDistMax > 0. ) _duplicateHitGrid = new HitProximityGrid( _duplicateHitDistMax );
+   
+   // Without passes given, there is a single pass starting with the first round
+   if( _passFirstRounds.empty() ) _passFirstRounds.push_back( 0 );
+   for( unsigned pass=0; pass < _passFirstRounds.size(); pass++ ) assert( _passFirstRounds[pass] >= 0 );
+   _nTracksPerPass.assign( _passFirstRounds.size(), 0 );
+   
+   // Hits of curlers are taken out of the track search, if wanted
+   if( _looperMinHits > 0 ){
+      
+      assert( _looperMinLayers > 0 );
+      _looperFinder = new LooperFinder( _sectorSystemEndcap, _looperMinHits, _looperMinLayers );
+      
+   }
+   
+   // Hit tables of other processors can be reused, if they calculated layers and sectors the same way
+   std::stringstream hitTableLabel;
+   hitTableLabel << "SectorSystemEndcap " << nLayers << " " << _nDivisionsInPhi << " " << _nDivisionsInTheta << " LayerOffsets";
+   for( unsigned i=0; i < _subdetLayerOffsets.size(); i++ ) hitTableLabel << " " << _subdetLayerOffsets[i];
+   if( !_sectorSystemEndcap->hasUniformTheta() ){
+      
+      hitTableLabel << " ThetaBoundaries";
+      for( unsigned i=0; i < _sectorSystemEndcap->getCosThetaBoundaries().size(); i++ ) hitTableLabel << " " << _sectorSystemEndcap->getCosThetaBoundaries()[i];
+      
+   }
+   _hitTableLabel = hitTableLabel.str();
    
    // Get the B Field in z direction
       //---------DD4Hep-------------  
@@ -293,6 +598,53 @@ void SiliconEndcapTracking::init() {
    streamlog_out( DEBUG2 ) << " Bz = " << _Bz << " \n";
 
 
+   // The sector connections only depend on the geometry, so the connector (and its table) is made only once
+   unsigned layerStepMax = 1; // how many layers to go at max
+   //unsigned layerStepMax = 2; // how many layers to go at max
+   //unsigned lastLayerToIP = 9;// layer 1,2,3 and 4 get connected directly to the IP
+   unsigned lastLayerToIP = 4;// layer 1,2,3 and 4 get connected directly to the IP
+   if( !_layerZPositions.empty() && ( _layerZPositions.size() != unsigned( nLayers ) ) ){
+      
+      streamlog_out( WARNING ) << "LayerZPositions has " << _layerZPositions.size() << " entries, but there are " << nLayers 
+                               << " layers (including the IP). The fixed windows are used for the sector connector.\n";
+      
+   }
+   
+   _sectorConnector = new EndcapSectorConnector( _sectorSystemEndcap , layerStepMax, lastLayerToIP, _layerZPositions, _Bz, _connectionPtMin ) ;
+   
+   streamlog_out( DEBUG4 ) << "EndcapSectorConnector: " << _sectorConnector->getTable().getNConnections() 
+                           << " connections between " << _sectorConnector->getTable().getNSectors() << " sectors\n";
+   
+   if( _sectorConnector->usesPhysicsWindows() ){
+      
+      streamlog_out( MESSAGE ) << "EndcapSectorConnector: windows derived for pt > " << _connectionPtMin << " GeV in Bz = " << _Bz << " T give "
+                               << _sectorConnector->getTable().getNConnections() << " sector connections, the fixed windows would give "
+                               << _sectorConnector->getNConnectionsFixedWindows() << "\n";
+      
+   }
+   
+   // The acceptance in phi only depends on the geometry as well
+   if( _geometricAcceptance ){
+      
+      if( _sectorConnector->usesPhysicsWindows() ){
+         
+         _acceptanceTable = new GeometricAcceptanceTable( _sectorSystemEndcap, _sectorConnector->getTable(), _layerZPositions, _Bz, 
+                                                          _connectionPtMin, _geometricAcceptancePhiTolerance );
+         
+         streamlog_out( MESSAGE ) << "GeometricAcceptanceTable: " << _acceptanceTable->getNRestrictedConnections() << " of " 
+                                  << _sectorConnector->getTable().getNConnections() << " sector connections restrict the difference in phi of the hits\n";
+         
+      }
+      else{
+         
+         streamlog_out( WARNING ) << "GeometricAcceptance needs LayerZPositions for all layers, a field and ConnectionPtMin > 0: it is not used\n";
+         
+      }
+      
+   }
+
+
+
 
    /**********************************************************************************************/
    /*       Initialise the MarlinTrkSystem, needed by the tracks for fitting                     */
@@ -316,7 +668,6 @@ void SiliconEndcapTracking::init() {
    _trkSystem->init() ;
    
    
-   
    /**********************************************************************************************/
    /*       Do a few checks, if the set parameters are right                                     */
    /**********************************************************************************************/
@@ -329,6 +680,76 @@ void SiliconEndcapTracking::init() {
    assert( _chi2ProbCut >= 0. );
    assert( _chi2ProbCut <= 1. );
    
+   // The wedges need at least one phi division each and the halo must not cover the whole circle
+   // (with one wedge there is no halo)
+   assert( _nPhiWedges >= 1 );
+   assert( _nPhiWedges <= _nDivisionsInPhi );
+   assert( _phiWedgeHalo >= 0 );
+   assert( ( _nPhiWedges == 1 ) || ( 2*_phiWedgeHalo + ( _nDivisionsInPhi + _nPhiWedges - 1 ) / _nPhiWedges <= _nDivisionsInPhi ) );
+   
+   // At least one raw track has to fit into the queue to the fit
+   assert( _rawTrackQueueSize >= 1 );
+   
+   if( _streamRawTracks && _maxPathsPerSegment <= 0 ){
+      
+      streamlog_out( WARNING ) << "StreamRawTracks needs MaxPathsPerSegment > 0 (Automaton::getTracks returns all raw tracks at once): the raw tracks are not streamed\n";
+      _streamRawTracks = false;
+      
+   }
+   
+   if( _streamRawTracks && _nPhiWedges > 1 ){
+      
+      streamlog_out( WARNING ) << "StreamRawTracks can't be used with NPhiWedges > 1 (the wedges already run in threads of their own): the raw tracks are not streamed\n";
+      _streamRawTracks = false;
+      
+   }
+   
+   
+   // Only known ways to use the classifiers
+   assert( ( _segmentClassifierMode == "Off" ) || ( _segmentClassifierMode == "Before" ) || ( _segmentClassifierMode == "Instead" ) );
+   
+   if( _segmentClassifierMode != "Off" ){
+      
+      std::set< unsigned > classifierHits;
+      
+      for( unsigned i=0; i < _segmentClassifierFiles.size(); i++ ){
+         
+         SegmentClassifier* classifier = NULL;
+         
+         try{
+            
+            classifier = SegmentClassifier::readFile( _segmentClassifierFiles[i] );
+            
+         }
+         catch( std::runtime_error& e ){
+            
+            throw EVENT::Exception( e.what() );
+            
+         }
+         
+         _segmentClassifiers.push_back( classifier );
+         
+         if( !classifierHits.insert( classifier->getNHits() ).second ){
+            
+            throw EVENT::Exception( "There is more than one segment classifier for the same number of hits: " + _segmentClassifierFiles[i] );
+            
+         }
+         
+         // the criteria for the features have to exist
+         for( unsigned j=0; j < classifier->getCriteriaNames().size(); j++ ){
+            
+            ICriterion* crit = Criteria::createCriterion( classifier->getCriteriaNames()[j] ); //throws an exception if the criterion is non existent
+            delete crit;
+            
+         }
+         
+         streamlog_out( MESSAGE ) << "Read a " << classifier->getType() << " classifier for " << classifier->getNHits() << " hits with " 
+                                  << classifier->getNFeatures() << " features from " << _segmentClassifierFiles[i] << "\n";
+         
+      }
+      
+   }
+   
    
    // Make sure, every used criterion exists and has at least one min and max set
    for( unsigned i=0; i<_criteriaNames.size(); i++ ){
@@ -341,8 +762,38 @@ void SiliconEndcapTracking::init() {
       assert( !_critMinima[ critName ].empty() );
       assert( !_critMaxima[ critName ].empty() );
       
+      // the cut off values per theta division are optional, but come in full rows of NDivisionsInTheta values
+      assert( _thetaCutTable.minima[ critName ].size() % _nDivisionsInTheta == 0 );
+      assert( _thetaCutTable.maxima[ critName ].size() % _nDivisionsInTheta == 0 );
+      
+      if( _thetaCutTable.minima[ critName ].empty() ) _thetaCutTable.minima.erase( critName );
+      if( _thetaCutTable.maxima[ critName ].empty() ) _thetaCutTable.maxima.erase( critName );
+      
+      if( _thetaCutTable.hasTable( critName ) ){
+         
+         streamlog_out( MESSAGE ) << critName << " has cut off values for every theta division\n";
+         
+      }
+      
+   }
+   
+   _thetaCutTable.sectorSystem = _sectorSystemEndcap;
+   
+   // The criteria of all rounds are made once here, processEvent only picks the set of the round
+   buildCriteriaSets();
+   
+   for( unsigned pass=0; pass < _passFirstRounds.size(); pass++ ){
+      
+      if( unsigned( _passFirstRounds[pass] ) >= _criteriaSets.size() ){
+         
+         streamlog_out( WARNING ) << "Pass " << pass + 1 << " starts with criteria round " << _passFirstRounds[pass] << ", but there are only " 
+                                  << _criteriaSets.size() << " rounds: it won't find any tracks\n";
+         
+      }
+      
    }
    
+   if( _criteriaWarmUpEvents > 0 ) _criteriaProfiler.startProfiling( _criteriaSets );
    
    
 
@@ -364,6 +815,15 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
   MarlinTrk::TrkSysConfig< MarlinTrk::IMarlinTrkSystem::CFG::useSmoothing> smoothon( _trkSystem,_SmoothOn) ;
 
   streamlog_out( DEBUG4 ) << "processing event number " << _nEvt << "\n";
+  
+  // after the warm-up the criteria are checked in the learned order
+  if( _criteriaProfiler.isProfiling() && _nEvt >= _criteriaWarmUpEvents ){
+     
+     _criteriaProfiler.stopProfiling( _criteriaSets );
+     
+     streamlog_out( DEBUG4 ) << "The criteria were measured in " << _nEvt << " events and are ordered by rejections per ns now\n";
+     
+  }
    
    //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
    //                                                                                                              //
@@ -398,6 +858,7 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
 
    std::vector< IHit* > hitsTBD; //Hits to be deleted at the end
    _map_sector_hits.clear();
+   if( _duplicateHitGrid != NULL ) _duplicateHitGrid->clear();
 
    
    /**********************************************************************************************/
@@ -406,6 +867,11 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
    
    streamlog_out( DEBUG4 ) << "\t\t---Reading in Collections---\n" ;
    
+   // The hit tables are shared with the other processors via the event
+   HitTableRegistry* hitTableRegistry = HitTableRegistry::getRegistry( evt );
+   
+   // the tables of the read in collections and the index of the collection
+   std::vector< std::pair< unsigned , HitTable* > > hitTables;
    
    for( unsigned iCol=0; iCol < _FTDHitCollections.size(); iCol++ ){ //read in all input collections
       
@@ -432,65 +898,198 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
       //just for debug
       //getCellID0AndPositionInfo( col );
       
-
-      for(unsigned i=0; i< nHits ; i++){
+      
+      HitTable* hitTable = hitTableRegistry->getTable( _FTDHitCollections[iCol], _hitTableLabel );
+      
+      if( hitTable == NULL ){ // not read in yet with this sector system
+         
+         hitTable = hitTableRegistry->createTable( _FTDHitCollections[iCol], _hitTableLabel );
+         
+         if( hitTable->empty() ){ // nobody read in the collection yet: position, r, phi and cosTheta are calculated once here
+            
+            hitTable->reserve( nHits );
+            
+            for(unsigned i=0; i< nHits ; i++){
+               
+               TrackerHit* trackerHit = dynamic_cast<TrackerHit*>( col->getElementAt( i ) );
+               
+               if( trackerHit == NULL ){
+                  
+                  streamlog_out( DEBUG5 ) << "Cast to TrackerHit* was not possible, skipping element " << col->getElementAt(i) << "\n";
+                  continue;
                   
-         TrackerHit* trackerHit = dynamic_cast<TrackerHit*>( col->getElementAt( i ) );
+               }
+               
+               hitTable->addHit( trackerHit );
+               
+            }
+            
+            _nHitTablesFilled++;
+            
+         }
+         else _nHitTablesCopied++;
          
-         if( trackerHit == NULL ){
+         for( unsigned row=0; row < hitTable->size(); row++ ){
             
-            streamlog_out( DEBUG5 ) << "Cast to TrackerHit* was not possible, skipping element " << col->getElementAt(i) << "\n";
-            continue;
+            // The layer numbers of the subdetectors are made consecutive by the offsets of the decoder
+            int layer = _cellIDDecoder->getLayerWithOffset( hitTable->getTrackerHit( row )->getCellID0() );
+            hitTable->setLayer( row, layer );
             
-         }       
-
-	 //Make a EndcapHit01 from the TrackerHit
-	 EndcapHit01* endcapHit = new EndcapHit01 ( trackerHit , _sectorSystemEndcap );
-	 hitsTBD.push_back(endcapHit);
-	 _map_sector_hits[ endcapHit->getSector() ].push_back( endcapHit );
-	 
+            // doesn't throw: hits out of range are put into the nearest sector and counted by the sector system
+            hitTable->setSector( row, _sectorSystemEndcap->getSectorClamped( layer, hitTable->getPhi( row ), hitTable->getCosTheta( row ) ) );
+            
+         }
+         
       }
+      else _nHitTablesReused++;
+      
+      hitTables.push_back( std::make_pair( iCol, hitTable ) );
       
    }
-  
-
-   //just for debug
-   //std::string info = getInfo_map_sector_hits(); 
-   //streamlog_out( DEBUG2 ) << info.c_str() << std::endl;
-   
    
-   if( !_map_sector_hits.empty() ){
-
+   // the occupancy in theta for a calibration of the theta divisions
+   if( !_thetaOccupancyProfileOutput.empty() ){
       
-      /**********************************************************************************************/
-      /*                Check if no sector is overflowing with hits                                 */
-      /**********************************************************************************************/
+      for( unsigned iTable=0; iTable < hitTables.size(); iTable++ ){
+         
+         const HitTable* hitTable = hitTables[iTable].second;
+         for( unsigned row=0; row < hitTable->size(); row++ ) _thetaOccupancyProfile.fill( hitTable->getCosTheta( row ) );
+         
+      }
       
+      _thetaOccupancyProfile.addEvent();
       
-      std::map< int , std::vector< IHit* > >::iterator it;
+   }
+   
+   
+   /**********************************************************************************************/
+   /*    Create the hits, every physical crossing only once                                      */
+   /**********************************************************************************************/
+   
+   // A hit made from hits of another input collection (like a spacepoint from two strip hits) stands for them: they are dropped
+   std::set< LCObject* > combinedHits;
+   
+   if( _suppressCombinedHits && hitTables.size() > 1 ){
       
-      for( it=_map_sector_hits.begin(); it != _map_sector_hits.end(); it++ ){
-       	  
-	int nHits = it->second.size();
-         streamlog_out( DEBUG2 ) << "Number of hits in sector " << it->first << " = " << nHits << "\n";
+      for( unsigned iTable=0; iTable < hitTables.size(); iTable++ ){
          
-         if( nHits > _maxHitsPerSector ){
-            
-            it->second.clear(); //delete the hits in this sector, it will be dropped
+         const HitTable* hitTable = hitTables[iTable].second;
+         
+         for( unsigned row=0; row < hitTable->size(); row++ ){
             
-            streamlog_out(ERROR)  << " ### EVENT " << evt->getEventNumber() << " :: RUN " << evt->getRunNumber() << " \n ### Number of Hits in FTD Sector " << it->first << ": " << nHits << " > " << _maxHitsPerSector << " (MaxHitsPerSector)\n : This sector will be dropped from track search, and QualityCode set to \"Poor\" " << std::endl;
-           
-            _output_track_col_quality = _output_track_col_quality_POOR; // We had to drop hits, so the quality of the result is decreased
+            const LCObjectVec& rawHits = hitTable->getTrackerHit( row )->getRawHits();
+            combinedHits.insert( rawHits.begin(), rawHits.end() );
             
          }
          
       }
       
-
-
-
-      /**********************************************************************************************/
-      /*                Check the possible connections of hits on overlapping petals                */
+   }
+   
+   
+   for( unsigned iTable=0; iTable < hitTables.size(); iTable++ ){
+      
+      HitTable* hitTable = hitTables[iTable].second;
+      unsigned nDuplicates = 0;
+      
+      for( unsigned row=0; row < hitTable->size(); row++ ){
+         
+         if( _hitTimeFilter != NULL ){
+            
+            double distance = sqrt( hitTable->getR( row )*hitTable->getR( row ) + hitTable->getZ( row )*hitTable->getZ( row ) );
+            if( !_hitTimeFilter->accept( hitTable->getTrackerHit( row )->getTime(), distance, hitTable->getLayer( row ) ) ) continue;
+            
+         }
+         
+         if( ( !combinedHits.empty() && combinedHits.count( hitTable->getTrackerHit( row ) ) ) 
+             || ( _duplicateHitGrid != NULL && isDuplicateHit( hitTable, row ) ) ){
+            
+            nDuplicates++;
+            continue;
+            
+         }
+         
+         //Make a EndcapHit01 from the row
+         EndcapHit01* endcapHit = new EndcapHit01 ( hitTable, row, _sectorSystemEndcap );
+         hitsTBD.push_back(endcapHit);
+         _map_sector_hits[ endcapHit->getSector() ].push_back( endcapHit );
+         
+         if( _duplicateHitGrid != NULL ) _duplicateHitGrid->add( endcapHit );
+         
+      }
+      
+      const std::string& colName = _FTDHitCollections[ hitTables[iTable].first ];
+      
+      streamlog_out( DEBUG4 ) << nDuplicates << " hits of collection " << colName << " were dropped as duplicates\n";
+      _nDuplicateHits[ colName ] += nDuplicates;
+      
+   }
+  
+
+   //just for debug
+   //std::string info = getInfo_map_sector_hits(); 
+   //streamlog_out( DEBUG2 ) << info.c_str() << std::endl;
+   
+   
+   if( !_map_sector_hits.empty() ){
+
+      
+      /**********************************************************************************************/
+      /*                Check if no sector is overflowing with hits                                 */
+      /**********************************************************************************************/
+      
+      
+      std::map< int , std::vector< IHit* > >::iterator it;
+      
+      for( it=_map_sector_hits.begin(); it != _map_sector_hits.end(); it++ ){
+       	  
+	int nHits = it->second.size();
+         streamlog_out( DEBUG2 ) << "Number of hits in sector " << it->first << " = " << nHits << "\n";
+         
+         if( nHits > _maxHitsPerSector ){
+            
+            it->second.clear(); //delete the hits in this sector, it will be dropped
+            
+            streamlog_out(ERROR)  << " ### EVENT " << evt->getEventNumber() << " :: RUN " << evt->getRunNumber() << " \n ### Number of Hits in FTD Sector " << it->first << ": " << nHits << " > " << _maxHitsPerSector << " (MaxHitsPerSector)\n : This sector will be dropped from track search, and QualityCode set to \"Poor\" " << std::endl;
+           
+            _output_track_col_quality = _output_track_col_quality_POOR; // We had to drop hits, so the quality of the result is decreased
+            
+         }
+         
+      }
+      
+      
+      /**********************************************************************************************/
+      /*                Sort the hits of every sector by phi                                        */
+      /**********************************************************************************************/
+      
+      // With the acceptance table the batch segment builder looks only at the hits of a target sector within a window 
+      // in phi with a binary search. Taking hits out (loopers, hits of found tracks) keeps the order.
+      // Otherwise nothing reads the order, and the hits stay in the order of the collections.
+      if( _batchSegmentBuilding && _acceptanceTable != NULL ) sortHitsByPhi( _map_sector_hits );
+      
+
+
+
+      /**********************************************************************************************/
+      /*                Take the hits of loopers out of the track search                            */
+      /**********************************************************************************************/
+      
+      std::map< int , std::vector< IHit* > > map_sector_loopers;
+      unsigned nLooperHits = 0;
+      
+      if( _looperFinder != NULL ){
+         
+         nLooperHits = _looperFinder->maskLoopers( _map_sector_hits, map_sector_loopers );
+         _nLooperHitsMasked += nLooperHits;
+         
+         streamlog_out( DEBUG4 ) << nLooperHits << " hits were taken out of the track search as looper hits\n";
+         
+      }
+      
+      
+      /**********************************************************************************************/
+      /*                Check the possible connections of hits on overlapping petals                */
       /**********************************************************************************************/
       
 
@@ -501,6 +1100,15 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
       std::map< IHit* , std::vector< IHit* > > map_hitFront_hitsBack = getOverlapConnectionMap( _map_sector_hits, _sectorSystemEndcap, _overlappingHitsDistMax);
       
       
+      // count what the derived windows of the sector connector save compared to the fixed ones
+      if( _sectorConnector->usesPhysicsWindows() ){
+         
+         _nCandidatePairs += _sectorConnector->countCandidatePairs( _map_sector_hits, false );
+         _nCandidatePairsFixedWindows += _sectorConnector->countCandidatePairs( _map_sector_hits, true );
+         
+      }
+      
+      
      
 
       /**********************************************************************************************/
@@ -515,86 +1123,442 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
      
       
       /**********************************************************************************************/
-      /*                SegmentBuilder and Cellular Automaton                                       */
+      /*                SegmentBuilder, Cellular Automaton and fit of the track candidates          */
       /**********************************************************************************************/
       
-      unsigned round = 0; // the round we are in
-      std::vector < RawTrack > rawTracks;
+      CandidateSearchStats stats;
+      std::vector <ITrack*> trackCandidates;
+      
+      // the first pass (and without iterative passes the only one) starts with the criteria of its round
+      if( _nPhiWedges > 1 ) trackCandidates = findTrackCandidatesInPhiWedges( map_hitFront_hitsBack, _passFirstRounds[0], stats );
+      else trackCandidates = findTrackCandidates( _map_sector_hits, map_hitFront_hitsBack, _trkSystem, _passFirstRounds[0], stats );
+      
+      countCandidateSearch( stats );
+      
       
-      // The following while loop ideally only runs once. (So we do round 0 and everything works)
-      // It will repeat as long as the Automaton creates too many connections and as long as there are new criteria
-      // parameters to use to cut down the problem.
-      // Ideally already in round 0, there is a reasonable number of connections (not more than _maxConnectionsAutomaton), 
-      // so the loop will be left. If however there are too many connections we stay in the loop and use 
-      // (hopefully) tighter cut offs (if provided in the steering). This should prevent combinatorial breakdown
-      // for very evil events.
-      while( setCriteria( round ) ){
+      /**********************************************************************************************/
+      /*                Bounded search for tracks in the looper hits                                */
+      /**********************************************************************************************/
+      
+      if( nLooperHits > 0 && nLooperHits <= unsigned( _looperPassMaxHits ) ){
+         
+         streamlog_out( DEBUG4 ) << "\t\t---Looper pass---\n" ;
+         
+         map_sector_loopers[ virtualIPHitForward->getSector() ].push_back( virtualIPHitForward );
          
+         std::map< IHit* , std::vector< IHit* > > noOverlaps;
+         CandidateSearchStats looperStats;
          
-         round++; // count up the round we are in
+         std::vector< ITrack* > looperCandidates = findTrackCandidates( map_sector_loopers, noOverlaps, _trkSystem, _passFirstRounds[0], looperStats );
+         trackCandidates.insert( trackCandidates.end(), looperCandidates.begin(), looperCandidates.end() );
          
+         _nLooperPasses++;
+         _nLooperPassCandidates += looperCandidates.size();
          
-         /**********************************************************************************************/
-         /*                Build the segments                                                          */
-         /**********************************************************************************************/
+      }
+      else if( nLooperHits > 0 ) _nLooperPassesSkipped++;
+      
+
+      if( _useCED ){
+//          for( unsigned i=0; i < trackCandidates.size(); i++ ) KiTrackMarlin::drawTrackRandColor( trackCandidates[i] );
+      }
+      
+      /**********************************************************************************************/
+      /*               Get the best subset of tracks                                                */
+      /**********************************************************************************************/
+      
+      std::vector< ITrack* > tracks = getBestSubset( trackCandidates );
+      _nTracksPerPass[0] += tracks.size();
+      
+      
+      /**********************************************************************************************/
+      /*               Further passes on the hits not used by the tracks found so far               */
+      /**********************************************************************************************/
+      
+      for( unsigned pass=1; pass < _passFirstRounds.size(); pass++ ){
          
-         streamlog_out( DEBUG4 ) << "\t\t---SegementBuilder---\n" ;
+         unsigned nMasked = removeHitsOfTracks( tracks, _map_sector_hits, map_hitFront_hitsBack );
+         _nHitsMaskedForPasses += nMasked;
          
-         //Create a segmentbuilder
-         SegmentBuilder segBuilder( _map_sector_hits );
+         streamlog_out( DEBUG4 ) << "\t\t---Pass " << pass + 1 << "---\n" ;
+         streamlog_out( DEBUG4 ) << nMasked << " hits of the " << tracks.size() << " tracks found so far are masked, the criteria start with round " 
+                                 << _passFirstRounds[pass] << "\n";
          
-         segBuilder.addCriteria ( _crit2Vec ); // Add the criteria on when to connect two hits. The vector has been filled by the method setCriteria
+         CandidateSearchStats passStats;
+         std::vector< ITrack* > passCandidates;
          
-         //Also load hit connectors
-         unsigned layerStepMax = 1; // how many layers to go at max
-         //unsigned layerStepMax = 2; // how many layers to go at max
-         //unsigned lastLayerToIP = 9;// layer 1,2,3 and 4 get connected directly to the IP
-         unsigned lastLayerToIP = 4;// layer 1,2,3 and 4 get connected directly to the IP
-         EndcapSectorConnector secCon( _sectorSystemEndcap , layerStepMax, lastLayerToIP ) ;
+         if( _nPhiWedges > 1 ) passCandidates = findTrackCandidatesInPhiWedges( map_hitFront_hitsBack, _passFirstRounds[pass], passStats );
+         else passCandidates = findTrackCandidates( _map_sector_hits, map_hitFront_hitsBack, _trkSystem, _passFirstRounds[pass], passStats );
          
-         segBuilder.addSectorConnector ( & secCon ); // Add the sector connector (so the SegmentBuilder knows what hits from different sectors it is allowed to look for connections)
+         countCandidateSearch( passStats );
          
+         std::vector< ITrack* > passTracks = getBestSubset( passCandidates );
+         _nTracksPerPass[pass] += passTracks.size();
          
-         // And get out the Cellular Automaton with the 1-segments 
-         Automaton automaton = segBuilder.get1SegAutomaton();
+         tracks.insert( tracks.end(), passTracks.begin(), passTracks.end() );
          
-         // Check if there are not too many connections
-         if( automaton.getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
+      }
+      
+      
+      /**********************************************************************************************/
+      /*               Finally: Finalise and save the tracks                                        */
+      /**********************************************************************************************/
+      
+      streamlog_out( DEBUG4 ) << "\t\t---Save Tracks---\n" ;
+      
+      LCCollectionVec * trkCol = new LCCollectionVec(LCIO::TRACK);
+      
+      // Set the flags
+      LCFlagImpl hitFlag(0) ;
+      hitFlag.setBit( LCIO::TRBIT_HITS ) ;
+      trkCol->setFlag( hitFlag.getFlag()  ) ;
+      
+      
+      for (unsigned int i=0; i < tracks.size(); i++){
+         
+	//FTDTrack* myTrack = dynamic_cast< FTDTrack* >( tracks[i] );
+         EndcapTrack* myTrack = dynamic_cast< EndcapTrack* >( tracks[i] );
+         
+         if( myTrack != NULL ){
+            
+            
+            TrackImpl* trackImpl = new TrackImpl( *(myTrack->getLcioTrack()) );
+            
+            try{
+               
+               finaliseTrack( trackImpl );
+               trkCol->addElement( trackImpl );
+               
+            }
+            catch( FitterException e ){
+               
+               streamlog_out( DEBUG4 ) << "SiliconEndcapTracking: track couldn't be finalized due to fitter error: " << e.what() << "\n";
+               delete trackImpl;
+            }
             
-            streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
-            << "\tconnections( " << automaton.getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
-            continue;
             
          }
          
          
+      }
+     
+      // set the quality of the output collection
+      switch (_output_track_col_quality) {
          
-         /**********************************************************************************************/
-         /*                Automaton                                                                   */
-         /**********************************************************************************************/
-         
+         case _output_track_col_quality_FAIR:
+            trkCol->parameters().setValue( "QualityCode" , "Fair"  ) ;
+            break;
+            
+         case _output_track_col_quality_POOR:
+            trkCol->parameters().setValue( "QualityCode" , "Poor"  ) ;
+            break;
+            
+         default:
+            trkCol->parameters().setValue( "QualityCode" , "Good"  ) ;
+            break;
+      }
+
+      evt->addCollection(trkCol,_ForwardTrackCollection.c_str());
+      
+      
+      
+      streamlog_out (DEBUG5) << "Forward Tracking found and saved " << tracks.size() << " tracks in event " << _nEvt << "\n"; 
+      for (size_t itrack=0; itrack<tracks.size(); itrack++){
+	streamlog_out (DEBUG5) << " track " << itrack << " has nhits " << tracks.at(itrack)->getHits().size() << "\n";
+	for (size_t ihit=0; ihit<tracks.at(itrack)->getHits().size(); ihit++){
+	  streamlog_out (DEBUG5) << " hit z " << tracks.at(itrack)->getHits().at(ihit)->getZ() << "\n"; 
+	}
+      }
+      streamlog_out (DEBUG5) << "\n"; 
+      
+      /**********************************************************************************************/
+      /*                Clean up                                                                    */
+      /**********************************************************************************************/
+      
+      // delete all the created IHits
+      for ( unsigned i=0; i<hitsTBD.size(); i++ )  delete hitsTBD[i];
+      
+      // delete the FTracks
+      for (unsigned int i=0; i < tracks.size(); i++){ delete tracks[i];}
+      
+      
+      
+      
+   }
+
+
+
+
+   if( _useCED ) MarlinCED::draw(this);
+
+
+   _nEvt ++ ;
+   
+}
+
+
+
+
+
+void SiliconEndcapTracking::check( LCEvent* ) {}
+
+
+void SiliconEndcapTracking::end(){
+   
+   
+   if( !_thetaOccupancyProfileOutput.empty() ){
+      
+      try{
          
+         _thetaOccupancyProfile.write( _thetaOccupancyProfileOutput );
          
-         streamlog_out( DEBUG4 ) << "\t\t---Automaton---\n" ;
+         streamlog_out( MESSAGE ) << "Wrote the occupancy in theta of " << _thetaOccupancyProfile.getNHits() << " hits in " 
+                                  << _thetaOccupancyProfile.getNEvents() << " events to " << _thetaOccupancyProfileOutput << "\n";
          
-         if( _useCED ) KiTrackMarlin::drawAutomatonSegments( automaton ); // draws the 1-segments (i.e. hits)
+      }
+      catch( std::runtime_error& e ){
          
+         streamlog_out( ERROR ) << e.what() << "\n";
          
-         /*******************************/
-         /*      2-hit segments         */
-         /*******************************/
+      }
+      
+   }
+   
+   
+   if( _criteriaWarmUpEvents > 0 ){
+      
+      // if there were fewer events than the warm-up, the criteria are put back before they get deleted
+      _criteriaProfiler.stopProfiling( _criteriaSets );
+      
+      std::stringstream s;
+      _criteriaProfiler.print( s );
+      streamlog_out( MESSAGE ) << "Order of the criteria learned in " << std::min( _nEvt, _criteriaWarmUpEvents ) << " events:\n" << s.str();
+      
+   }
+   
+   if( _validateFloatPrecision ){
+      
+      std::stringstream s;
+      _precisionValidator.print( s );
+      streamlog_out( MESSAGE ) << "Decisions in float and double precision: " << _precisionValidator.getNDiffering() << " differing\n" << s.str();
+      
+   }
+   
+   deleteCriteriaSets( _criteriaSets );
+   
+   for( unsigned i=0; i < _segmentClassifiers.size(); i++ ) delete _segmentClassifiers[i];
+   _segmentClassifiers.clear();
+   
+   if( _sectorConnector->usesPhysicsWindows() ){
+      
+      streamlog_out( MESSAGE ) << "EndcapSectorConnector: the derived windows gave " << _nCandidatePairs << " candidate pairs of hits for the 2-hit criteria, the fixed windows would have given "
+                               << _nCandidatePairsFixedWindows << " (" << long( _nCandidatePairsFixedWindows ) - long( _nCandidatePairs ) << " saved)\n";
+      
+   }
+   
+   delete _sectorConnector;
+   _sectorConnector = NULL;
+   
+   if( _acceptanceTable != NULL ){
+      
+      streamlog_out( MESSAGE ) << "GeometricAcceptanceTable: " << _nPairsRejectedByAcceptance << " pairs of hits were rejected before the 2-hit criteria, " 
+                               << _nPairsChecked << " were checked by them\n";
+      
+   }
+   
+   delete _acceptanceTable;
+   _acceptanceTable = NULL;
+   
+   if( _sectorSystemEndcap->getNOutOfRange() > 0 ){
+      
+      streamlog_out( WARNING ) << _sectorSystemEndcap->getNOutOfRange() << " hits were out of range of the SectorSystemEndcap and were put into the nearest sector\n";
+      
+   }
+   
+   delete _sectorSystemEndcap;
+   _sectorSystemEndcap = NULL;
+   
+   delete _cellIDDecoder;
+   _cellIDDecoder = NULL;
+   
+   std::map< std::string , unsigned long >::iterator itDupl;
+   for( itDupl = _nDuplicateHits.begin(); itDupl != _nDuplicateHits.end(); itDupl++ ){
+      
+      streamlog_out( MESSAGE ) << itDupl->second << " hits of collection " << itDupl->first << " were dropped as duplicates\n";
+      
+   }
+   
+   if( _passFirstRounds.size() > 1 ){
+      
+      streamlog_out( MESSAGE ) << "Iterative tracking: " << _nHitsMaskedForPasses << " hits masked for the later passes, tracks found per pass:";
+      for( unsigned pass=0; pass < _nTracksPerPass.size(); pass++ ) streamlog_out( MESSAGE ) << " " << _nTracksPerPass[pass];
+      streamlog_out( MESSAGE ) << "\n";
+      
+   }
+   
+   if( _looperFinder != NULL ){
+      
+      streamlog_out( MESSAGE ) << "Looper search: " << _nLooperHitsMasked << " hits taken out of the track search, " << _nLooperPasses 
+                               << " looper passes gave " << _nLooperPassCandidates << " track candidates, " << _nLooperPassesSkipped 
+                               << " events had too many looper hits for a looper pass\n";
+      
+      delete _looperFinder;
+      _looperFinder = NULL;
+      
+   }
+   
+   if( _hitTimeFilter != NULL ){
+      
+      for( unsigned layer=0; layer < _hitTimeFilter->getNLayers(); layer++ ){
          
-         streamlog_out( DEBUG4 ) << "\t\t--2-hit-Segments--\n" ;
+         unsigned long nRejected = _hitTimeFilter->getNRejected( layer );
+         unsigned long nAll = nRejected + _hitTimeFilter->getNAccepted( layer );
          
-         streamlog_out(DEBUG4) << "Automaton has " << automaton.getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
+         if( nAll > 0 ) streamlog_out( MESSAGE ) << "Hit time filter: layer " << layer << ": " << nRejected << " of " << nAll << " hits rejected\n";
          
-         automaton.clearCriteria();
-         automaton.addCriteria( _crit3Vec );  // Add the criteria for 3 hits (i.e. 2 2-hit segments )
+      }
+      
+      delete _hitTimeFilter;
+      _hitTimeFilter = NULL;
+      
+   }
+   
+   delete _duplicateHitGrid;
+   _duplicateHitGrid = NULL;
+   
+   streamlog_out( MESSAGE ) << "Hit tables: " << _nHitTablesFilled << " calculated from the TrackerHits, " << _nHitTablesCopied 
+                            << " copied from another sector system, " << _nHitTablesReused << " reused from other processors\n";
+
+   // delete _sectorSystemFTD;
+   // _sectorSystemFTD = NULL;
+   
+   if( _maxPathsPerSegment > 0 ){
+      
+      streamlog_out( MESSAGE ) << "Raw track extraction: the limit of " << _maxPathsPerSegment << " paths (MaxPathsPerSegment) was hit for "
+      << _nExtractionLimitHit << " of " << _nExtractionStartSegments << " outermost segments\n";
+      
+   }
+   
+   // streamlog_out( DEBUG3 ) << "There are " << _nTrackCandidates << "track candidates from CA and "<<  _nTrackCandidatesPlus
+   //    << " track Candidates with hits from overlapping hits\n"
+   //    << "The ratio is " << float( _nTrackCandidatesPlus )/_nTrackCandidates;
+
+   
+}
+
+
+
+
+std::vector< ITrack* > SiliconEndcapTracking::findTrackCandidates( std::map< int , std::vector< IHit* > >& map_sector_hits,
+                                                                  std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                                                  MarlinTrk::IMarlinTrkSystem* trkSystem,
+                                                                  unsigned firstRound,
+                                                                  CandidateSearchStats& stats ){
+   
+   
+   // the search for the raw tracks runs in a second thread, they are fitted here while it goes on
+   if( _streamRawTracks && canRunInThreads() ) return streamTrackCandidates( map_sector_hits, map_hitFront_hitsBack, trkSystem, firstRound, stats );
+   
+   
+   std::vector < RawTrack > rawTracks;
+   
+   findRawTracks( map_sector_hits, firstRound, stats, [ &rawTracks ]( RawTrack& rawTrack ){ rawTracks.push_back( rawTrack ); return true; } );
+   
+   streamlog_out( DEBUG4 ) << "Automaton returned " << rawTracks.size() << " raw tracks \n";
+   
+   
+   /**********************************************************************************************/
+   /*                Add the overlapping hits                                                    */
+   /**********************************************************************************************/
+   
+   
+   streamlog_out( DEBUG4 ) << "\t\t---Add hits from overlapping petals + fit + helix and Kalman cuts---\n" ;
+   
+   
+   std::vector <ITrack*> trackCandidates;
+   
+   // for all raw tracks we got from the automaton
+   for( unsigned i=0; i < rawTracks.size(); i++) addTrackCandidates( rawTracks[i], map_hitFront_hitsBack, trkSystem, trackCandidates, stats );
+   
+   return trackCandidates;
+   
+}
+
+
+void SiliconEndcapTracking::findRawTracks( std::map< int , std::vector< IHit* > >& map_sector_hits,
+                                           unsigned firstRound,
+                                           CandidateSearchStats& stats,
+                                           const BestFirstTrackExtractor::TrackConsumer& consumer ){
+   
+   
+   /**********************************************************************************************/
+   /*                SegmentBuilder and Cellular Automaton                                       */
+   /**********************************************************************************************/
+   
+   unsigned round = firstRound; // the round we are in
+   
+   // The following while loop ideally only runs once. (So we do round 0 and everything works)
+   // It will repeat as long as the Automaton creates too many connections and as long as there are new criteria
+   // parameters to use to cut down the problem.
+   // Ideally already in round 0, there is a reasonable number of connections (not more than _maxConnectionsAutomaton), 
+   // so the loop will be left. If however there are too many connections we stay in the loop and use 
+   // (hopefully) tighter cut offs (if provided in the steering). This should prevent combinatorial breakdown
+   // for very evil events.
+   while( round < _criteriaSets.size() ){
+      
+      // the criteria of the round were made in init and are only read here
+      const CriteriaSet& criteria = _criteriaSets[ round ];
+      
+      round++; // count up the round we are in
+      
+      
+      /**********************************************************************************************/
+      /*                Build the segments                                                          */
+      /**********************************************************************************************/
+      
+      streamlog_out( DEBUG4 ) << "\t\t---SegementBuilder---\n" ;
+      
+      // And get out the Cellular Automaton with the 1-segments 
+      Automaton automaton = get1SegAutomaton( map_sector_hits, criteria, stats );
+      
+      // Check if there are not too many connections
+      if( automaton.getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
          
+         streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
+         << "\tconnections( " << automaton.getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
+         continue;
          
-         // Let the automaton lengthen its 1-hit-segments to 2-hit-segments
-         automaton.lengthenSegments();
-        
+      }
+      
+      
+      
+      /**********************************************************************************************/
+      /*                Automaton                                                                   */
+      /**********************************************************************************************/
+      
+      
+      
+      streamlog_out( DEBUG4 ) << "\t\t---Automaton---\n" ;
+      
+      if( _useCED ) KiTrackMarlin::drawAutomatonSegments( automaton ); // draws the 1-segments (i.e. hits)
+      
+      
+      /*******************************/
+      /*      2-hit segments         */
+      /*******************************/
+      
+      streamlog_out( DEBUG4 ) << "\t\t--2-hit-Segments--\n" ;
+      
+      streamlog_out(DEBUG4) << "Automaton has " << automaton.getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
+      
+      automaton.clearCriteria();
+      automaton.addCriteria( criteria.crit3Vec );  // Add the criteria for 3 hits (i.e. 2 2-hit segments )
+      
+      
+      // Let the automaton lengthen its 1-hit-segments to 2-hit-segments (the segments of earlier automata are gone)
+      SegmentGeometryCache::getThreadCache().clear();
+      automaton.lengthenSegments();
+     
 	 
 	 // std::vector<const KiTrack::Segment* > vec_seg_2hits = automaton.getSegments();
 	 // for(size_t is=0; is<vec_seg_2hits.size(); is++){
@@ -603,44 +1567,45 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
 	 //   streamlog_out( DEBUG2 ) << "-- segment " << is << " has nchildren " << test_segment->getChildren().size() << std::endl ;  
 	 // }
 
+      
+      // So now we have 2-hit-segments and are ready to perform the Cellular Automaton.
+      
+      // Perform the automaton
+      automaton.doAutomaton();
+      
+      
+      // Clean segments with bad states
+      automaton.cleanBadStates();
+      
+     
+      // Reset the states of all segments
+      automaton.resetStates();
+     
+      streamlog_out(DEBUG4) << "Automaton has " << automaton.getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
+      
+      
+      // Check if there are not too many connections
+      if( automaton.getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
          
-         // So now we have 2-hit-segments and are ready to perform the Cellular Automaton.
-         
-         // Perform the automaton
-         automaton.doAutomaton();
-         
-         
-         // Clean segments with bad states
-         automaton.cleanBadStates();
-         
-        
-         // Reset the states of all segments
-         automaton.resetStates();
-        
-         streamlog_out(DEBUG4) << "Automaton has " << automaton.getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
-         
-         
-         // Check if there are not too many connections
-         if( automaton.getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
-            
-            streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
-            << "\tconnections( " << automaton.getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
-            continue;
-            
-         }
-         
-         /*******************************/
-         /*      3-hit segments         */
-         /*******************************/
-         streamlog_out( DEBUG4 ) << "\t\t--3-hit-Segments--\n" ;
-         
-         
-         automaton.clearCriteria();
-         automaton.addCriteria( _crit4Vec );      
-         
+         streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
+         << "\tconnections( " << automaton.getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
+         continue;
          
-         // Lengthen the 2-hit-segments to 3-hits-segments
-         automaton.lengthenSegments();
+      }
+      
+      /*******************************/
+      /*      3-hit segments         */
+      /*******************************/
+      streamlog_out( DEBUG4 ) << "\t\t--3-hit-Segments--\n" ;
+      
+      
+      automaton.clearCriteria();
+      automaton.addCriteria( criteria.crit4Vec );      
+      
+      
+      // Lengthen the 2-hit-segments to 3-hits-segments (cleanBadStates deleted segments the cache may know)
+      SegmentGeometryCache::getThreadCache().clear();
+      automaton.lengthenSegments();
  
 	 
 	 // std::vector<const KiTrack::Segment* > vec_seg_3hits = automaton.getSegments();
@@ -652,202 +1617,216 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
 	 //   streamlog_out( DEBUG2 ) << "-- info segment = " << info_seg.c_str() << std::endl ; 
 	 // }
 	 // //std::vector < std::vector< IHit* > > test_tracks_segment = getTracksOfSegment();
-        
-         
-         // Perform the Cellular Automaton
-         automaton.doAutomaton();
-         
-         //Clean segments with bad states
-         automaton.cleanBadStates();
-         
-         
-         //Reset the states of all segments
-         automaton.resetStates();
-         
+     
+      
+      // Perform the Cellular Automaton
+      automaton.doAutomaton();
+      
+      //Clean segments with bad states
+      automaton.cleanBadStates();
+      
+      
+      //Reset the states of all segments
+      automaton.resetStates();
+      
 
 
+   
+      streamlog_out(DEBUG4) << "Automaton has " << automaton.getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
       
-         streamlog_out(DEBUG4) << "Automaton has " << automaton.getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
+      
+      // Check if there are not too many connections
+      if( automaton.getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
+         
+         streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
+         << "\tconnections( " << automaton.getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
+         continue;
+         
+      }
+      
+      // get the raw tracks (raw track = just a vector of hits, the most rudimentary form of a track)
+      if( _maxPathsPerSegment > 0 ){
          
+         // every raw track goes to the consumer as soon as it is found
+         BestFirstTrackExtractor extractor( _maxPathsPerSegment, 3 );
+         extractor.extractTracks( automaton, consumer );
          
-         // Check if there are not too many connections
-         if( automaton.getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
+         stats.nExtractionStartSegments += extractor.getNStartSegments();
+         stats.nExtractionLimitHit += extractor.getNLimitHit();
+         
+         if( extractor.getNLimitHit() > 0 ){
             
-            streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
-            << "\tconnections( " << automaton.getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
-            continue;
+            streamlog_out( DEBUG4 ) << "Raw track extraction: " << extractor.getNLimitHit() << " of " << extractor.getNStartSegments() 
+            << " outermost segments had more than " << _maxPathsPerSegment << " paths (MaxPathsPerSegment)\n";
             
          }
          
-         // get the raw tracks (raw track = just a vector of hits, the most rudimentary form of a track)
-         rawTracks = automaton.getTracks( 3 );
+      }
+      else{
+         
+         std::vector < RawTrack > rawTracks = automaton.getTracks( 3 );
          
-         break; // if we reached this place all went well and we don't need another round --> exit the loop
+         for( unsigned i=0; i < rawTracks.size(); i++ ) if( !consumer( rawTracks[i] ) ) break;
          
       }
       
-      streamlog_out( DEBUG4 ) << "Automaton returned " << rawTracks.size() << " raw tracks \n";
-      
-      
-      /**********************************************************************************************/
-      /*                Add the overlapping hits                                                    */
-      /**********************************************************************************************/
-      
-      
-      streamlog_out( DEBUG4 ) << "\t\t---Add hits from overlapping petals + fit + helix and Kalman cuts---\n" ;
+      break; // if we reached this place all went well and we don't need another round --> exit the loop
       
+   }
+   
+   
+}
+
+
+void SiliconEndcapTracking::addTrackCandidates( const RawTrack& rawTrack,
+                                                std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                                MarlinTrk::IMarlinTrkSystem* trkSystem,
+                                                std::vector< ITrack* >& trackCandidates,
+                                                CandidateSearchStats& stats ){
+   
+   
+   stats.nTrackCandidates++;
+   
+   
+	 // for not breaking the code put something dummy - rawtracksplus are excatly the rawtracks no additional tracks are added
+   // // get all versions of the track plus hits from overlapping petals
+   std::vector < RawTrack > rawTracksPlus = getRawTracksPlusOverlappingHits( rawTrack, map_hitFront_hitsBack );
+   
+   streamlog_out( DEBUG2 ) << "For the raw track there are " << rawTracksPlus.size() << " versions\n";
+   
+   
+   /**********************************************************************************************/
+   /*                Make track candidates, fit them and throw away bad ones                     */
+   /**********************************************************************************************/
+   
+
+
+   std::vector< ITrack* > overlappingTrackCands;
+   
+
+   for( unsigned j=0; j < rawTracksPlus.size(); j++ ){
       
-      std::vector <ITrack*> trackCandidates;
+      stats.nTrackCandidatesPlus++;
       
+      RawTrack rawTrackPlus = rawTracksPlus[j];
       
-      // for all raw tracks we got from the automaton
-      for( unsigned i=0; i < rawTracks.size(); i++){
+      if( rawTrackPlus.size() < unsigned( _hitsPerTrackMin ) ){
          
+         streamlog_out( DEBUG2 ) << "Trackversion discarded, too few hits: only " << rawTrackPlus.size() << " < " << _hitsPerTrackMin << "(hitsPerTrackMin)\n";
+         continue;
          
-         RawTrack rawTrack = rawTracks[i];
+      }
+      
+
+      EndcapTrack* trackCand = new EndcapTrack( trkSystem );
+      
+      // add the hits to the track
+      for( unsigned k=0; k<rawTrackPlus.size(); k++ ){
          
-         _nTrackCandidates++;
+         IEndcapHit* endcapHit = dynamic_cast< IEndcapHit* >( rawTrackPlus[k] ); // cast to IEndcapHits, as needed for an EndcapTrack
+         if( endcapHit != NULL ) trackCand->addHit( endcapHit );
+         else streamlog_out( DEBUG4 ) << "Hit " << rawTrackPlus[k] << " could not be casted to IEndcapHit\n";
          
+      }
+
+      
+      std::vector< IHit* > trackCandHits = trackCand->getHits();
+      streamlog_out( DEBUG2 ) << "-- Evt " << _nEvt <<" -- Fitting track candidate with " << trackCandHits.size() << " hits\n";
+      
+      for( unsigned k=0; k < trackCandHits.size(); k++ ) streamlog_out( DEBUG1 ) << trackCandHits[k]->getPositionInfo();
+      streamlog_out( DEBUG1 ) << "\n";
+      
+      /*-----------------------------------------------*/
+      /*                Helix Fit                      */
+      /*-----------------------------------------------*/
+      
+      streamlog_out( DEBUG2 ) << "Fitting with Helix Fit\n";
+      try{
          
-	 // for not breaking the code put something dummy - rawtracksplus are excatly the rawtracks no additional tracks are added
-         // // get all versions of the track plus hits from overlapping petals
-         std::vector < RawTrack > rawTracksPlus = getRawTracksPlusOverlappingHits( rawTrack, map_hitFront_hitsBack );
+         EndcapHelixFitter helixFitter( trackCand->getLcioTrack() );
+         float chi2OverNdf = helixFitter.getChi2() / float( helixFitter.getNdf() );
+         streamlog_out( DEBUG2 ) << "chi2OverNdf = " << chi2OverNdf << "\n";
          
-         streamlog_out( DEBUG2 ) << "For raw track number " << i << " there are " << rawTracksPlus.size() << " versions\n";
+         if( chi2OverNdf > _helixFitMax ){
+            
+            streamlog_out( DEBUG2 ) << "Discarding track because of bad helix fit: chi2/ndf = " << chi2OverNdf << "\n";
+            delete trackCand;
+            continue;
+            
+         }
+         else streamlog_out( DEBUG2 ) << "Keeping track because of good helix fit: chi2/ndf = " << chi2OverNdf << "\n";
          
+      }
+      catch( EndcapHelixFitterException e ){
          
-         /**********************************************************************************************/
-         /*                Make track candidates, fit them and throw away bad ones                     */
-         /**********************************************************************************************/
          
-
-
-         std::vector< ITrack* > overlappingTrackCands;
+         streamlog_out( DEBUG3 ) << "Track rejected, because fit failed: " <<  e.what() << "\n";
+         delete trackCand;
+         continue;
          
-
-         for( unsigned j=0; j < rawTracksPlus.size(); j++ ){
-            
-            _nTrackCandidatesPlus++;
-            
-            RawTrack rawTrackPlus = rawTracksPlus[j];
-            
-            if( rawTrackPlus.size() < unsigned( _hitsPerTrackMin ) ){
-               
-               streamlog_out( DEBUG2 ) << "Trackversion discarded, too few hits: only " << rawTrackPlus.size() << " < " << _hitsPerTrackMin << "(hitsPerTrackMin)\n";
-               continue;
-               
-            }
-            
-
-            EndcapTrack* trackCand = new EndcapTrack( _trkSystem );
+      }
+      
+      /*-----------------------------------------------*/
+      /*                Kalman Fit                      */
+      /*-----------------------------------------------*/
+      
+      streamlog_out( DEBUG2 ) << "Fitting with Kalman Filter\n";
+      try{
             
-            // add the hits to the track
-            for( unsigned k=0; k<rawTrackPlus.size(); k++ ){
-               
-               IEndcapHit* endcapHit = dynamic_cast< IEndcapHit* >( rawTrackPlus[k] ); // cast to IEndcapHits, as needed for an EndcapTrack
-               if( endcapHit != NULL ) trackCand->addHit( endcapHit );
-               else streamlog_out( DEBUG4 ) << "Hit " << rawTrackPlus[k] << " could not be casted to IEndcapHit\n";
-               
-            }
-
+         trackCand->fit();
             
-            std::vector< IHit* > trackCandHits = trackCand->getHits();
-            streamlog_out( DEBUG2 ) << "-- Evt " << _nEvt <<" -- Fitting track candidate with " << trackCandHits.size() << " hits\n";
+         streamlog_out( DEBUG2 ) << " Track " << trackCand 
+                                 << " chi2Prob = " << trackCand->getChi2Prob() 
+                                 << "( chi2=" << trackCand->getChi2() 
+                                 <<", Ndf=" << trackCand->getNdf() << " )\n";
             
-            for( unsigned k=0; k < trackCandHits.size(); k++ ) streamlog_out( DEBUG1 ) << trackCandHits[k]->getPositionInfo();
-            streamlog_out( DEBUG1 ) << "\n";
             
-            /*-----------------------------------------------*/
-            /*                Helix Fit                      */
-            /*-----------------------------------------------*/
+         if ( trackCand->getChi2Prob() >= _chi2ProbCut ){
             
-            streamlog_out( DEBUG2 ) << "Fitting with Helix Fit\n";
-            try{
-               
-               EndcapHelixFitter helixFitter( trackCand->getLcioTrack() );
-               float chi2OverNdf = helixFitter.getChi2() / float( helixFitter.getNdf() );
-               streamlog_out( DEBUG2 ) << "chi2OverNdf = " << chi2OverNdf << "\n";
-               
-               if( chi2OverNdf > _helixFitMax ){
-                  
-                  streamlog_out( DEBUG2 ) << "Discarding track because of bad helix fit: chi2/ndf = " << chi2OverNdf << "\n";
-                  delete trackCand;
-                  continue;
-                  
-               }
-               else streamlog_out( DEBUG2 ) << "Keeping track because of good helix fit: chi2/ndf = " << chi2OverNdf << "\n";
-               
-            }
-            catch( EndcapHelixFitterException e ){
-               
-               
-               streamlog_out( DEBUG3 ) << "Track rejected, because fit failed: " <<  e.what() << "\n";
-               delete trackCand;
-               continue;
-               
-            }
+            streamlog_out( DEBUG2 ) << "Track accepted (chi2prob " << trackCand->getChi2Prob() << " >= " << _chi2ProbCut << "\n";
             
-            /*-----------------------------------------------*/
-            /*                Kalman Fit                      */
-            /*-----------------------------------------------*/
+         }
+         else{
             
-            streamlog_out( DEBUG2 ) << "Fitting with Kalman Filter\n";
-            try{
-                  
-               trackCand->fit();
-                  
-               streamlog_out( DEBUG2 ) << " Track " << trackCand 
-                                       << " chi2Prob = " << trackCand->getChi2Prob() 
-                                       << "( chi2=" << trackCand->getChi2() 
-                                       <<", Ndf=" << trackCand->getNdf() << " )\n";
-                  
-                  
-               if ( trackCand->getChi2Prob() >= _chi2ProbCut ){
-                  
-                  streamlog_out( DEBUG2 ) << "Track accepted (chi2prob " << trackCand->getChi2Prob() << " >= " << _chi2ProbCut << "\n";
-                  
-               }
-               else{
-                  
-                  streamlog_out( DEBUG2 ) << "Track rejected (chi2prob " << trackCand->getChi2Prob() << " < " << _chi2ProbCut << "\n";
-                  delete trackCand;
-                  
-                  continue;
-                  
-               }
-               
-               
-            }
-            catch( FitterException e ){
-               
-               
-               streamlog_out( DEBUG3 ) << "Track rejected, because fit failed: " <<  e.what() << "\n";
-               delete trackCand;
-               continue;
-               
-            }
+            streamlog_out( DEBUG2 ) << "Track rejected (chi2prob " << trackCand->getChi2Prob() << " < " << _chi2ProbCut << "\n";
+            delete trackCand;
             
-            // If we reach this point than the track got accepted by all cuts
-            overlappingTrackCands.push_back( trackCand );
+            continue;
             
          }
          
-         /**********************************************************************************************/
-         /*                Take the best version of the track                                          */
-         /**********************************************************************************************/
-        // Now we have all versions of one track, coming from adding possible hits from overlapping petals.
          
-         if( _takeBestVersionOfTrack ){ // we want to take only the best version
-            
-            
-            streamlog_out( DEBUG2 ) << "Take the version of the track with best quality from " << overlappingTrackCands.size() << " track candidates\n";
+      }
+      catch( FitterException e ){
+         
+         
+         streamlog_out( DEBUG3 ) << "Track rejected, because fit failed: " <<  e.what() << "\n";
+         delete trackCand;
+         continue;
+         
+      }
+      
+      // If we reach this point than the track got accepted by all cuts
+      overlappingTrackCands.push_back( trackCand );
+      
+   }
+   
+   /**********************************************************************************************/
+   /*                Take the best version of the track                                          */
+   /**********************************************************************************************/
+  // Now we have all versions of one track, coming from adding possible hits from overlapping petals.
+   
+   if( _takeBestVersionOfTrack ){ // we want to take only the best version
+      
+      
+      streamlog_out( DEBUG2 ) << "Take the version of the track with best quality from " << overlappingTrackCands.size() << " track candidates\n";
+      
+      if( !overlappingTrackCands.empty() ){
+         
+         ITrack* bestTrack = overlappingTrackCands[0];
+         
+         for( unsigned j=1; j < overlappingTrackCands.size(); j++ ){
             
-            if( !overlappingTrackCands.empty() ){
-               
-               ITrack* bestTrack = overlappingTrackCands[0];
-               
-               for( unsigned j=1; j < overlappingTrackCands.size(); j++ ){
-                  
 		 
 		 //if( overlappingTrackCands[j]->getChi2Prob() > bestTrack->getChi2Prob() ){
 		 if( overlappingTrackCands[j]->getHits().size() > bestTrack->getHits().size() ){ // ATM NO VERY IMPORTANT WITH CRITERIA BECAUSE I AM NOT CONSIDERING OVERLAPPING HITS FOR DIFFERENT VERSION OF THE SAME TRACK
@@ -855,239 +1834,429 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
 		 //bool muchBetterChi2 = (diffChi2<-0.1);
 		 //bool moreHits = (overlappingTrackCands[j]->getHits().size() > bestTrack->getHits().size());
 		 //if (muchBetterChi2 || moreHits){
-                     delete bestTrack; //delete the old one, not needed anymore
-                     bestTrack = overlappingTrackCands[j];
-                  }
-                  else{
-                     
-                     delete overlappingTrackCands[j]; //delete this one
-                     
-                  }
-                  
-               }
-               streamlog_out( DEBUG2 ) << "Adding best track candidate with " << bestTrack->getHits().size() << " hits\n";
+               delete bestTrack; //delete the old one, not needed anymore
+               bestTrack = overlappingTrackCands[j];
+            }
+            else{
                
-               trackCandidates.push_back( bestTrack );
+               delete overlappingTrackCands[j]; //delete this one
                
             }
             
          }
-         else{ // we take all versions
-            
-            streamlog_out( DEBUG2 ) << "Taking all " << overlappingTrackCands.size() << " versions of the track\n";
-            trackCandidates.insert( trackCandidates.end(), overlappingTrackCands.begin(), overlappingTrackCands.end() );
-            
-         }
+         streamlog_out( DEBUG2 ) << "Adding best track candidate with " << bestTrack->getHits().size() << " hits\n";
+         
+         trackCandidates.push_back( bestTrack );
          
       }
       
-      if( _useCED ){
-//          for( unsigned i=0; i < trackCandidates.size(); i++ ) KiTrackMarlin::drawTrackRandColor( trackCandidates[i] );
+   }
+   else{ // we take all versions
+      
+      streamlog_out( DEBUG2 ) << "Taking all " << overlappingTrackCands.size() << " versions of the track\n";
+      trackCandidates.insert( trackCandidates.end(), overlappingTrackCands.begin(), overlappingTrackCands.end() );
+      
+   }
+   
+}
+
+
+std::vector< ITrack* > SiliconEndcapTracking::streamTrackCandidates( std::map< int , std::vector< IHit* > >& map_sector_hits,
+                                                                    std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                                                    MarlinTrk::IMarlinTrkSystem* trkSystem,
+                                                                    unsigned firstRound,
+                                                                    CandidateSearchStats& stats ){
+   
+   
+   // A worker builds the segments, runs the automaton and puts the extracted raw tracks into the queue.
+   // They are fitted here, so the fit (MarlinTrk is not thread-safe) stays in the calling thread.
+   // The worker has its own counters, they are added after it is joined.
+   BoundedQueue< RawTrack > queue( _rawTrackQueueSize );
+   CandidateSearchStats searchStats;
+   std::exception_ptr searchException;
+   
+   std::thread searcher( [ this, &queue, &map_sector_hits, firstRound, &searchStats, &searchException ](){
+      
+      try{
+         
+         // a closed queue (the fit failed) stops the extraction
+         findRawTracks( map_sector_hits, firstRound, searchStats, [ &queue ]( RawTrack& rawTrack ){ return queue.push( std::move( rawTrack ) ); } );
+         
       }
+      catch( ... ){
+         
+         searchException = std::current_exception();
+         
+      }
+      
+      queue.close(); // the fit takes what is left and is done then
+      
+   } );
+   
+   
+   std::vector< ITrack* > trackCandidates;
+   
+   try{
+      
+      RawTrack rawTrack;
+      while( queue.pop( rawTrack ) ) addTrackCandidates( rawTrack, map_hitFront_hitsBack, trkSystem, trackCandidates, stats );
+      
+   }
+   catch( ... ){
+      
+      queue.close(); // so the extraction stops instead of waiting for a full queue
+      searcher.join();
+      
+      for( unsigned i=0; i < trackCandidates.size(); i++ ) delete trackCandidates[i];
+      throw;
+      
+   }
+   
+   searcher.join();
+   
+   stats.nExtractionStartSegments += searchStats.nExtractionStartSegments;
+   stats.nExtractionLimitHit += searchStats.nExtractionLimitHit;
+   stats.nPairsChecked += searchStats.nPairsChecked;
+   stats.nPairsRejectedByAcceptance += searchStats.nPairsRejectedByAcceptance;
+   
+   if( searchException ){
+      
+      for( unsigned i=0; i < trackCandidates.size(); i++ ) delete trackCandidates[i];
+      std::rethrow_exception( searchException );
+      
+   }
+   
+   return trackCandidates;
+   
+   
+}
+
+
+bool SiliconEndcapTracking::canRunInThreads() const {
+   
+   // CED and streamlog are not thread-safe: with drawing or debug output everything runs in the calling thread
+   return !_useCED && !streamlog_level( DEBUG9 );
+   
+}
+
+
+
+std::vector< ITrack* > SiliconEndcapTracking::findTrackCandidatesInPhiWedges( std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                                                             unsigned firstRound,
+                                                                             CandidateSearchStats& stats ){
+   
+   
+   // Every wedge gets the sectors of its core phi bins plus a halo of _phiWedgeHalo phi bins on each side,
+   // so tracks crossing the wedge border can still be found. The IP (layer 0) belongs to every wedge.
+   // A track is only kept by the wedge whose core contains the phi bin of its outermost hit, which removes
+   // the duplicates found in the halos of the neighbouring wedges.
+   
+   unsigned nWedges = _nPhiWedges;
+   
+   std::vector< std::map< int , std::vector< IHit* > > > wedgeMaps( nWedges );
+   
+   std::map< int , std::vector< IHit* > >::iterator it;
+   
+   for( it = _map_sector_hits.begin(); it != _map_sector_hits.end(); it++ ){
       
-      /**********************************************************************************************/
-      /*               Get the best subset of tracks                                                */
-      /**********************************************************************************************/
+      int sector = it->first;
       
-      streamlog_out(DEBUG3) << "The track candidates so far: \n";
-      for( unsigned iTrack=0; iTrack < trackCandidates.size(); iTrack++ ){
+      for( unsigned w=0; w < nWedges; w++ ){
          
-         streamlog_out(DEBUG3) << "track " << iTrack << ": " << trackCandidates[iTrack] << "\t" << KiTrackMarlin::getTrackHitInfo( trackCandidates[iTrack] ) << "\n";
+         if( _sectorSystemEndcap->getLayer( sector ) == 0 || isInPhiWedge( _sectorSystemEndcap->getPhi( sector ), w, _phiWedgeHalo ) ){
+            
+            wedgeMaps[w][ sector ] = it->second;
+            
+         }
          
       }
       
-      streamlog_out( DEBUG4 ) << "\t\t---Get best subset of tracks---\n" ;
-      
-      std::vector< ITrack* > tracks;
-      std::vector< ITrack* > rejected;
-      
-      TrackCompatibilityShare1SP comp;
-      // TrackQIChi2Prob trackQI;
-      // TrackQIChi2ProbSpecial trackQIChi2ProbSpecial;
-      TrackNHits trackNHits;
-      
-      
+   }
+   
+   
+   // Only segment building and the automaton run in the wedges. The raw tracks are fitted afterwards in the calling
+   // thread, one after the other: the MarlinTrk fit (KalTest, DD4hep, ROOT) has global state and is not thread-safe.
+   std::vector< std::vector< RawTrack > > wedgeRawTracks( nWedges );
+   std::vector< CandidateSearchStats > wedgeStats( nWedges );
+   std::vector< std::exception_ptr > wedgeExceptions( nWedges );
+   
+   // The criteria sets are shared by all wedges. This is safe, because the criteria of KiTrack only write their
+   // values (_map_name_value) if saveValues is on, which it isn't here, so checking segments doesn't change them
+   // (the counters of the warm-up are atomic).
+   auto searchWedge = [ this, firstRound, &wedgeMaps, &wedgeRawTracks, &wedgeStats, &wedgeExceptions ]( unsigned w ){
       
-      if( _bestSubsetFinder == "SubsetHopfieldNN" ){
-         
-         streamlog_out( DEBUG3 ) << "Use SubsetHopfieldNN for getting the best subset\n" ;
-         
-         SubsetHopfieldNN< ITrack* > subset;
-         subset.setOmega( _HNN_Omega );
-         subset.setActivationThreshold( _HNN_ActivationThreshold );
-         subset.setTInf( _HNN_TInf );
-         subset.add( trackCandidates );
-         
-         
-         //subset.calculateBestSet( comp, trackQIChi2ProbSpecial );
-         subset.calculateBestSet( comp, trackNHits );
+      try{
          
-         tracks = subset.getAccepted();
-         rejected = subset.getRejected();
+         std::vector< RawTrack >& rawTracks = wedgeRawTracks[w];
+         findRawTracks( wedgeMaps[w], firstRound, wedgeStats[w], [ &rawTracks ]( RawTrack& rawTrack ){ rawTracks.push_back( rawTrack ); return true; } );
          
       }
-      else if( _bestSubsetFinder == "SubsetSimple" ){
+      catch( ... ){
          
-         streamlog_out( DEBUG3 ) << "Use SubsetSimple for getting the best subset\n" ;
+         wedgeExceptions[w] = std::current_exception();
          
-         SubsetSimple< ITrack* > subset;
-         subset.add( trackCandidates );
-         //subset.calculateBestSet( comp, trackQIChi2ProbSpecial );
-         subset.calculateBestSet( comp, trackNHits );
-         tracks = subset.getAccepted();
-         rejected = subset.getRejected();
-         
-      }
-      else { // in any other case take all tracks
-         
-         streamlog_out( DEBUG3 ) << "Input for subset = \"" << _bestSubsetFinder << "\". All tracks are kept\n" ;
-         
-         tracks = trackCandidates;
-         
-      }
-      
-      
-      if( _useCED ){
-//          for( unsigned i=0; i < tracks.size(); i++ ) KiTrackMarlin::drawTrack( tracks[i] , 0x00ff00 );
-//          for( unsigned i=0; i < rejected.size(); i++ ) KiTrackMarlin::drawTrack( rejected[i] , 0xff0000 );
       }
       
+   };
+   
+   if( canRunInThreads() ){
       
-      for ( unsigned i=0; i<rejected.size(); i++){
-         
-         delete rejected[i];
-         
-      }
-      
+      std::vector< std::thread > threads;
+      for( unsigned w=0; w < nWedges; w++ ) threads.push_back( std::thread( searchWedge, w ) );
+      for( unsigned w=0; w < nWedges; w++ ) threads[w].join();
       
+   }
+   else{ // with debug output or CED drawing the wedges run one after the other
       
-      /**********************************************************************************************/
-      /*               Finally: Finalise and save the tracks                                        */
-      /**********************************************************************************************/
+      for( unsigned w=0; w < nWedges; w++ ) searchWedge( w );
       
-      streamlog_out( DEBUG4 ) << "\t\t---Save Tracks---\n" ;
+   }
+   
+   
+   for( unsigned w=0; w < nWedges; w++ ){
       
-      LCCollectionVec * trkCol = new LCCollectionVec(LCIO::TRACK);
+      stats.nExtractionStartSegments += wedgeStats[w].nExtractionStartSegments;
+      stats.nExtractionLimitHit += wedgeStats[w].nExtractionLimitHit;
+      stats.nPairsChecked += wedgeStats[w].nPairsChecked;
+      stats.nPairsRejectedByAcceptance += wedgeStats[w].nPairsRejectedByAcceptance;
       
-      // Set the flags
-      LCFlagImpl hitFlag(0) ;
-      hitFlag.setBit( LCIO::TRBIT_HITS ) ;
-      trkCol->setFlag( hitFlag.getFlag()  ) ;
+      if( wedgeExceptions[w] ) std::rethrow_exception( wedgeExceptions[w] );
       
+   }
+   
+   
+   std::vector< ITrack* > trackCandidates;
+   unsigned nRawTracks = 0;
+   unsigned nHaloDuplicates = 0;
+   
+   for( unsigned w=0; w < nWedges; w++ ){
       
-      for (unsigned int i=0; i < tracks.size(); i++){
+      for( unsigned i=0; i < wedgeRawTracks[w].size(); i++ ){
          
-	//FTDTrack* myTrack = dynamic_cast< FTDTrack* >( tracks[i] );
-         EndcapTrack* myTrack = dynamic_cast< EndcapTrack* >( tracks[i] );
+         const RawTrack& rawTrack = wedgeRawTracks[w][i];
          
-         if( myTrack != NULL ){
-            
+         // the outermost hit is the one furthest from the IP (like in the sorting of an EndcapTrack)
+         IHit* outermostHit = NULL;
+         float r2Max = -1.f;
+         
+         for( unsigned k=0; k < rawTrack.size(); k++ ){
             
-            TrackImpl* trackImpl = new TrackImpl( *(myTrack->getLcioTrack()) );
+            IHit* hit = rawTrack[k];
+            float r2 = hit->getX()*hit->getX() + hit->getY()*hit->getY() + hit->getZ()*hit->getZ();
             
-            try{
-               
-               finaliseTrack( trackImpl );
-               trkCol->addElement( trackImpl );
+            if( r2 > r2Max ){
                
-            }
-            catch( FitterException e ){
+               r2Max = r2;
+               outermostHit = hit;
                
-               streamlog_out( DEBUG4 ) << "SiliconEndcapTracking: track couldn't be finalized due to fitter error: " << e.what() << "\n";
-               delete trackImpl;
             }
             
-            
          }
          
-         
-      }
-     
-      // set the quality of the output collection
-      switch (_output_track_col_quality) {
-         
-         case _output_track_col_quality_FAIR:
-            trkCol->parameters().setValue( "QualityCode" , "Fair"  ) ;
-            break;
+         if( outermostHit == NULL || !isInPhiWedge( _sectorSystemEndcap->getPhi( outermostHit->getSector() ), w, 0 ) ){
             
-         case _output_track_col_quality_POOR:
-            trkCol->parameters().setValue( "QualityCode" , "Poor"  ) ;
-            break;
+            nHaloDuplicates++;
+            continue;
             
-         default:
-            trkCol->parameters().setValue( "QualityCode" , "Good"  ) ;
-            break;
+         }
+         
+         nRawTracks++;
+         addTrackCandidates( rawTrack, map_hitFront_hitsBack, _trkSystem, trackCandidates, stats );
+         
       }
+      
+   }
+   
+   streamlog_out( DEBUG4 ) << "Phi wedges: " << nRawTracks << " raw tracks fitted, " 
+   << nHaloDuplicates << " removed as they belong to the core of another wedge\n";
+   
+   
+   return trackCandidates;
+   
+}
 
-      evt->addCollection(trkCol,_ForwardTrackCollection.c_str());
+
+std::vector< ITrack* > SiliconEndcapTracking::getBestSubset( std::vector< ITrack* >& trackCandidates ){
+   
+   
+   streamlog_out(DEBUG3) << "The track candidates so far: \n";
+   for( unsigned iTrack=0; iTrack < trackCandidates.size(); iTrack++ ){
       
+      streamlog_out(DEBUG3) << "track " << iTrack << ": " << trackCandidates[iTrack] << "\t" << KiTrackMarlin::getTrackHitInfo( trackCandidates[iTrack] ) << "\n";
       
+   }
+   
+   streamlog_out( DEBUG4 ) << "\t\t---Get best subset of tracks---\n" ;
+   
+   std::vector< ITrack* > tracks;
+   std::vector< ITrack* > rejected;
+   
+   TrackCompatibilityShare1SP comp;
+   // TrackQIChi2Prob trackQI;
+   // TrackQIChi2ProbSpecial trackQIChi2ProbSpecial;
+   TrackNHits trackNHits;
+   
+   
+   
+   if( _bestSubsetFinder == "SubsetHopfieldNN" ){
       
-      streamlog_out (DEBUG5) << "Forward Tracking found and saved " << tracks.size() << " tracks in event " << _nEvt << "\n"; 
-      for (size_t itrack=0; itrack<tracks.size(); itrack++){
-	streamlog_out (DEBUG5) << " track " << itrack << " has nhits " << tracks.at(itrack)->getHits().size() << "\n";
-	for (size_t ihit=0; ihit<tracks.at(itrack)->getHits().size(); ihit++){
-	  streamlog_out (DEBUG5) << " hit z " << tracks.at(itrack)->getHits().at(ihit)->getZ() << "\n"; 
-	}
-      }
-      streamlog_out (DEBUG5) << "\n"; 
+      streamlog_out( DEBUG3 ) << "Use SubsetHopfieldNN for getting the best subset\n" ;
       
-      /**********************************************************************************************/
-      /*                Clean up                                                                    */
-      /**********************************************************************************************/
+      SubsetHopfieldNN< ITrack* > subset;
+      subset.setOmega( _HNN_Omega );
+      subset.setActivationThreshold( _HNN_ActivationThreshold );
+      subset.setTInf( _HNN_TInf );
+      subset.add( trackCandidates );
       
-      // delete all the created IHits
-      for ( unsigned i=0; i<hitsTBD.size(); i++ )  delete hitsTBD[i];
       
-      // delete the FTracks
-      for (unsigned int i=0; i < tracks.size(); i++){ delete tracks[i];}
+      //subset.calculateBestSet( comp, trackQIChi2ProbSpecial );
+      subset.calculateBestSet( comp, trackNHits );
+      
+      tracks = subset.getAccepted();
+      rejected = subset.getRejected();
       
+   }
+   else if( _bestSubsetFinder == "SubsetSimple" ){
       
+      streamlog_out( DEBUG3 ) << "Use SubsetSimple for getting the best subset\n" ;
       
+      SubsetSimple< ITrack* > subset;
+      subset.add( trackCandidates );
+      //subset.calculateBestSet( comp, trackQIChi2ProbSpecial );
+      subset.calculateBestSet( comp, trackNHits );
+      tracks = subset.getAccepted();
+      rejected = subset.getRejected();
+      
+   }
+   else { // in any other case take all tracks
+      
+      streamlog_out( DEBUG3 ) << "Input for subset = \"" << _bestSubsetFinder << "\". All tracks are kept\n" ;
+      
+      tracks = trackCandidates;
+      
+   }
+   
+   
+   if( _useCED ){
+//          for( unsigned i=0; i < tracks.size(); i++ ) KiTrackMarlin::drawTrack( tracks[i] , 0x00ff00 );
+//          for( unsigned i=0; i < rejected.size(); i++ ) KiTrackMarlin::drawTrack( rejected[i] , 0xff0000 );
+   }
+   
+   
+   for ( unsigned i=0; i<rejected.size(); i++){
+      
+      delete rejected[i];
       
    }
-
-
-
-
-   if( _useCED ) MarlinCED::draw(this);
-
-
-   _nEvt ++ ;
+   
+   return tracks;
    
 }
 
 
+unsigned SiliconEndcapTracking::removeHitsOfTracks( const std::vector< ITrack* >& tracks,
+                                                    std::map< int , std::vector< IHit* > >& map_sector_hits,
+                                                    std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack ){
+   
+   
+   std::set< IHit* > usedHits;
+   
+   for( unsigned i=0; i < tracks.size(); i++ ){
+      
+      std::vector< IHit* > hits = tracks[i]->getHits();
+      
+      for( unsigned j=0; j < hits.size(); j++ ){
+         
+         if( !hits[j]->isVirtual() ) usedHits.insert( hits[j] ); // the IP stays for the next pass
+         
+      }
+      
+   }
+   
+   if( usedHits.empty() ) return 0;
+   
+   
+   unsigned nRemoved = 0;
+   
+   std::map< int , std::vector< IHit* > >::iterator it;
+   
+   for( it = map_sector_hits.begin(); it != map_sector_hits.end(); it++ ){
+      
+      std::vector< IHit* >& hits = it->second;
+      unsigned nHits = hits.size();
+      
+      hits.erase( std::remove_if( hits.begin(), hits.end(), [ &usedHits ]( IHit* hit ){ return usedHits.count( hit ) > 0; } ), hits.end() );
+      
+      nRemoved += nHits - hits.size();
+      
+   }
+   
+   
+   // the used hits can neither be added to tracks as overlapping hits, nor can overlapping hits be added to them
+   std::map< IHit* , std::vector< IHit* > >::iterator itOverlap = map_hitFront_hitsBack.begin();
+   
+   while( itOverlap != map_hitFront_hitsBack.end() ){
+      
+      if( usedHits.count( itOverlap->first ) ){
+         
+         map_hitFront_hitsBack.erase( itOverlap++ );
+         continue;
+         
+      }
+      
+      std::vector< IHit* >& hitsBack = itOverlap->second;
+      hitsBack.erase( std::remove_if( hitsBack.begin(), hitsBack.end(), [ &usedHits ]( IHit* hit ){ return usedHits.count( hit ) > 0; } ), hitsBack.end() );
+      
+      itOverlap++;
+      
+   }
+   
+   
+   return nRemoved;
+   
+}
 
 
-
-void SiliconEndcapTracking::check( LCEvent* ) {}
+void SiliconEndcapTracking::countCandidateSearch( const CandidateSearchStats& stats ){
+   
+   _nTrackCandidates += stats.nTrackCandidates;
+   _nTrackCandidatesPlus += stats.nTrackCandidatesPlus;
+   _nExtractionStartSegments += stats.nExtractionStartSegments;
+   _nExtractionLimitHit += stats.nExtractionLimitHit;
+   _nPairsChecked += stats.nPairsChecked;
+   _nPairsRejectedByAcceptance += stats.nPairsRejectedByAcceptance;
+   
+}
 
 
-void SiliconEndcapTracking::end(){
+bool SiliconEndcapTracking::isDuplicateHit( const HitTable* hitTable, unsigned row ){
    
- 
-   for ( unsigned i=0; i< _crit2Vec.size(); i++) delete _crit2Vec[i];
-   for ( unsigned i=0; i< _crit3Vec.size(); i++) delete _crit3Vec[i];
-   for ( unsigned i=0; i< _crit4Vec.size(); i++) delete _crit4Vec[i];
-   _crit2Vec.clear();
-   _crit3Vec.clear();
-   _crit4Vec.clear();
    
-   delete _sectorSystemEndcap;
-   _sectorSystemEndcap = NULL;
-
-   // delete _sectorSystemFTD;
-   // _sectorSystemFTD = NULL;
+   // the grid holds the hits read in so far, only the ones in the neighbouring cells are compared
+   return _duplicateHitGrid->hasCloseHit( hitTable->getX( row ), hitTable->getY( row ), hitTable->getZ( row ), hitTable->getSector( row ) );
    
-   // streamlog_out( DEBUG3 ) << "There are " << _nTrackCandidates << "track candidates from CA and "<<  _nTrackCandidatesPlus
-   //    << " track Candidates with hits from overlapping hits\n"
-   //    << "The ratio is " << float( _nTrackCandidatesPlus )/_nTrackCandidates;
-
    
 }
 
 
+bool SiliconEndcapTracking::isInPhiWedge( unsigned iPhi, unsigned wedge, unsigned halo ) const {
+   
+   
+   int nPhi = _sectorSystemEndcap->getPhiSectors();
+   
+   // the core of the wedge are the phi bins [ first, last )
+   int first = ( wedge * nPhi ) / _nPhiWedges;
+   int last  = ( ( wedge + 1 ) * nPhi ) / _nPhiWedges;
+   
+   if( ( int( iPhi ) >= first ) && ( int( iPhi ) < last ) ) return true;
+   
+   // distance of iPhi from the core, going around the circle
+   int distBelow = ( first - int( iPhi ) + nPhi ) % nPhi;      // how many bins iPhi is below the first bin
+   int distAbove = ( int( iPhi ) - ( last - 1 ) + nPhi ) % nPhi; // how many bins iPhi is above the last bin
+   
+   return ( distBelow <= int( halo ) ) || ( distAbove <= int( halo ) );
+   
+}
 
 
 std::map< IHit* , std::vector< IHit* > > SiliconEndcapTracking::getOverlapConnectionMap(
@@ -1361,79 +2530,97 @@ std::vector < RawTrack > SiliconEndcapTracking::getRawTracksPlusOverlappingHits(
 }
 
 
-bool SiliconEndcapTracking::setCriteria( unsigned round ){
- 
-   // delete the old ones
-   for ( unsigned i=0; i< _crit2Vec.size(); i++) delete _crit2Vec[i];
-   for ( unsigned i=0; i< _crit3Vec.size(); i++) delete _crit3Vec[i];
-   for ( unsigned i=0; i< _crit4Vec.size(); i++) delete _crit4Vec[i];
-   _crit2Vec.clear();
-   _crit3Vec.clear();
-   _crit4Vec.clear();
-   
+Automaton SiliconEndcapTracking::get1SegAutomaton( std::map< int , std::vector< IHit* > >& map_sector_hits, const CriteriaSet& criteria,
+                                                  CandidateSearchStats& stats ){
    
    
-   bool newValuesGotUsed = false; // if new values are used
-   
-   for( unsigned i=0; i<_criteriaNames.size(); i++ ){
+   if( _batchSegmentBuilding ){
       
-      std::string critName = _criteriaNames[i];
+      // the pairs of hits are checked in batches, with the targets of the sectors from the table of the connector
+      EndcapSegmentBuilder segBuilder( map_sector_hits, _sectorConnector->getTable() );
       
+      segBuilder.addCriteria( criteria.batch2Vec );
+      segBuilder.setAcceptanceTable( _acceptanceTable );
       
-      float min = _critMinima[critName].back();
-      float max = _critMaxima[critName].back();
+      Automaton automaton = segBuilder.get1SegAutomaton();
       
+      stats.nPairsChecked += segBuilder.getNPairsChecked();
+      stats.nPairsRejectedByAcceptance += segBuilder.getNPairsRejectedByAcceptance();
       
+      return automaton;
       
-      // use the value corresponding to the round, if there are no new ones for this criterion, just do nothing (the previous value stays in place)
-      if( round + 1 <= _critMinima[critName].size() ){
-         
-         min =  _critMinima[critName][round];
-         newValuesGotUsed = true;
-         
-      }
+   }
+   
+   
+   //Create a segmentbuilder
+   SegmentBuilder segBuilder( map_sector_hits );
+   
+   segBuilder.addCriteria ( criteria.crit2Vec ); // Add the criteria on when to connect two hits.
+   
+   //Also load hit connectors (the connector is made in init and only read here)
+   segBuilder.addSectorConnector ( _sectorConnector ); // Add the sector connector (so the SegmentBuilder knows what hits from different sectors it is allowed to look for connections)
+   
+   return segBuilder.get1SegAutomaton();
+   
+   
+}
+
+
+void SiliconEndcapTracking::buildCriteriaSets(){
+   
+   
+   deleteCriteriaSets( _criteriaSets );
+   
+   _criteriaSets = makeCriteriaSets( _criteriaNames, _critMinima, _critMaxima, _compiledCriteria, &_thetaCutTable );
+   
+   for( unsigned i=0; i < _segmentClassifiers.size(); i++ ){
       
-      if( round + 1 <= _critMaxima[critName].size() ){
-         
-         max =  _critMaxima[critName][round];
-         newValuesGotUsed = true;
-         
-      }
+      addClassifierCriteria( _criteriaSets, _segmentClassifiers[i], _segmentClassifierMode == "Instead" );
+      
+   }
+   
+   PrecisionValidator* validator = _validateFloatPrecision ? &_precisionValidator : NULL;
+   
+   for( unsigned round=0; round < _criteriaSets.size(); round++ ){
       
-      ICriterion* crit = Criteria::createCriterion( critName, min , max );
+      std::vector< IBatchCriterion* >& batch2Vec = _criteriaSets[ round ].batch2Vec;
       
-      // Some debug output about the created criterion
-      std::string type = crit->getType();
+      for( unsigned i=0; i < batch2Vec.size(); i++ ) batch2Vec[i]->setPrecision( _floatPrecisionCriteria, validator );
+      
+   }
+   
+   // a compiled pipeline shows up as a single Fused(...) criterion
+   if( _batchSegmentBuilding && !_criteriaSets.empty() ){
       
-      streamlog_out( DEBUG3 ) <<  "Added: Criterion " << critName << " (type =  " << type 
-      << " ). Min = " << min
-      << ", Max = " << max
-      << ", round " << round << "\n";
+      const std::vector< IBatchCriterion* >& batch2Vec = _criteriaSets[0].batch2Vec;
       
+      streamlog_out( MESSAGE ) << "The 2-hit criteria are checked in batches by:";
+      for( unsigned i=0; i < batch2Vec.size(); i++ ) streamlog_out( MESSAGE ) << " " << batch2Vec[i]->getName();
+      streamlog_out( MESSAGE ) << "\n";
       
-      // Add the new criterion to the corresponding vector
-      if( type == "2Hit" ){
-         
-         _crit2Vec.push_back( crit );
+   }
+   
+   
+   // The prediction from the segment comes first: it is cheap and the other criteria only need to be checked within its window
+   if( _predictionPhiWindow > 0. ){
+      
+      for( unsigned round=0; round < _criteriaSets.size(); round++ ){
          
-      }
-      else if( type == "3Hit" ){
+         CriteriaSet& criteria = _criteriaSets[ round ];
          
-         _crit3Vec.push_back( crit );
+         SegmentPredictionCriterion* prediction3 = new SegmentPredictionCriterion( 3, _predictionPhiWindow, _predictionCosThetaWindow );
+         SegmentPredictionCriterion* prediction4 = new SegmentPredictionCriterion( 4, _predictionPhiWindow, _predictionCosThetaWindow );
          
-      }
-      else if( type == "4Hit" ){
+         prediction3->setPrecision( _floatPrecisionCriteria, validator );
+         prediction4->setPrecision( _floatPrecisionCriteria, validator );
          
-         _crit4Vec.push_back( crit );
+         criteria.crit3Vec.insert( criteria.crit3Vec.begin(), prediction3 );
+         criteria.crit4Vec.insert( criteria.crit4Vec.begin(), prediction4 );
          
       }
-      else delete crit;
-      
       
    }
    
-   return newValuesGotUsed;
-   
    
 }
 
@@ -1482,10 +2669,7 @@ void SiliconEndcapTracking::finaliseTrack( TrackImpl* trackImpl ){
    std::vector< TrackerHit* > trackerHits = trackImpl->getTrackerHits();
    for( unsigned j=0; j < trackerHits.size(); j++ ){
       
-      UTIL::BitField64 encoder( LCTrackerCellID::encoding_string() );
-      encoder.setValue( trackerHits[j]->getCellID0() );
-      int subdet =  encoder[lcio::LCTrackerCellID::subdet()];
-     
+      int subdet = _cellIDDecoder->getSubdet( trackerHits[j]->getCellID0() );
       
       ++hitNumbers[ subdet ];
       
@@ -1517,7 +2701,7 @@ void SiliconEndcapTracking::getCellID0AndPositionInfo(LCCollection*& col ){
 
 
   std::string cellIDEcoding = col->getParameters().getStringVal("CellIDEncoding") ;  
-  UTIL::BitField64 cellid_decoder( cellIDEcoding ) ;
+  CellIDDecoder cellid_decoder( cellIDEcoding, _subdetLayerOffsets ) ;
 
   // std::string TRICK = "system:8,barrel:3,layer:4,module:14,sensor:2,side:32:-2,strip:20";
   // UTIL::BitField64 cellid_decoder( TRICK ) ;
@@ -1527,20 +2711,12 @@ void SiliconEndcapTracking::getCellID0AndPositionInfo(LCCollection*& col ){
     TrackerHitPlane* trackerHit = dynamic_cast<TrackerHitPlane*>( col->getElementAt(i) ) ;
 
     dd4hep::long64 id = trackerHit->getCellID0();
-    cellid_decoder.setValue( id ) ;
-
-    int layer = cellid_decoder["layer"].value();
-    //int subdet = cellid_decoder["system"].value();
-    int subdet = cellid_decoder["subdet"].value();
-    int side = cellid_decoder["side"].value();
-    int module = cellid_decoder["module"].value();
-    int sensor = cellid_decoder["sensor"].value();
-
-    //if (subdet==2) layer = layer+0;
-    if (subdet==4) layer = layer+6;
-    else if (subdet==6) layer = layer+6+2;
-    else if (subdet==3) layer = layer+6;
-    else if (subdet==5) layer = layer+6+2;
+
+    int layer = cellid_decoder.getLayerWithOffset( id );
+    int subdet = cellid_decoder.getSubdet( id );
+    int side = cellid_decoder.getSide( id );
+    int module = cellid_decoder.getModule( id );
+    int sensor = cellid_decoder.getSensor( id );
 
     streamlog_out(DEBUG2) << " hit" << i
     			   << " ( subdetector: " << subdet
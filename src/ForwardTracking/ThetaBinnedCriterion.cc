@@ -0,0 +1,162 @@
+#include "ThetaBinnedCriterion.h"
+
+#include <algorithm>
+
+
+using namespace KiTrackMarlin;
+
+
+unsigned ThetaCutTable::getNRounds( const std::string& critName ) const {
+
+
+   unsigned nThetaSectors = sectorSystem->getThetaSectors();
+   unsigned nRounds = 0;
+
+   std::map< std::string , std::vector< float > >::const_iterator it;
+
+   it = minima.find( critName );
+   if( it != minima.end() ) nRounds = std::max( nRounds, unsigned( it->second.size() ) / nThetaSectors );
+
+   it = maxima.find( critName );
+   if( it != maxima.end() ) nRounds = std::max( nRounds, unsigned( it->second.size() ) / nThetaSectors );
+
+   return nRounds;
+
+
+}
+
+
+float ThetaCutTable::getValue( const std::map< std::string , std::vector< float > >& table , const std::string& critName ,
+                               unsigned round , unsigned iTheta , unsigned nThetaSectors , float globalValue ){
+
+
+   std::map< std::string , std::vector< float > >::const_iterator it = table.find( critName );
+
+   if( it == table.end() ) return globalValue;
+
+   unsigned nRows = it->second.size() / nThetaSectors;
+   if( nRows == 0 ) return globalValue;
+
+   // if there are no values for this round, the last ones stay in place
+   unsigned row = std::min( round, nRows - 1 );
+
+   return it->second[ row*nThetaSectors + iTheta ];
+
+
+}
+
+
+ThetaBinnedCriterion::ThetaBinnedCriterion( const SectorSystemEndcap* sectorSystem , const std::vector< ICriterion* >& criteria ):
+   _sectorSystem( sectorSystem ),
+   _criteria( criteria ){
+
+
+   _name = _criteria[0]->getName();
+   _type = _criteria[0]->getType();
+
+   _saveValues = false;
+
+
+}
+
+
+ThetaBinnedCriterion::~ThetaBinnedCriterion(){
+
+   for( unsigned i=0; i < _criteria.size(); i++ ) delete _criteria[i];
+
+}
+
+
+bool ThetaBinnedCriterion::areCompatible( Segment* parent , Segment* child ){
+
+
+   unsigned iTheta = _sectorSystem->getTheta( parent->getHits()[0]->getSector() );
+   iTheta = std::min( iTheta, unsigned( _criteria.size() ) - 1 );
+
+   ICriterion* crit = _criteria[ iTheta ];
+
+   crit->setSaveValues( _saveValues );
+
+   bool compatible = crit->areCompatible( parent, child );
+
+   if( _saveValues ) _map_name_value = crit->getMapOfValues();
+
+   return compatible;
+
+
+}
+
+
+ThetaBinnedBatchCriterion::ThetaBinnedBatchCriterion( const SectorSystemEndcap* sectorSystem , const std::vector< IBatchCriterion* >& criteria ):
+   _sectorSystem( sectorSystem ),
+   _criteria( criteria ){
+
+   _name = _criteria[0]->getName();
+
+}
+
+
+ThetaBinnedBatchCriterion::~ThetaBinnedBatchCriterion(){
+
+   for( unsigned i=0; i < _criteria.size(); i++ ) delete _criteria[i];
+
+}
+
+
+void ThetaBinnedBatchCriterion::setPrecision( bool useFloat , PrecisionValidator* validator ){
+
+
+   IBatchCriterion::setPrecision( useFloat, validator );
+
+   for( unsigned i=0; i < _criteria.size(); i++ ) _criteria[i]->setPrecision( useFloat, validator );
+
+
+}
+
+
+void ThetaBinnedBatchCriterion::filter( const HitPairBatch& batch , std::vector< char >& pass ) const {
+
+
+   const unsigned nPairs = batch.size();
+   if( nPairs == 0 ) return;
+
+   const unsigned lastBin = _criteria.size() - 1;
+
+   std::vector< unsigned > bins( nPairs );
+   bool oneBin = true;
+
+   for( unsigned i=0; i < nPairs; i++ ){
+
+      bins[i] = std::min( _sectorSystem->getTheta( batch.sectorA[i] ), lastBin );
+      if( bins[i] != bins[0] ) oneBin = false;
+
+   }
+
+   // The usual case: all pairs share hit a and so its theta division
+   if( oneBin ){
+
+      _criteria[ bins[0] ]->filter( batch, pass );
+      return;
+
+   }
+
+
+   // Otherwise every theta division filters a copy of the mask, with the pairs of the other divisions masked out
+   std::vector< char > passBin;
+
+   for( unsigned bin=0; bin <= lastBin; bin++ ){
+
+      if( std::find( bins.begin(), bins.end(), bin ) == bins.end() ) continue;
+
+      passBin = pass;
+      for( unsigned i=0; i < nPairs; i++ ) if( bins[i] != bin ) passBin[i] = 0;
+
+      _criteria[ bin ]->filter( batch, passBin );
+
+      for( unsigned i=0; i < nPairs; i++ ) if( bins[i] == bin ) pass[i] = passBin[i];
+
+   }
+
+
+}
+
@@ -0,0 +1,220 @@
+#include "ThetaOccupancyProfile.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <numeric>
+#include <algorithm>
+
+
+using namespace KiTrackMarlin;
+
+
+ThetaOccupancyProfile::ThetaOccupancyProfile( unsigned nBins ):
+   _counts( std::max( nBins, 1u ), 0. ),
+   _nEvents( 0 ){
+
+}
+
+
+void ThetaOccupancyProfile::fill( double cosTheta ){
+
+
+   unsigned bin = 0;
+
+   if( cosTheta >= 1. ) bin = _counts.size() - 1;
+   else if( cosTheta > -1. ) bin = std::min( unsigned( ( cosTheta + 1. ) * 0.5 * _counts.size() ), unsigned( _counts.size() ) - 1 ); // nan goes to bin 0
+
+   _counts[ bin ] += 1.;
+
+
+}
+
+
+void ThetaOccupancyProfile::add( const ThetaOccupancyProfile& profile ){
+
+
+   if( profile.getNBins() != getNBins() ){
+
+      std::stringstream s;
+      s << "ThetaOccupancyProfile: can't add a profile with " << profile.getNBins() << " bins to one with " << getNBins();
+      throw std::invalid_argument( s.str() );
+
+   }
+
+   for( unsigned bin=0; bin < _counts.size(); bin++ ) _counts[ bin ] += profile._counts[ bin ];
+
+   _nEvents += profile._nEvents;
+
+
+}
+
+
+double ThetaOccupancyProfile::getNHits() const {
+
+   return std::accumulate( _counts.begin(), _counts.end(), 0. );
+
+}
+
+
+double ThetaOccupancyProfile::getNHitsBelow( double cosTheta ) const {
+
+
+   double position = ( cosTheta + 1. ) * 0.5 * _counts.size();
+
+   if( position <= 0. ) return 0.;
+   if( position >= _counts.size() ) return getNHits();
+
+   unsigned bin = unsigned( position );
+
+   return std::accumulate( _counts.begin(), _counts.begin() + bin, 0. ) + ( position - bin ) * _counts[ bin ];
+
+
+}
+
+
+std::vector< double > ThetaOccupancyProfile::suggestBoundaries( unsigned nDivisions ) const {
+
+
+   std::vector< double > boundaries( 1, -1. );
+
+   double nHits = getNHits();
+   double binWidth = 2. / _counts.size();
+
+   double nHitsBelow = 0.; // the hits below the lower edge of the bin
+   unsigned bin = 0;
+
+   for( unsigned i=1; i < nDivisions; i++ ){
+
+      if( nHits <= 0. ){
+
+         boundaries.push_back( -1. + i * 2. / nDivisions );
+         continue;
+
+      }
+
+      double target = nHits * i / nDivisions;
+
+      // the bin where the hits below reach the target
+      while( bin + 1 < _counts.size() && nHitsBelow + _counts[ bin ] < target ){
+
+         nHitsBelow += _counts[ bin ];
+         bin++;
+
+      }
+
+      double fraction = ( _counts[ bin ] > 0. ) ? ( target - nHitsBelow ) / _counts[ bin ] : 0.;
+      fraction = std::min( std::max( fraction, 0. ), 1. );
+
+      double boundary = -1. + ( bin + fraction ) * binWidth;
+
+      // the boundaries have to be strictly increasing, even with very few hits
+      boundary = std::max( boundary, boundaries.back() + 1e-6 );
+      boundary = std::min( boundary, 1. - ( nDivisions - i ) * 1e-6 );
+
+      boundaries.push_back( boundary );
+
+   }
+
+   boundaries.push_back( 1. );
+
+
+   return boundaries;
+
+
+}
+
+
+std::vector< double > ThetaOccupancyProfile::getExpectedHits( const std::vector< double >& boundaries ) const {
+
+
+   std::vector< double > expectedHits;
+
+   double nEvents = std::max( double( _nEvents ), 1. );
+
+   for( unsigned i=0; i + 1 < boundaries.size(); i++ ){
+
+      expectedHits.push_back( ( getNHitsBelow( boundaries[ i + 1 ] ) - getNHitsBelow( boundaries[i] ) ) / nEvents );
+
+   }
+
+
+   return expectedHits;
+
+
+}
+
+
+void ThetaOccupancyProfile::write( const std::string& fileName ) const {
+
+
+   std::ofstream out( fileName.c_str() );
+
+   if( !out ) throw std::runtime_error( "ThetaOccupancyProfile: can't open " + fileName + " for writing" );
+
+   out.precision( 15 );
+
+   out << "# hits per bin in cos(theta) from -1 to 1\n";
+   out << "events " << _nEvents << "\n";
+   out << "bins " << _counts.size() << "\n";
+
+   for( unsigned bin=0; bin < _counts.size(); bin++ ) out << _counts[ bin ] << ( ( bin % 10 == 9 ) ? "\n" : " " );
+   out << "\n";
+
+   if( !out ) throw std::runtime_error( "ThetaOccupancyProfile: writing " + fileName + " failed" );
+
+
+}
+
+
+ThetaOccupancyProfile ThetaOccupancyProfile::read( const std::string& fileName ){
+
+
+   std::ifstream in( fileName.c_str() );
+
+   if( !in ) throw std::runtime_error( "ThetaOccupancyProfile: can't open " + fileName );
+
+   // all words without the comments
+   std::stringstream words;
+   std::string line;
+
+   while( std::getline( in, line ) ){
+
+      words << line.substr( 0, line.find( '#' ) ) << "\n";
+
+   }
+
+   std::string key;
+   unsigned long nEvents = 0;
+   unsigned nBins = 0;
+
+   if( !( words >> key ) || key != "events" || !( words >> nEvents ) ||
+       !( words >> key ) || key != "bins" || !( words >> nBins ) || nBins == 0 ){
+
+      throw std::runtime_error( "ThetaOccupancyProfile: " + fileName + " has to start with \"events <n>\" and \"bins <n>\"" );
+
+   }
+
+   ThetaOccupancyProfile profile( nBins );
+   profile._nEvents = nEvents;
+
+   for( unsigned bin=0; bin < nBins; bin++ ){
+
+      if( !( words >> profile._counts[ bin ] ) || profile._counts[ bin ] < 0. ){
+
+         std::stringstream s;
+         s << "ThetaOccupancyProfile: " << fileName << " has no valid number of hits for bin " << bin << " of " << nBins;
+         throw std::runtime_error( s.str() );
+
+      }
+
+   }
+
+   if( words >> key ) throw std::runtime_error( "ThetaOccupancyProfile: " + fileName + " has more values than bins" );
+
+
+   return profile;
+
+
+}
+
@@ -0,0 +1,359 @@
+////////////////////////
+// batch_criteria test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <random>
+
+#include "Criteria/Criteria.h"
+
+#include "SectorSystemEndcap.h"
+#include "EndcapHitSimple.h"
+#include "BatchCriteria.h"
+#include "FusedBatchCriterion.h"
+#include "PrecisionValidator.h"
+
+using namespace std ;
+using namespace KiTrackMarlin ;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "batch_criteria" , std::cout );
+
+
+/** Rejects the pairs whose inner hit has a negative x, one pair at a time */
+class PositiveXCriterion : public ICriterion{
+    
+public:
+    
+    PositiveXCriterion(){ _name = "PositiveX"; _type = "2Hit"; _saveValues = false; }
+    
+    virtual bool areCompatible( Segment* , Segment* child ){ return child->getHits()[0]->getX() >= 0.; }
+    
+};
+
+
+/** @return the pass mask of the criterion for the batch */
+std::vector< char > runFilter( const IBatchCriterion& criterion , const HitPairBatch& batch ){
+    
+    std::vector< char > pass( batch.size(), 1 );
+    criterion.filter( batch, pass );
+    return pass;
+    
+}
+
+//=============================================================================
+
+int main(int , char** ){
+    
+    try{
+    
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing the batch versions of the 2-hit criteria" );
+
+        SectorSystemEndcap secSys( 3, 1, 1 );
+
+        // the outer hit on a straight line from the IP at 45 degrees in phi, inner hits on and off the line
+        EndcapHitSimple outer( 100., 100., 1000., 2, 0, 0, &secSys );
+        EndcapHitSimple onLine( 50., 50., 500., 1, 0, 0, &secSys );
+        EndcapHitSimple otherPhi( -50., 50., 500., 1, 0, 0, &secSys );
+        EndcapHitSimple otherTheta( 100., 100., 500., 1, 0, 0, &secSys );
+
+        std::vector< IHit* > innerHits;
+        innerHits.push_back( &onLine );
+        innerHits.push_back( &otherPhi );
+        innerHits.push_back( &otherTheta );
+
+        std::vector< Segment* > segments;
+        Segment* outerSegment = new Segment( &outer );
+        segments.push_back( outerSegment );
+
+        HitPairBatch batch;
+        for( unsigned i = 0; i < innerHits.size(); i++ ){
+            
+            segments.push_back( new Segment( innerHits[i] ) );
+            batch.add( &outer, outerSegment, innerHits[i], segments.back() );
+            
+        }
+
+        std::vector< char > pass;
+
+        pass = runFilter( BatchCrit2_DeltaPhi( 0., 10. ), batch );
+        if( pass[0] && !pass[1] && pass[2] ) ilctest.pass( "Crit2_DeltaPhi" );
+        else ilctest.error( "Crit2_DeltaPhi" );
+
+        pass = runFilter( BatchCrit2_StraightTrackRatio( 0.9, 1.1 ), batch );
+        if( pass[0] && pass[1] && !pass[2] ) ilctest.pass( "Crit2_StraightTrackRatio" );
+        else ilctest.error( "Crit2_StraightTrackRatio" );
+
+        // the inner hit 70.7 mm further in, or at the same rho
+        pass = runFilter( BatchCrit2_DeltaRho( 10., 100. ), batch );
+        if( pass[0] && pass[1] && !pass[2] ) ilctest.pass( "Crit2_DeltaRho" );
+        else ilctest.error( "Crit2_DeltaRho" );
+
+        // the ratio of distance to distance in z is 1.010 on the line, 1.049 in the other phi and 1 for the same xy
+        pass = runFilter( BatchCrit2_RZRatio( 1.005, 1.03 ), batch );
+        if( pass[0] && !pass[1] && !pass[2] ) ilctest.pass( "Crit2_RZRatio" );
+        else ilctest.error( "Crit2_RZRatio" );
+
+        // criteria only reject: running two on the same mask gives the pairs both accept
+        pass.assign( batch.size(), 1 );
+        BatchCrit2_DeltaPhi( 0., 10. ).filter( batch, pass );
+        BatchCrit2_StraightTrackRatio( 0.9, 1.1 ).filter( batch, pass );
+        if( pass[0] && !pass[1] && !pass[2] ) ilctest.pass( "two criteria on one mask" );
+        else ilctest.error( "two criteria on one mask" );
+
+        PositiveXCriterion positiveX;
+        IBatchCriterion* adapter = createBatchCriterion( "PositiveX", 0., 0., &positiveX );
+        pass = runFilter( *adapter, batch );
+        if( adapter->getName() == "PositiveX" && pass[0] && !pass[1] && pass[2] ) ilctest.pass( "criterion without batch version via the adapter" );
+        else ilctest.error( "criterion without batch version via the adapter" );
+        delete adapter;
+
+
+
+        ilctest.log( "testing the compiled pipelines of batch criteria" );
+
+        std::vector< std::string > names;
+        std::vector< float > mins;
+        std::vector< float > maxs;
+        names.push_back( "Crit2_RZRatio" );            mins.push_back( 1. );  maxs.push_back( 1.1 );
+        names.push_back( "Crit2_DeltaPhi" );           mins.push_back( 0. );  maxs.push_back( 10. );
+        names.push_back( "Crit2_StraightTrackRatio" ); mins.push_back( 0.9 ); maxs.push_back( 1.1 );
+        names.push_back( "Crit2_DeltaRho" );           mins.push_back( 10. ); maxs.push_back( 100. );
+
+        IBatchCriterion* fused = createFusedBatchCriterion( names, mins, maxs );
+
+        // a batch with many different pairs
+        HitPairBatch bigBatch;
+        std::vector< IHit* > gridHits;
+        EndcapHitSimple* gridOuter = new EndcapHitSimple( 100., 100., 1000., 2, 0, 0, &secSys );
+        gridHits.push_back( gridOuter );
+        for( int ix = -10; ix <= 10; ix++ ){
+            for( int iy = -10; iy <= 10; iy++ ){
+                gridHits.push_back( new EndcapHitSimple( 10.*ix, 10.*iy, 500. + ix*iy, 1, 0, 0, &secSys ) );
+                bigBatch.add( gridOuter, NULL, gridHits.back(), NULL );
+            }
+        }
+
+        std::vector< char > passSeparate( bigBatch.size(), 1 );
+        for( unsigned i = 0; i < names.size(); i++ ){
+            IBatchCriterion* crit = createBatchCriterion( names[i], mins[i], maxs[i], NULL );
+            crit->filter( bigBatch, passSeparate );
+            delete crit;
+        }
+
+        if( fused != NULL ){
+            
+            std::vector< char > passFused( bigBatch.size(), 1 );
+            fused->filter( bigBatch, passFused );
+            
+            unsigned nPassed = 0;
+            for( unsigned i = 0; i < passSeparate.size(); i++ ) nPassed += passSeparate[i];
+            
+            std::stringstream sFused;
+            sFused << fused->getName() << ": " << nPassed << " of " << bigBatch.size() << " pairs pass";
+            
+            if( passFused == passSeparate && nPassed > 0 && nPassed < bigBatch.size() ) ilctest.pass( sFused.str() );
+            else ilctest.error( sFused.str() + ", but not the same as with the separate criteria" );
+            
+            delete fused;
+            
+        }
+        else ilctest.error( "no compiled pipeline for the standard 2-hit criteria" );
+
+
+
+        ilctest.log( "testing the batch criteria in float and double precision" );
+
+        // a pair right at the edge of the window in phi (10 degrees), where float and double can decide differently
+        EndcapHitSimple* edgeOuter = new EndcapHitSimple( 100., 0., 1000., 2, 0, 0, &secSys );
+        EndcapHitSimple* edgeInner = new EndcapHitSimple( 49.240387, 8.68240929, 500., 1, 0, 0, &secSys );
+        gridHits.push_back( edgeOuter );
+        gridHits.push_back( edgeInner );
+        bigBatch.add( edgeOuter, NULL, edgeInner, NULL );
+
+        fused = createFusedBatchCriterion( names, mins, maxs );
+
+        std::vector< char > passDouble( bigBatch.size(), 1 );
+        std::vector< char > passFloat( bigBatch.size(), 1 );
+        fused->filter( bigBatch, passDouble );
+        fused->setPrecision( true );
+        fused->filter( bigBatch, passFloat );
+
+        unsigned nDiffering = 0;
+        for( unsigned i = 0; i < bigBatch.size(); i++ ) if( passFloat[i] != passDouble[i] ) nDiffering++;
+
+        std::stringstream sPrecision;
+        sPrecision << nDiffering << " of " << bigBatch.size() << " decisions differ between float and double";
+
+        if( nDiffering < 10 ) ilctest.pass( sPrecision.str() );
+        else ilctest.error( sPrecision.str() );
+
+        // the validator runs both: it finds the same differences and the mask is the one of the chosen precision
+        PrecisionValidator validator;
+
+        // the first pair is rejected before, it is not a decision of the criterion
+        std::vector< char > passValidated( bigBatch.size(), 1 );
+        passValidated[0] = 0;
+        unsigned nDifferingDecided = nDiffering - ( passFloat[0] != passDouble[0] ? 1 : 0 );
+
+        fused->setPrecision( true, &validator );
+        fused->filter( bigBatch, passValidated );
+        passFloat[0] = 0;
+
+        if( passValidated == passFloat && validator.getNDecisions( fused->getName() ) == bigBatch.size() - 1 
+            && validator.getNDiffering( fused->getName() ) == nDifferingDecided ) ilctest.pass( "the validator compares float and double" );
+        else ilctest.error( "the validator doesn't compare float and double" );
+
+        std::stringstream sValidator;
+        validator.print( sValidator );
+        ilctest.log( sValidator.str() );
+
+        delete fused;
+
+        names.push_back( "Crit2_HelixWithIP" ); mins.push_back( 0. ); maxs.push_back( 1. );
+        fused = createFusedBatchCriterion( names, mins, maxs );
+        if( fused == NULL ) ilctest.pass( "no compiled pipeline for other criteria" );
+        else ilctest.error( "a compiled pipeline for other criteria" );
+        delete fused;
+
+        for( unsigned i = 0; i < gridHits.size(); i++ ) delete gridHits[i];
+
+
+
+        ilctest.log( "testing the batch criteria against the KiTrack criteria" );
+
+        // random pairs: mostly like in the endcaps, some at the same z and some close to the z axis
+        std::mt19937 generator( 4711 );
+        std::uniform_real_distribution< float > randomXY( -400., 400. );
+        std::uniform_real_distribution< float > randomZ( 200., 2500. );
+        std::uniform_real_distribution< float > randomFraction( 0., 1. );
+
+        HitPairBatch randomBatch;
+        std::vector< IHit* > randomHits;
+        std::vector< Segment* > randomSegments;
+
+        for( unsigned i = 0; i < 5000; i++ ){
+            
+            float zA = randomZ( generator );
+            float zB = ( i % 20 == 0 ) ? zA : zA * randomFraction( generator );
+            float scaleB = ( i % 50 == 1 ) ? 1e-3 : 1.;
+            
+            randomHits.push_back( new EndcapHitSimple( randomXY( generator ), randomXY( generator ), zA, 2, 0, 0, &secSys ) );
+            randomHits.push_back( new EndcapHitSimple( scaleB*randomXY( generator ), scaleB*randomXY( generator ), zB, 1, 0, 0, &secSys ) );
+            
+            randomSegments.push_back( new Segment( randomHits[ randomHits.size() - 2 ] ) );
+            randomSegments.push_back( new Segment( randomHits.back() ) );
+            
+            randomBatch.add( randomHits[ randomHits.size() - 2 ], randomSegments[ randomSegments.size() - 2 ], randomHits.back(), randomSegments.back() );
+            
+        }
+
+        // the cut off values: the window of every criterion rejects a part of the pairs
+        std::vector< std::string > critNames;
+        std::vector< float > critMins;
+        std::vector< float > critMaxs;
+        critNames.push_back( "Crit2_DeltaRho" );           critMins.push_back( -50. ); critMaxs.push_back( 200. );
+        critNames.push_back( "Crit2_RZRatio" );            critMins.push_back( 1. );   critMaxs.push_back( 1.2 );
+        critNames.push_back( "Crit2_StraightTrackRatio" ); critMins.push_back( 0.8 );  critMaxs.push_back( 1.2 );
+        critNames.push_back( "Crit2_DeltaPhi" );           critMins.push_back( 0. );   critMaxs.push_back( 30. );
+
+        // the masks of the KiTrack criteria
+        std::vector< std::vector< char > > kiTrackPass;
+        
+        for( unsigned c = 0; c < critNames.size(); c++ ){
+            
+            ICriterion* crit = Criteria::createCriterion( critNames[c], critMins[c], critMaxs[c] );
+            
+            std::vector< char > passKiTrack( randomBatch.size(), 1 );
+            for( unsigned i = 0; i < randomBatch.size(); i++ ) passKiTrack[i] = crit->areCompatible( randomBatch.segA[i], randomBatch.segB[i] );
+            kiTrackPass.push_back( passKiTrack );
+            
+            IBatchCriterion* batchCrit = createBatchCriterion( critNames[c], critMins[c], critMaxs[c], crit );
+            std::vector< char > passBatch = runFilter( *batchCrit, randomBatch );
+            
+            unsigned nPassed = 0;
+            for( unsigned i = 0; i < passKiTrack.size(); i++ ) nPassed += passKiTrack[i];
+            
+            std::stringstream sCrit;
+            sCrit << critNames[c] << ": " << nPassed << " of " << randomBatch.size() << " random pairs pass";
+            
+            if( passBatch == passKiTrack && nPassed > 0 && nPassed < randomBatch.size() ) ilctest.pass( sCrit.str() + " in both" );
+            else ilctest.error( sCrit.str() + " in KiTrack, the batch version decides differently" );
+            
+            delete batchCrit;
+            delete crit;
+            
+        }
+
+        // every compiled pipeline against the KiTrack criteria one after the other
+        std::vector< std::vector< unsigned > > pipelines;
+        unsigned pipeline0[] = { 3, 2, 0, 1 };
+        unsigned pipeline1[] = { 3, 2, 1 };
+        unsigned pipeline2[] = { 2, 1 };
+        unsigned pipeline3[] = { 3, 2 };
+        pipelines.push_back( std::vector< unsigned >( pipeline0, pipeline0 + 4 ) );
+        pipelines.push_back( std::vector< unsigned >( pipeline1, pipeline1 + 3 ) );
+        pipelines.push_back( std::vector< unsigned >( pipeline2, pipeline2 + 2 ) );
+        pipelines.push_back( std::vector< unsigned >( pipeline3, pipeline3 + 2 ) );
+
+        for( unsigned p = 0; p < pipelines.size(); p++ ){
+            
+            std::vector< std::string > pipelineNames;
+            std::vector< float > pipelineMins;
+            std::vector< float > pipelineMaxs;
+            std::vector< char > passKiTrack( randomBatch.size(), 1 );
+            
+            for( unsigned j = 0; j < pipelines[p].size(); j++ ){
+                
+                unsigned c = pipelines[p][j];
+                pipelineNames.push_back( critNames[c] );
+                pipelineMins.push_back( critMins[c] );
+                pipelineMaxs.push_back( critMaxs[c] );
+                
+                for( unsigned i = 0; i < randomBatch.size(); i++ ) passKiTrack[i] &= kiTrackPass[c][i];
+                
+            }
+            
+            IBatchCriterion* pipeline = createFusedBatchCriterion( pipelineNames, pipelineMins, pipelineMaxs );
+            
+            if( pipeline == NULL ){
+                
+                ilctest.error( "no compiled pipeline for " + pipelineNames[0] + " and the others" );
+                continue;
+                
+            }
+            
+            std::vector< char > passFused = runFilter( *pipeline, randomBatch );
+            
+            if( passFused == passKiTrack ) ilctest.pass( pipeline->getName() + " decides like the KiTrack criteria" );
+            else ilctest.error( pipeline->getName() + " decides differently than the KiTrack criteria" );
+            
+            delete pipeline;
+            
+        }
+
+        for( unsigned i = 0; i < randomHits.size(); i++ ) delete randomHits[i];
+        for( unsigned i = 0; i < randomSegments.size(); i++ ) delete randomSegments[i];
+
+        for( unsigned i = 0; i < segments.size(); i++ ) delete segments[i];
+
+        // --------------------------------------------------------------------
+        
+        
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+    
+    
+    return 0;
+}
+
+//=============================================================================
@@ -0,0 +1,129 @@
+////////////////////////
+// bounded_queue test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "BoundedQueue.h"
+
+using namespace std ;
+using namespace KiTrackMarlin ;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "bounded_queue" , std::cout );
+
+
+//=============================================================================
+
+int main(int , char** ){
+
+    try{
+
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing the bounded queue between two threads" );
+
+        const unsigned capacity = 4;
+        const int nValues = 10000;
+
+        BoundedQueue< std::vector< int > > queue( capacity );
+
+        std::atomic< int > nInQueueMax( 0 );
+        std::atomic< int > nPushed( 0 );
+        std::atomic< int > nPopped( 0 );
+
+        std::vector< int > popped;
+
+        std::thread consumer( [ &queue, &popped, &nPushed, &nPopped, &nInQueueMax ](){
+
+            std::vector< int > value;
+
+            while( queue.pop( value ) ){
+
+                nPopped++;
+                int nInQueue = nPushed - nPopped;
+                if( nInQueue > nInQueueMax ) nInQueueMax = nInQueue;
+
+                popped.push_back( value[0] );
+
+            }
+
+        } );
+
+        bool allPushed = true;
+
+        for( int i=0; i < nValues; i++ ){
+
+            std::vector< int > value( 3, i );
+            nPushed++;
+            if( !queue.push( std::move( value ) ) ) allPushed = false;
+
+        }
+
+        queue.close();
+        consumer.join();
+
+        bool inOrder = ( int( popped.size() ) == nValues );
+        for( unsigned i=0; inOrder && i < popped.size(); i++ ) if( popped[i] != int( i ) ) inOrder = false;
+
+        std::stringstream s;
+        s << popped.size() << " of " << nValues << " values popped";
+
+        if( allPushed && inOrder ) ilctest.pass( s.str() + " in the order they were pushed" );
+        else ilctest.error( s.str() + ", but not all or not in order" );
+
+        // a value is counted as pushed before push returns, so one more than the capacity can be counted as waiting
+        std::stringstream s2;
+        s2 << "at most " << nInQueueMax << " values waiting (capacity " << capacity << ")";
+
+        if( nInQueueMax <= int( capacity ) + 1 ) ilctest.pass( s2.str() );
+        else ilctest.error( s2.str() );
+
+
+        // what is in a closed queue can still be popped, pushing fails
+        BoundedQueue< std::vector< int > > closed( 2 );
+        closed.push( std::vector< int >( 1, 7 ) );
+        closed.close();
+
+        std::vector< int > value;
+        bool pushFailed = !closed.push( std::vector< int >( 1, 8 ) );
+        bool popFirst = closed.pop( value ) && ( value[0] == 7 );
+        bool popEmpty = !closed.pop( value );
+
+        if( pushFailed && popFirst && popEmpty ) ilctest.pass( "a closed queue gives out what is left and takes nothing new" );
+        else ilctest.error( "a closed queue doesn't behave as expected" );
+
+
+        // closing wakes up a producer waiting for a full queue
+        BoundedQueue< std::vector< int > > full( 1 );
+        full.push( std::vector< int >( 1, 1 ) );
+
+        std::atomic< bool > blockedPushFailed( false );
+        std::thread producer( [ &full, &blockedPushFailed ](){ blockedPushFailed = !full.push( std::vector< int >( 1, 2 ) ); } );
+
+        full.close();
+        producer.join();
+
+        if( blockedPushFailed ) ilctest.pass( "closing releases a producer waiting for a full queue" );
+        else ilctest.error( "a producer waiting for a full queue could push after closing" );
+
+        // --------------------------------------------------------------------
+
+
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================
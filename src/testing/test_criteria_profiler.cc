@@ -0,0 +1,133 @@
+////////////////////////
+// criteria_profiler test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+
+#include "CriteriaProfiler.h"
+#include "ProfiledCriterion.h"
+
+using namespace std ;
+using namespace KiTrackMarlin ;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "criteria_profiler" , std::cout );
+
+
+/** A criterion that rejects every nth call and takes some time for every call */
+class CountingCriterion : public ICriterion{
+    
+public:
+    
+    CountingCriterion( const std::string& name , unsigned rejectEvery , unsigned work ): _rejectEvery( rejectEvery ), _work( work ), _nCalls( 0 ), _sum( 0. ){
+        
+        _name = name;
+        _type = "3Hit";
+        _saveValues = false;
+        
+    }
+    
+    virtual bool areCompatible( Segment* , Segment* ){
+        
+        for( unsigned i = 0; i < _work; i++ ) _sum += std::sqrt( double( i ) );
+        
+        _nCalls++;
+        return ( _nCalls % _rejectEvery ) != 0;
+        
+    }
+    
+private:
+    
+    unsigned _rejectEvery;
+    unsigned _work;
+    unsigned _nCalls;
+    double _sum;
+    
+};
+
+
+/** Checks the criteria one after the other like the automaton: the first rejecting one ends the check */
+bool check( const std::vector< ICriterion* >& criteria ){
+    
+    for( unsigned i = 0; i < criteria.size(); i++ ){
+        
+        if( !criteria[i]->areCompatible( NULL, NULL ) ) return false;
+        
+    }
+    
+    return true;
+    
+}
+
+//=============================================================================
+
+int main(int , char** ){
+    
+    try{
+    
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing the ordering of the criteria by CriteriaProfiler" );
+
+        // slow and rarely rejecting, fast and always rejecting, and one that is never reached
+        CountingCriterion* slow = new CountingCriterion( "Slow", 10, 2000 );
+        CountingCriterion* fast = new CountingCriterion( "Fast", 1, 0 );
+        CountingCriterion* neverCalled = new CountingCriterion( "NeverCalled", 1, 0 );
+
+        std::vector< CriteriaSet > criteriaSets( 1 );
+        criteriaSets[0].crit3Vec.push_back( slow );
+        criteriaSets[0].crit3Vec.push_back( fast );
+        criteriaSets[0].crit3Vec.push_back( neverCalled );
+
+        CriteriaProfiler profiler;
+        profiler.startProfiling( criteriaSets );
+
+        if( profiler.isProfiling() && criteriaSets[0].crit3Vec.size() == 3 && criteriaSets[0].crit3Vec[0] != slow ) ilctest.pass( "the criteria are replaced while profiling" );
+        else ilctest.error( "the criteria are not replaced while profiling" );
+
+        unsigned nAccepted = 0;
+        for( unsigned i = 0; i < 1000; i++ ) if( check( criteriaSets[0].crit3Vec ) ) nAccepted++;
+
+        profiler.stopProfiling( criteriaSets );
+
+        std::stringstream s;
+        profiler.print( s );
+        ilctest.log( s.str() );
+
+        const std::vector< ICriterion* >& ordered = criteriaSets[0].crit3Vec;
+
+        if( !profiler.isProfiling() && nAccepted == 0 && ordered.size() == 3 
+            && ordered[0] == fast && ordered[1] == slow && ordered[2] == neverCalled ) ilctest.pass( "the criteria are ordered by rejections per ns" );
+        else ilctest.error( "the criteria are not ordered by rejections per ns" );
+
+
+        // every call is counted, but only every 16th is timed
+        CountingCriterion counted( "Counted", 2, 0 );
+        ProfiledCriterion profiled( &counted );
+        for( unsigned i = 0; i < 100; i++ ) profiled.areCompatible( NULL, NULL );
+
+        if( profiled.getNCalls() == 100 && profiled.getNRejected() == 50 && profiled.getNTimedCalls() == 7 && profiled.getTimePerCall() >= 1. ) ilctest.pass( "only every 16th call is timed" );
+        else ilctest.error( "the calls are not timed every 16th time" );
+
+
+        deleteCriteriaSets( criteriaSets );
+
+        // --------------------------------------------------------------------
+        
+        
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+    
+    
+    return 0;
+}
+
+//=============================================================================
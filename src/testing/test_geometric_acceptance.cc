@@ -0,0 +1,121 @@
+////////////////////////
+// geometric_acceptance test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+
+#include "SectorSystemEndcap.h"
+#include "EndcapSectorConnector.h"
+#include "GeometricAcceptanceTable.h"
+
+using namespace std ;
+using namespace KiTrackMarlin ;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "geometric_acceptance" , std::cout );
+
+
+/** @return the slope of the acceptance table for the connection from sector to target, or -2 if they are not connected */
+float getSlope( const GeometricAcceptanceTable& acceptance, const SectorConnectionTable& table, int sector, int target ){
+
+    const int* targetsBegin = table.getTargetsBegin( sector );
+    const int* targetsEnd = table.getTargetsEnd( sector );
+
+    for( const int* it = targetsBegin; it != targetsEnd; it++ ){
+
+        if( *it == target ) return acceptance.getSlopesBegin( sector )[ it - targetsBegin ];
+
+    }
+
+    return -2.f;
+
+}
+
+//=============================================================================
+
+int main(int , char** ){
+
+    try{
+
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing the geometric acceptance of pairs of hits" );
+
+        // the IP and two layers at 500 and 1000 mm, four theta divisions
+        SectorSystemEndcap secSys( 3, 1, 4 );
+
+        std::vector< float > layerZ;
+        layerZ.push_back( 0. );
+        layerZ.push_back( 500. );
+        layerZ.push_back( 1000. );
+
+        const double Bz = 3.5;
+        const double ptMin = 2.;
+
+        EndcapSectorConnector connector( &secSys, 1, 2, layerZ, Bz, ptMin );
+        const SectorConnectionTable& table = connector.getTable();
+
+        GeometricAcceptanceTable acceptance( &secSys, table, layerZ, Bz, ptMin, 0.01 );
+
+        int sectorA = secSys.getSector( 2, 0, 3 );
+        int sectorB = secSys.getSector( 1, 0, 3 );
+
+        float slope = getSlope( acceptance, table, sectorA, sectorB );
+        float slopeIP = getSlope( acceptance, table, sectorB, 0 );
+        float slopeCentral = getSlope( acceptance, table, secSys.getSector( 2, 0, 2 ), secSys.getSector( 1, 0, 2 ) );
+
+        std::stringstream s;
+        s << "slopes: forward " << slope << ", to the IP " << slopeIP << ", around 90 degrees " << slopeCentral;
+
+        // only the forward connection can be restricted, the others may curl or go to the IP
+        if( slope > 0.f && slopeIP == -1.f && slopeCentral == -1.f ) ilctest.pass( s.str() );
+        else ilctest.error( s.str() );
+
+
+        // two hits of a helix from the IP with a little more than the minimum pt: the azimuth turns by alpha / 2
+        // and the distance from the z axis is 2 R sin( alpha / 2 ), with alpha growing linear with z
+        const double radius = 1.1 * 1000. * ptMin / ( 0.3 * Bz );
+        const double alphaA = 0.5;
+        const double alphaB = alphaA * layerZ[1] / layerZ[2];
+        const double phi0 = 0.2;
+
+        float phiA = phi0 + 0.5*alphaA;
+        float rhoA = 2. * radius * std::sin( 0.5*alphaA );
+        float phiB = phi0 + 0.5*alphaB;
+        float rhoB = 2. * radius * std::sin( 0.5*alphaB );
+
+        if( acceptance.isAccepted( slope, phiA, rhoA, phiB, rhoB ) ) ilctest.pass( "the hits of a track above the minimum pt are accepted" );
+        else ilctest.error( "the hits of a track above the minimum pt are rejected" );
+
+        if( acceptance.isAccepted( slope, -phiA, rhoA, -phiB, rhoB ) ) ilctest.pass( "the hits of a track with the other charge are accepted" );
+        else ilctest.error( "the hits of a track with the other charge are rejected" );
+
+        if( !acceptance.isAccepted( slope, phiA, rhoA, phiB - 0.3, rhoB ) ) ilctest.pass( "an inner hit further off in phi is rejected" );
+        else ilctest.error( "an inner hit further off in phi is accepted" );
+
+        // the difference in phi is taken across +-pi
+        if( acceptance.isAccepted( slope, M_PI - 0.02, rhoA, -M_PI + 0.02, rhoB ) ) ilctest.pass( "a pair across +-pi is accepted" );
+        else ilctest.error( "a pair across +-pi is rejected" );
+
+        if( acceptance.isAccepted( slopeIP, phiA, rhoA, phiB + 3., rhoB ) ) ilctest.pass( "a negative slope accepts every pair" );
+        else ilctest.error( "a negative slope rejects a pair" );
+
+        // --------------------------------------------------------------------
+
+
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================
@@ -0,0 +1,109 @@
+////////////////////////
+// hit_proximity_grid test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <random>
+
+#include "SectorSystemEndcap.h"
+#include "EndcapHitSimple.h"
+#include "HitProximityGrid.h"
+
+using namespace std ;
+using namespace KiTrackMarlin ;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "hit_proximity_grid" , std::cout );
+
+
+//=============================================================================
+
+int main(int , char** ){
+
+    try{
+
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing the grid for finding close hits" );
+
+        SectorSystemEndcap secSys( 3, 4, 1 );
+
+        const double distMax = 2.;
+        HitProximityGrid grid( distMax );
+
+        // hits in a small volume, so there are many close pairs, also across the cell borders at 0
+        std::mt19937 generator( 4711 );
+        std::uniform_real_distribution< float > random( -20., 20. );
+
+        std::vector< EndcapHitSimple* > hits;
+        unsigned nDiffering = 0;
+        unsigned nClose = 0;
+
+        for( unsigned i = 0; i < 2000; i++ ){
+
+            EndcapHitSimple* hit = new EndcapHitSimple( random( generator ), random( generator ), 500. + random( generator ), 1, i % 2, 0, &secSys );
+
+            // by comparing with all hits before
+            bool closeHit = false;
+            for( unsigned j = 0; j < hits.size(); j++ ){
+
+                if( hits[j]->getSector() != hit->getSector() ) continue;
+
+                double dx = hits[j]->getX() - hit->getX();
+                double dy = hits[j]->getY() - hit->getY();
+                double dz = hits[j]->getZ() - hit->getZ();
+
+                if( dx*dx + dy*dy + dz*dz < distMax*distMax ) closeHit = true;
+
+            }
+
+            if( grid.hasCloseHit( hit->getX(), hit->getY(), hit->getZ(), hit->getSector() ) != closeHit ) nDiffering++;
+            if( closeHit ) nClose++;
+
+            grid.add( hit );
+            hits.push_back( hit );
+
+        }
+
+        std::stringstream s;
+        s << nClose << " of " << hits.size() << " hits have a close hit before, the grid differs for " << nDiffering;
+
+        if( nDiffering == 0 && nClose > 0 && nClose < hits.size() ) ilctest.pass( s.str() );
+        else ilctest.error( s.str() );
+
+
+        // a hit of another sector at the same position is not close
+        EndcapHitSimple* other = new EndcapHitSimple( 100., 100., 500., 1, 0, 0, &secSys );
+        hits.push_back( other );
+        grid.add( other );
+
+        int otherSector = secSys.getSector( 1, 1, 0 );
+
+        if( grid.hasCloseHit( 100., 100., 500., other->getSector() ) && !grid.hasCloseHit( 100., 100., 500., otherSector ) ) ilctest.pass( "only hits of the same sector are close" );
+        else ilctest.error( "hits of other sectors count as close" );
+
+        grid.clear();
+
+        if( !grid.hasCloseHit( 100., 100., 500., other->getSector() ) ) ilctest.pass( "no hits after clearing" );
+        else ilctest.error( "hits are left after clearing" );
+
+        for( unsigned i = 0; i < hits.size(); i++ ) delete hits[i];
+
+        // --------------------------------------------------------------------
+
+
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================
@@ -0,0 +1,106 @@
+////////////////////////
+// looper_finder test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <vector>
+
+#include "SectorSystemEndcap.h"
+#include "EndcapHitSimple.h"
+#include "LooperFinder.h"
+
+using namespace std ;
+using namespace KiTrackMarlin ;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "looper_finder" , std::cout );
+
+//=============================================================================
+
+int main(int , char** ){
+    
+    try{
+    
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing the masking of looper hits by LooperFinder" );
+
+        SectorSystemEndcap secSys( 19, 80, 180 );
+
+        std::vector< IHit* > hits;
+        std::map< int , std::vector< IHit* > > map_sector_hits;
+
+        // a curler: 5 hits on each of the layers 1 to 4 around the same phi and theta
+        for( int layer = 1; layer <= 4; layer++ ){
+            for( int i = 0; i < 5; i++ ) hits.push_back( new EndcapHitSimple( 0., 0., 0., layer, 10 + i%2, 30, &secSys ) );
+        }
+
+        // a dense spot on only 2 layers
+        for( int layer = 1; layer <= 2; layer++ ){
+            for( int i = 0; i < 5; i++ ) hits.push_back( new EndcapHitSimple( 0., 0., 0., layer, 60, 100, &secSys ) );
+        }
+
+        // a track: one hit per layer
+        for( int layer = 1; layer <= 6; layer++ ) hits.push_back( new EndcapHitSimple( 0., 0., 0., layer, 40, 30, &secSys ) );
+
+        // the IP
+        hits.push_back( new EndcapHitSimple( 0., 0., 0., 0, 0, 0, &secSys ) );
+
+        for( unsigned i = 0; i < hits.size(); i++ ) map_sector_hits[ hits[i]->getSector() ].push_back( hits[i] );
+
+        unsigned nHitsBefore = hits.size();
+
+        LooperFinder looperFinder( &secSys, 4, 3 );
+
+        std::map< int , std::vector< IHit* > > map_sector_loopers;
+        unsigned nMasked = looperFinder.maskLoopers( map_sector_hits, map_sector_loopers );
+
+        unsigned nHitsAfter = 0;
+        std::map< int , std::vector< IHit* > >::iterator it;
+        for( it = map_sector_hits.begin(); it != map_sector_hits.end(); it++ ) nHitsAfter += it->second.size();
+
+        unsigned nLooperHits = 0;
+        bool onlyCurler = true;
+        for( it = map_sector_loopers.begin(); it != map_sector_loopers.end(); it++ ){
+
+            nLooperHits += it->second.size();
+            if( secSys.getTheta( it->first ) != 30 || secSys.getPhi( it->first ) > 11 ) onlyCurler = false;
+
+        }
+
+        std::stringstream s;
+        s << nMasked << " hits masked, " << nLooperHits << " looper hits, " << nHitsAfter << " of " << nHitsBefore << " hits left";
+
+        if( nMasked == 20 && nLooperHits == 20 && nHitsAfter == nHitsBefore - 20 && onlyCurler ) ilctest.pass( s.str() );
+        else ilctest.error( s.str() );
+
+        if( map_sector_hits.count( 0 ) && map_sector_hits[ 0 ].size() == 1 ) ilctest.pass( "the IP is not masked" );
+        else ilctest.error( "the IP is masked" );
+
+
+        LooperFinder strictLooperFinder( &secSys, 100, 3 );
+        map_sector_loopers.clear();
+
+        if( strictLooperFinder.maskLoopers( map_sector_hits, map_sector_loopers ) == 0 && map_sector_loopers.empty() ) ilctest.pass( "nothing masked with a high threshold" );
+        else ilctest.error( "hits masked with a high threshold" );
+
+        for( unsigned i = 0; i < hits.size(); i++ ) delete hits[i];
+
+        // --------------------------------------------------------------------
+        
+        
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+    
+    
+    return 0;
+}
+
+//=============================================================================
@@ -0,0 +1,146 @@
+////////////////////////
+// phi_sorted_hits test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <cmath>
+
+#include "SectorSystemEndcap.h"
+#include "EndcapHitSimple.h"
+#include "PhiSortedHits.h"
+
+using namespace std ;
+using namespace KiTrackMarlin ;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "phi_sorted_hits" , std::cout );
+
+
+/** @return the positions in the ranges, in the order of the ranges */
+std::vector< unsigned > getPositions( const IndexRange ranges[2], unsigned nRanges ){
+
+    std::vector< unsigned > positions;
+
+    for( unsigned r=0; r < nRanges; r++ ){
+
+        for( unsigned i = ranges[r].first; i < ranges[r].second; i++ ) positions.push_back( i );
+
+    }
+
+    return positions;
+
+}
+
+/** @return the positions of the phis within halfWidth of phi, by looking at every one */
+std::vector< unsigned > getPositionsBruteForce( const std::vector< float >& phis, float phi, float halfWidth ){
+
+    std::vector< unsigned > positions;
+
+    for( unsigned i=0; i < phis.size(); i++ ){
+
+        float deltaPhi = std::fabs( phis[i] - phi );
+        if( deltaPhi > float( M_PI ) ) deltaPhi = float( 2.*M_PI ) - deltaPhi;
+
+        if( deltaPhi <= halfWidth ) positions.push_back( i );
+
+    }
+
+    return positions;
+
+}
+
+//=============================================================================
+
+int main(int , char** ){
+
+    try{
+
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing the hits sorted by phi and the range queries" );
+
+        SectorSystemEndcap secSys( 2, 1, 1 );
+
+        std::vector< EndcapHitSimple* > hits;
+        float angles[] = { 2.5, -0.3, 3.1, -3.0, 0.7, -1.2, 0.1 };
+        for( unsigned i=0; i < 7; i++ ) hits.push_back( new EndcapHitSimple( 100.*std::cos( angles[i] ), 100.*std::sin( angles[i] ), 500., 1, 0, 0, &secSys ) );
+
+        std::map< int , std::vector< IHit* > > map_sector_hits;
+        for( unsigned i=0; i < hits.size(); i++ ) map_sector_hits[ 1 ].push_back( hits[i] );
+        map_sector_hits[ 2 ]; // an empty sector
+
+        sortHitsByPhi( map_sector_hits );
+
+        const std::vector< IHit* >& sorted = map_sector_hits[ 1 ];
+
+        std::vector< float > phis;
+        for( unsigned i=0; i < sorted.size(); i++ ) phis.push_back( getHitPhi( sorted[i] ) );
+
+        std::stringstream s;
+        s << "phis after sorting:";
+        for( unsigned i=0; i < phis.size(); i++ ) s << " " << phis[i];
+
+        bool isSorted = ( sorted.size() == hits.size() ) && map_sector_hits[ 2 ].empty();
+        for( unsigned i=1; i < phis.size(); i++ ) if( phis[i-1] > phis[i] ) isSorted = false;
+
+        if( isSorted ) ilctest.pass( s.str() );
+        else ilctest.error( s.str() );
+
+
+        // a window in the middle, across +pi, across -pi and the full circle
+        float windows[][2] = { { 0.3, 0.5 }, { 3.0, 0.4 }, { -2.9, 0.3 }, { 0., 3.2 }, { 3.1, 3.0 }, { 1.8, 0.1 } };
+
+        for( unsigned w=0; w < 6; w++ ){
+
+            IndexRange ranges[2];
+            unsigned nRanges = findPhiRanges( phis, windows[w][0], windows[w][1], ranges );
+
+            std::vector< unsigned > positions = getPositions( ranges, nRanges );
+            std::vector< unsigned > expected = getPositionsBruteForce( phis, windows[w][0], windows[w][1] );
+
+            std::stringstream sw;
+            sw << "window " << windows[w][0] << " +- " << windows[w][1] << ": " << positions.size() << " hits in " << nRanges
+               << " ranges, " << expected.size() << " expected";
+
+            if( positions == expected ) ilctest.pass( sw.str() );
+            else ilctest.error( sw.str() );
+
+        }
+
+
+        // no position is found twice, even if the window goes around at both ends
+        IndexRange ranges[2];
+        unsigned nRanges = findPhiRanges( phis, 0.f, 3.1f, ranges );
+
+        if( getPositions( ranges, nRanges ) == getPositionsBruteForce( phis, 0.f, 3.1f ) ) ilctest.pass( "a window around both ends has every position once" );
+        else ilctest.error( "a window around both ends has positions twice or misses some" );
+
+
+        std::vector< float > noPhis;
+        nRanges = findPhiRanges( noPhis, 1.f, 0.5f, ranges );
+
+        if( getPositions( ranges, nRanges ).empty() ) ilctest.pass( "no positions without phis" );
+        else ilctest.error( "positions found without phis" );
+
+
+        for( unsigned i=0; i < hits.size(); i++ ) delete hits[i];
+
+        // --------------------------------------------------------------------
+
+
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================
@@ -0,0 +1,253 @@
+////////////////////////
+// sector_connector test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <set>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include "SectorSystemEndcap.h"
+#include "EndcapSectorConnector.h"
+#include "SectorConnectionTable.h"
+
+using namespace std ;
+using namespace KiTrackMarlin ;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "sector_connector" , std::cout );
+
+
+/** The targets as EndcapSectorConnector::getTargetSectors calculated them before the table was introduced.
+ * Only valid if the phi window doesn't wrap around (the old wrap-around handling was broken).
+ */
+static std::set< int > oldTargetSectors( const SectorSystemEndcap& secSys, int sector, unsigned layerStepMax, unsigned lastLayerToIP ){
+
+   std::set< int > targetSectors;
+
+   int nLayers = secSys.getNLayers();
+   int nPhi = secSys.getPhiSectors();
+   int nTheta = secSys.getThetaSectors();
+
+   int iTheta = sector/(nLayers*nPhi) ;
+   int iPhi = ((sector - (iTheta*nLayers*nPhi)) / nLayers) ;
+   int layer = sector - (iTheta*nLayers*nPhi) - (iPhi*nLayers) ;
+
+   int iTheta_Up  = iTheta + 1;
+   int iTheta_Low = iTheta - 1;
+   if (iTheta_Low < 0) iTheta_Low = 0;
+   if (iTheta_Up  >= nTheta) iTheta_Up = nTheta-1;
+
+   for( unsigned layerStep = 1; layerStep <= layerStepMax; layerStep++ ){
+
+      if ( layer >= int(layerStep) ){
+
+         for (int ip = iPhi - 8 ; ip <= iPhi + 8 ; ip++){
+            for (int iT = iTheta_Low ; iT <= iTheta_Up ; iT++){
+
+               targetSectors.insert( secSys.getSector ( layer - int(layerStep) , ip , iT ) );
+
+            }
+         }
+      }
+   }
+
+   if ( layer > 0 && ( layer <= int(lastLayerToIP) ) ) targetSectors.insert( 0 ) ;
+
+   return targetSectors;
+
+}
+
+//=============================================================================
+
+int main(int , char** ){
+
+    try{
+
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing the precomputed tables of EndcapSectorConnector and SectorConnectionTable" );
+
+        const unsigned nLayers = 6+7+5+1;
+        const unsigned nPhi = 80;
+        const unsigned nTheta = 80;
+        const unsigned nSectors = nLayers*nPhi*nTheta;
+
+        SectorSystemEndcap secSys( nLayers, nPhi, nTheta );
+
+        for( unsigned layerStepMax = 1; layerStepMax <= 2; layerStepMax++ ){
+
+            unsigned lastLayerToIP = 4;
+            EndcapSectorConnector secCon( &secSys, layerStepMax, lastLayerToIP );
+            const SectorConnectionTable& table = secCon.getTable();
+
+            unsigned nDifferent = 0;
+            unsigned nNotWrapping = 0;
+
+            for( unsigned sector = 0; sector < nSectors; sector++ ){
+
+                std::set< int > targets = secCon.getTargetSectors( sector );
+                std::set< int > tableTargets( table.getTargetsBegin( sector ), table.getTargetsEnd( sector ) );
+
+                if( targets != tableTargets || targets.size() != table.getNTargets( sector ) ){
+
+                    nDifferent++;
+                    continue;
+
+                }
+
+                unsigned iPhi = secSys.getPhi( sector );
+
+                if( iPhi >= 8 && iPhi + 8 < nPhi ){ // the phi window doesn't wrap around: compare to the old results
+
+                    nNotWrapping++;
+                    if( targets != oldTargetSectors( secSys, sector, layerStepMax, lastLayerToIP ) ) nDifferent++;
+
+                }
+                else{ // it wraps: the window must continue on the other side of 2 pi
+
+                    int layer = secSys.getLayer( sector );
+                    int iTheta = secSys.getTheta( sector );
+                    std::set< int > expected;
+
+                    for( int layerStep = 1; layerStep <= int( layerStepMax ); layerStep++ ){
+
+                        if( layer < layerStep ) continue;
+
+                        for( int dPhi = -8; dPhi <= 8; dPhi++ ){
+                            for( int iT = iTheta - 1; iT <= iTheta + 1; iT++ ){
+
+                                if( iT < 0 || iT >= int( nTheta ) ) continue;
+                                expected.insert( secSys.getSector( layer - layerStep, ( int( iPhi ) + dPhi + int( nPhi ) ) % int( nPhi ), iT ) );
+
+                            }
+                        }
+                    }
+
+                    if( layer > 0 && layer <= int( lastLayerToIP ) ) expected.insert( 0 );
+
+                    if( targets != expected ) nDifferent++;
+
+                }
+
+            }
+
+            std::stringstream s;
+            s << "layerStepMax " << layerStepMax << ": " << nNotWrapping << " sectors compared to the old results, "
+              << nDifferent << " sectors differ";
+
+            if( nDifferent == 0 && nNotWrapping > 0 ) ilctest.pass( s.str() );
+            else ilctest.error( s.str() );
+
+
+            SectorConnectionTable copy( &secCon, nSectors );
+
+            if( copy.getNConnections() == table.getNConnections() && copy.getNSectors() == nSectors ) ilctest.pass( "table made from the connector is the same" );
+            else ilctest.error( "table made from the connector differs" );
+
+        }
+
+
+        ilctest.log( "testing the windows derived from the field, the layer z positions and the minimum pt" );
+
+        std::vector< float > layerZ( nLayers, 0. );
+        for( unsigned layer = 1; layer < nLayers; layer++ ) layerZ[ layer ] = 100. + 100.*layer;
+
+        EndcapSectorConnector fixedSecCon( &secSys, 1, 4 );
+        EndcapSectorConnector stiffSecCon( &secSys, 1, 4, layerZ, 4., 1000. );
+        EndcapSectorConnector softSecCon( &secSys, 1, 4, layerZ, 4., 0.1 );
+
+        unsigned nNotContained = 0;
+
+        for( unsigned sector = 0; sector < nSectors; sector++ ){
+
+            // at 90 degrees even stiff tracks may curl
+            unsigned iTheta = secSys.getTheta( sector );
+            if( iTheta + 1 == nTheta/2 || iTheta == nTheta/2 ) continue;
+
+            std::set< int > fixedTargets = fixedSecCon.getTargetSectors( sector );
+            std::set< int > stiffTargets = stiffSecCon.getTargetSectors( sector );
+
+            for( std::set< int >::iterator it = stiffTargets.begin(); it != stiffTargets.end(); it++ ) if( !fixedTargets.count( *it ) ) nNotContained++;
+
+        }
+
+        if( stiffSecCon.usesPhysicsWindows() && nNotContained == 0 && stiffSecCon.getTable().getNConnections() < stiffSecCon.getNConnectionsFixedWindows() 
+            && stiffSecCon.getNConnectionsFixedWindows() == fixedSecCon.getTable().getNConnections() ) ilctest.pass( "windows for stiff tracks are within the fixed ones" );
+        else ilctest.error( "windows for stiff tracks are not within the fixed ones" );
+
+        if( softSecCon.getTable().getNConnections() > stiffSecCon.getTable().getNConnections() ) ilctest.pass( "windows for soft tracks are wider than for stiff tracks" );
+        else ilctest.error( "windows for soft tracks are not wider than for stiff tracks" );
+
+
+        // a straight track stays in its theta division: every window must contain it, also for soft tracks that may curl
+        SectorSystemEndcap smallSecSys( nLayers, 16, 40 );
+        const unsigned nSmallSectors = nLayers*16*40;
+        
+        for( unsigned iPt = 0; iPt < 3; iPt++ ){
+            
+            double ptMin[3] = { 0.1, 1., 1000. };
+            EndcapSectorConnector allLayersSecCon( &smallSecSys, nLayers - 1, 4, layerZ, 3.5, ptMin[ iPt ] );
+            const SectorConnectionTable& allLayersTable = allLayersSecCon.getTable();
+            
+            unsigned nMissing = 0;
+            unsigned nChecked = 0;
+            
+            for( unsigned sector = 0; sector < nSmallSectors; sector++ ){
+                
+                int layer = smallSecSys.getLayer( sector );
+                
+                for( int layerTarget = 0; layerTarget < layer; layerTarget++ ){
+                    
+                    int straightTarget = smallSecSys.getSector( layerTarget, int( smallSecSys.getPhi( sector ) ), int( smallSecSys.getTheta( sector ) ) );
+                    
+                    nChecked++;
+                    if( !std::binary_search( allLayersTable.getTargetsBegin( sector ), allLayersTable.getTargetsEnd( sector ), straightTarget ) ) nMissing++;
+                    
+                }
+                
+            }
+            
+            std::stringstream s;
+            s << "ptMin " << ptMin[ iPt ] << " GeV: " << nMissing << " of " << nChecked << " connections in the same theta division are missing";
+            
+            if( allLayersSecCon.usesPhysicsWindows() && nChecked > 0 && nMissing == 0 ) ilctest.pass( s.str() );
+            else ilctest.error( s.str() );
+            
+        }
+
+
+        // only the number of hits per sector is used for counting the pairs
+        std::map< int , std::vector< IHit* > > map_sector_hits;
+        for( unsigned sector = 0; sector < nSectors; sector += 7 ) map_sector_hits[ sector ].resize( 1 + sector % 3 );
+
+        unsigned long nPairsFixed = fixedSecCon.countCandidatePairs( map_sector_hits, false );
+
+        if( nPairsFixed > 0 && stiffSecCon.countCandidatePairs( map_sector_hits, true ) == nPairsFixed
+            && stiffSecCon.countCandidatePairs( map_sector_hits, false ) < nPairsFixed ) ilctest.pass( "pairs with the fixed windows are counted from their own table" );
+        else ilctest.error( "pairs with the fixed windows are counted wrong" );
+
+
+        SectorConnectionTable empty;
+
+        if( empty.getNSectors() == 0 && empty.getNTargets( 3 ) == 0 && empty.getTargetSectors( -1 ).empty() ) ilctest.pass( "sectors outside the table have no targets" );
+        else ilctest.error( "sectors outside the table have targets" );
+
+        // --------------------------------------------------------------------
+
+
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================
@@ -0,0 +1,175 @@
+////////////////////////
+// sector_system_endcap test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "SectorSystemEndcap.h"
+
+using namespace std ;
+using namespace KiTrackMarlin ;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "sector_system_endcap" , std::cout );
+
+
+typedef SectorEncodingEndcap< 19, 80, 180 > FixedEncoding;
+
+static_assert( FixedEncoding::getSector( 3, 2, 1 ) == 3 + 19*2 + 19*80*1, "constexpr encoding" );
+static_assert( FixedEncoding::getTheta( FixedEncoding::getSector( 3, 2, 1 ) ) == 1, "constexpr decoding" );
+
+//=============================================================================
+
+int main(int , char** ){
+    
+    try{
+    
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing the encoding of SectorSystemEndcap" );
+
+        const unsigned nLayers = 19;
+        const unsigned nPhi = 80;
+        const unsigned nTheta = 180;
+
+        SectorSystemEndcap secSys( nLayers, nPhi, nTheta );
+
+
+        unsigned nWrong = 0;
+
+        for( int layer = 0; layer < int( nLayers ); layer++ ){
+            for( int phi = 0; phi < int( nPhi ); phi++ ){
+                for( int theta = 0; theta < int( nTheta ); theta++ ){
+
+                    int sector = secSys.getSector( layer, phi, theta );
+
+                    unsigned l, p, t;
+                    secSys.decodeSector( sector, l, p, t );
+
+                    if( int( l ) != layer || int( p ) != phi || int( t ) != theta ) nWrong++;
+                    if( secSys.getLayer( sector ) != l || secSys.getPhi( sector ) != p || secSys.getTheta( sector ) != t ) nWrong++;
+                    if( FixedEncoding::getSector( layer, phi, theta ) != sector ) nWrong++;
+                    if( FixedEncoding::getLayer( sector ) != l || FixedEncoding::getPhi( sector ) != p || FixedEncoding::getTheta( sector ) != t ) nWrong++;
+
+                }
+            }
+        }
+
+        if( nWrong == 0 ) ilctest.pass( "decoding gives back layer, phi and theta" );
+        else ilctest.error( "decoding doesn't give back layer, phi and theta" );
+
+
+        nWrong = 0;
+
+        for( unsigned i = 0; i < 100000; i++ ){
+
+            int layer = i % nLayers;
+            double phi = 2*M_PI * ( ( i * 7919 ) % 100003 ) / 100003.;
+            double cosTheta = -1. + 2. * ( ( i * 104729 ) % 100019 ) / 100019.;
+
+            int sector = secSys.getSectorClamped( layer, phi, cosTheta );
+
+            if( sector != secSys.getSector( layer, phi, cosTheta ) ) nWrong++;
+            if( sector != FixedEncoding::getSectorClamped( layer, phi, cosTheta ) ) nWrong++;
+            if( !FixedEncoding::isInRange( layer, phi, cosTheta ) ) nWrong++;
+
+        }
+
+        if( nWrong == 0 && secSys.getNOutOfRange() == 0 ) ilctest.pass( "clamped encoding is the same as the throwing one in range" );
+        else ilctest.error( "clamped encoding differs from the throwing one in range" );
+
+
+        int lastSector = secSys.getSector( int( nLayers ) - 1, int( nPhi ) - 1, int( nTheta ) - 1 );
+
+        bool clampedRight = ( secSys.getSectorClamped( nLayers - 1, 2*M_PI, 1. ) == lastSector )
+                         && ( secSys.getSectorClamped( nLayers + 3, 7., 2. ) == lastSector )
+                         && ( secSys.getSectorClamped( -1, -0.1, -1.5 ) == 0 )
+                         && ( secSys.getSectorClamped( 0, std::numeric_limits< double >::quiet_NaN(), -1. ) == 0 )
+                         && ( FixedEncoding::getSectorClamped( nLayers - 1, 2*M_PI, 1. ) == lastSector )
+                         && !FixedEncoding::isInRange( nLayers - 1, 2*M_PI, 1. );
+
+        std::stringstream s;
+        s << "out of range values get clamped and counted ( " << secSys.getNOutOfRange() << " of 4 )";
+
+        if( clampedRight && secSys.getNOutOfRange() == 4 ) ilctest.pass( s.str() );
+        else ilctest.error( s.str() );
+
+
+        ilctest.log( "testing theta divisions, that aren't uniform" );
+
+        // narrow divisions in the forward region
+        std::vector< double > boundaries;
+        boundaries.push_back( -1. );
+        boundaries.push_back( 0. );
+        boundaries.push_back( 0.9 );
+        boundaries.push_back( 0.95 );
+        boundaries.push_back( 1. );
+
+        SectorSystemEndcap secSysBoundaries( nLayers, nPhi, boundaries );
+
+        bool boundariesRight = ( secSysBoundaries.getThetaSectors() == 4 ) && !secSysBoundaries.hasUniformTheta() && secSys.hasUniformTheta()
+                            && ( secSysBoundaries.getTheta( secSysBoundaries.getSector( 1, 0., -0.5 ) ) == 0 )
+                            && ( secSysBoundaries.getTheta( secSysBoundaries.getSector( 1, 0., 0. ) ) == 1 )
+                            && ( secSysBoundaries.getTheta( secSysBoundaries.getSector( 1, 0., 0.899 ) ) == 1 )
+                            && ( secSysBoundaries.getTheta( secSysBoundaries.getSector( 1, 0., 0.93 ) ) == 2 )
+                            && ( secSysBoundaries.getTheta( secSysBoundaries.getSectorClamped( 1, 0., 0.999 ) ) == 3 )
+                            && ( secSysBoundaries.getCosThetaLow( 2 ) == 0.9 ) && ( secSysBoundaries.getCosThetaHigh( 2 ) == 0.95 )
+                            && ( std::fabs( secSysBoundaries.getThetaPosition( 0.925 ) - 2.5 ) < 1e-9 );
+
+        if( boundariesRight ) ilctest.pass( "hits go into the divisions between the boundaries" );
+        else ilctest.error( "hits don't go into the divisions between the boundaries" );
+
+        // a lookup with every division at its own boundaries gives the same divisions as the uniform encoding
+        std::vector< double > uniformBoundaries;
+        for( unsigned i = 0; i <= nTheta; i++ ) uniformBoundaries.push_back( secSys.getCosThetaLow( std::min( i, nTheta - 1 ) ) );
+        uniformBoundaries.back() = 1.;
+
+        SectorSystemEndcap secSysUniformBoundaries( nLayers, nPhi, uniformBoundaries );
+
+        nWrong = 0;
+
+        for( unsigned i = 0; i < 100000; i++ ){
+
+            double cosTheta = -1. + 2. * ( ( i * 104729 ) % 100019 ) / 100019.;
+
+            if( secSysUniformBoundaries.getSectorClamped( 1, 0., cosTheta ) != secSys.getSectorClamped( 1, 0., cosTheta ) ) nWrong++;
+
+        }
+
+        std::stringstream sUniform;
+        sUniform << "boundaries of uniform divisions give the uniform sectors ( " << nWrong << " differ )";
+
+        // only cos(theta) right at a boundary could differ by rounding
+        if( nWrong < 10 ) ilctest.pass( sUniform.str() );
+        else ilctest.error( sUniform.str() );
+
+        bool thrown = false;
+        boundaries[2] = -0.5;
+        try{ SectorSystemEndcap invalid( nLayers, nPhi, boundaries ); }
+        catch( std::invalid_argument& ){ thrown = true; }
+
+        if( thrown ) ilctest.pass( "boundaries, that don't increase, are rejected" );
+        else ilctest.error( "boundaries, that don't increase, are accepted" );
+
+        // --------------------------------------------------------------------
+
+
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================
@@ -0,0 +1,171 @@
+////////////////////////
+// segment_classifier test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+
+#include "SegmentClassifier.h"
+
+using namespace std ;
+using namespace KiTrackMarlin ;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "segment_classifier" , std::cout );
+
+
+/** Writes the text to the file */
+void writeFile( const std::string& fileName , const std::string& text ){
+
+    std::ofstream out( fileName.c_str() );
+    out << text;
+
+}
+
+
+/** @return whether reading the file fails with a std::runtime_error */
+bool readFails( const std::string& fileName , const std::string& text ){
+
+    writeFile( fileName, text );
+
+    try{
+
+        delete SegmentClassifier::readFile( fileName );
+
+    }
+    catch( std::runtime_error& e ){
+
+        ilctest.log( e.what() );
+        return true;
+
+    }
+
+    return false;
+
+}
+
+//=============================================================================
+
+int main(int , char** ){
+
+    try{
+
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing the MLP and BDT segment classifiers" );
+
+        const std::string fileName = "test_segment_classifier_model.txt";
+
+        const std::string header =
+            "# a test classifier\n"
+            "hits 3\n"
+            "threshold 0.5\n"
+            "criteria Crit3_ChangeRZRatio Crit3_3DAngle\n"
+            "features Crit3_ChangeRZRatio Crit3_3DAngle\n";
+
+        // y = sigmoid( relu( a - b ) - relu( b - a ) ) after normalising a to a - 1
+        writeFile( fileName, "classifier MLP\n" + header +
+            "offsets 1 0\n"
+            "scales 1 1\n"
+            "layer 2 2 relu\n"
+            "1 -1\n"
+            "-1 1\n"
+            "0 0\n"
+            "layer 1 2 sigmoid\n"
+            "1 -1   0\n" );
+
+        SegmentClassifier* mlp = SegmentClassifier::readFile( fileName );
+
+        std::vector< float > features( 2 );
+        features[0] = 3.;
+        features[1] = 0.5;
+        float expected = 1. / ( 1. + std::exp( -1.5 ) );
+
+        std::stringstream sMLP;
+        sMLP << mlp->getType() << " for " << mlp->getNHits() << " hits: score " << mlp->score( features ) << ", expected " << expected;
+
+        if( mlp->getType() == "MLP" && mlp->getNHits() == 3 && mlp->getNFeatures() == 2 && std::fabs( mlp->score( features ) - expected ) < 1e-6 ) ilctest.pass( sMLP.str() );
+        else ilctest.error( sMLP.str() );
+
+
+        // a cut on the second feature, then on the first one
+        writeFile( fileName, "classifier BDT\n" + header +
+            "tree 5\n"
+            "1 1.5 1 2 0\n"
+            "-1 0 0 0 -1\n"
+            "0 0 3 4 0\n"
+            "-1 0 0 0 0.25\n"
+            "-1 0 0 0 1\n"
+            "tree 1\n"
+            "-1 0 0 0 0.5\n" );
+
+        SegmentClassifier* bdt = SegmentClassifier::readFile( fileName );
+
+        // a batch of three pairs, one for every leaf of the first tree
+        float batch[6] = { 1., 1.,   -1., 2.,   1., 2. };
+        float scores[3];
+        bdt->score( batch, 3, scores );
+
+        std::stringstream sBDT;
+        sBDT << bdt->getType() << ": scores " << scores[0] << " " << scores[1] << " " << scores[2];
+
+        if( scores[0] == -0.5 && scores[1] == 0.75 && scores[2] == 1.5 ) ilctest.pass( sBDT.str() );
+        else ilctest.error( sBDT.str() );
+
+        // the batch gives the same scores as the pairs one by one
+        bool sameAsSingle = true;
+        for( unsigned i = 0; i < 3; i++ ){
+
+            std::vector< float > single( batch + 2*i, batch + 2*i + 2 );
+            if( bdt->score( single ) != scores[i] ) sameAsSingle = false;
+
+        }
+
+        if( sameAsSingle ) ilctest.pass( "batch and single scores are the same" );
+        else ilctest.error( "batch and single scores differ" );
+
+        delete mlp;
+        delete bdt;
+
+
+        ilctest.log( "testing invalid classifier files" );
+
+        if( readFails( "test_segment_classifier_empty.txt", "" ) ) ilctest.pass( "an empty file is rejected" );
+        else ilctest.error( "an empty file is accepted" );
+
+        if( readFails( fileName, "classifier SVM\n" + header ) ) ilctest.pass( "an unknown classifier is rejected" );
+        else ilctest.error( "an unknown classifier is accepted" );
+
+        if( readFails( fileName, "classifier MLP\n" + header + "layer 1 2 linear\n1 1\n" ) ) ilctest.pass( "a layer without biases is rejected" );
+        else ilctest.error( "a layer without biases is accepted" );
+
+        if( readFails( fileName, "classifier MLP\n" + header + "layer 1 3 linear\n1 1 1 0\n" ) ) ilctest.pass( "a layer with the wrong number of inputs is rejected" );
+        else ilctest.error( "a layer with the wrong number of inputs is accepted" );
+
+        if( readFails( fileName, "classifier BDT\n" + header + "tree 2\n0 1 0 1 0\n-1 0 0 0 1\n" ) ) ilctest.pass( "a tree with a loop is rejected" );
+        else ilctest.error( "a tree with a loop is accepted" );
+
+        std::remove( fileName.c_str() );
+        std::remove( "test_segment_classifier_empty.txt" );
+
+        // --------------------------------------------------------------------
+
+
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================
@@ -0,0 +1,123 @@
+////////////////////////
+// segment_geometry_cache test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+
+#include "SectorSystemEndcap.h"
+#include "EndcapHitSimple.h"
+#include "SegmentGeometryCache.h"
+#include "SegmentPredictionCriterion.h"
+#include "PrecisionValidator.h"
+
+using namespace std ;
+using namespace KiTrackMarlin ;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "segment_geometry_cache" , std::cout );
+
+
+/** @return a hit on a helix from the IP with its centre at (100,0) */
+EndcapHitSimple* makeHelixHit( double z , int layer , const SectorSystemEndcap* secSys ){
+    
+    double psi = M_PI + 0.001 * z;
+    
+    return new EndcapHitSimple( 100. + 100.*cos( psi ), 100.*sin( psi ), z, layer, 0, 0, secSys );
+    
+}
+
+//=============================================================================
+
+int main(int , char** ){
+    
+    try{
+    
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing the SegmentGeometryCache and its use in the SegmentPredictionCriterion" );
+
+        SectorSystemEndcap secSys( 5, 1, 1 );
+
+        std::vector< IHit* > hits;
+        hits.push_back( makeHelixHit( 200., 1, &secSys ) );
+        hits.push_back( makeHelixHit( 300., 2, &secSys ) );
+        hits.push_back( makeHelixHit( 400., 3, &secSys ) );
+
+        // the segments of 2 hits: the parent (outer) and the child (inner)
+        std::vector< IHit* > parentHits( hits.begin() + 1, hits.begin() + 3 );
+        std::vector< IHit* > childHits( hits.begin(), hits.begin() + 2 );
+        Segment parent( parentHits );
+        Segment child( childHits );
+
+        SegmentGeometryCache& cache = SegmentGeometryCache::getThreadCache();
+        cache.clear();
+
+        const SegmentGeometry& geometry = cache.getGeometry( &parent );
+
+        std::stringstream s;
+        s << "circle of the parent: centre (" << geometry.xCentre << "," << geometry.yCentre << "), radius " << geometry.radius;
+
+        if( geometry.nHits == 2 && geometry.hasCircle && !geometry.isLine 
+            && fabs( geometry.xCentre - 100. ) < 1e-3 && fabs( geometry.yCentre ) < 1e-3 && fabs( geometry.radius - 100. ) < 1e-3 ) ilctest.pass( s.str() );
+        else ilctest.error( s.str() );
+
+        unsigned long nReused = cache.getNReused();
+        const SegmentGeometry& geometryAgain = cache.getGeometry( &parent );
+
+        if( &geometryAgain == &geometry && cache.getNReused() == nReused + 1 && cache.getNSegments() == 1 ) ilctest.pass( "the geometry is calculated once" );
+        else ilctest.error( "the geometry is calculated again" );
+
+
+        SegmentPredictionCriterion prediction( 3, 0.01, 0.01 );
+
+        if( prediction.areCompatible( &parent, &child ) ) ilctest.pass( "the hit on the helix is predicted" );
+        else ilctest.error( "the hit on the helix is not predicted" );
+
+        // a child with its inner hit rotated away in phi
+        EndcapHitSimple* offHelix = new EndcapHitSimple( -hits[0]->getY(), hits[0]->getX(), hits[0]->getZ(), 1, 0, 0, &secSys );
+        hits.push_back( offHelix );
+        std::vector< IHit* > offHits;
+        offHits.push_back( offHelix );
+        offHits.push_back( hits[1] );
+        Segment offChild( offHits );
+
+        if( !prediction.areCompatible( &parent, &offChild ) && cache.getNSegments() == 3 ) ilctest.pass( "the hit off the helix is rejected" );
+        else ilctest.error( "the hit off the helix is accepted" );
+
+        // the same decisions in float, compared to double by the validator
+        PrecisionValidator validator;
+        prediction.setPrecision( true, &validator );
+
+        bool onHelixFloat = prediction.areCompatible( &parent, &child );
+        bool offHelixFloat = prediction.areCompatible( &parent, &offChild );
+
+        if( onHelixFloat && !offHelixFloat && validator.getNDecisions( "SegmentPrediction3Hit" ) == 2 
+            && validator.getNDiffering( "SegmentPrediction3Hit" ) == 0 ) ilctest.pass( "the prediction in float decides like in double" );
+        else ilctest.error( "the prediction in float decides differently from double" );
+
+        cache.clear();
+
+        if( cache.getNSegments() == 0 ) ilctest.pass( "the cache is cleared" );
+        else ilctest.error( "the cache is not cleared" );
+
+        for( unsigned i = 0; i < hits.size(); i++ ) delete hits[i];
+
+        // --------------------------------------------------------------------
+        
+        
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+    
+    
+    return 0;
+}
+
+//=============================================================================
@@ -0,0 +1,168 @@
+////////////////////////
+// theta_binned_criterion test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+
+#include "SectorSystemEndcap.h"
+#include "EndcapHitSimple.h"
+#include "BatchCriteria.h"
+#include "ThetaBinnedCriterion.h"
+
+using namespace std ;
+using namespace KiTrackMarlin ;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "theta_binned_criterion" , std::cout );
+
+
+/** Accepts the pairs whose inner hit has an x of at most max */
+class MaxXCriterion : public ICriterion{
+
+public:
+
+    MaxXCriterion( float max ): _max( max ){ _name = "MaxX"; _type = "2Hit"; _saveValues = false; }
+
+    virtual bool areCompatible( Segment* , Segment* child ){ return child->getHits()[0]->getX() <= _max; }
+
+private:
+
+    float _max;
+
+};
+
+
+/** @return the pass mask of the criterion for the batch */
+std::vector< char > runFilter( const IBatchCriterion& criterion , const HitPairBatch& batch ){
+
+    std::vector< char > pass( batch.size(), 1 );
+    criterion.filter( batch, pass );
+    return pass;
+
+}
+
+//=============================================================================
+
+int main(int , char** ){
+
+    try{
+
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing criteria with cut off values per theta division" );
+
+        // two theta divisions: backward (0) and forward (1)
+        SectorSystemEndcap secSys( 3, 1, 2 );
+
+        // outer hits in both theta divisions, the inner hits 5 degrees off in phi
+        const double dPhi = 5. * M_PI / 180.;
+
+        EndcapHitSimple outerForward( 100., 0., 1000., 2, 0, 1, &secSys );
+        EndcapHitSimple innerForward( 50.*std::cos( dPhi ), 50.*std::sin( dPhi ), 500., 1, 0, 1, &secSys );
+        EndcapHitSimple outerBackward( 100., 0., -1000., 2, 0, 0, &secSys );
+        EndcapHitSimple innerBackward( 50.*std::cos( dPhi ), 50.*std::sin( dPhi ), -500., 1, 0, 0, &secSys );
+
+        Segment segOuterForward( &outerForward );
+        Segment segInnerForward( &innerForward );
+        Segment segOuterBackward( &outerBackward );
+        Segment segInnerBackward( &innerBackward );
+
+        // a tight cut backward, a loose one forward
+        std::vector< IBatchCriterion* > deltaPhis;
+        deltaPhis.push_back( new BatchCrit2_DeltaPhi( 0., 1. ) );
+        deltaPhis.push_back( new BatchCrit2_DeltaPhi( 0., 10. ) );
+
+        ThetaBinnedBatchCriterion thetaDeltaPhi( &secSys, deltaPhis );
+
+        HitPairBatch forward;
+        forward.add( &outerForward, &segOuterForward, &innerForward, &segInnerForward );
+
+        HitPairBatch backward;
+        backward.add( &outerBackward, &segOuterBackward, &innerBackward, &segInnerBackward );
+
+        HitPairBatch mixed;
+        mixed.add( &outerForward, &segOuterForward, &innerForward, &segInnerForward );
+        mixed.add( &outerBackward, &segOuterBackward, &innerBackward, &segInnerBackward );
+        mixed.add( &outerForward, &segOuterForward, &innerForward, &segInnerForward );
+
+        std::vector< char > pass;
+
+        pass = runFilter( thetaDeltaPhi, forward );
+        if( thetaDeltaPhi.getName() == "Crit2_DeltaPhi" && pass[0] ) ilctest.pass( "the forward pair passes the loose cut" );
+        else ilctest.error( "the forward pair doesn't pass the loose cut" );
+
+        pass = runFilter( thetaDeltaPhi, backward );
+        if( !pass[0] ) ilctest.pass( "the backward pair fails the tight cut" );
+        else ilctest.error( "the backward pair passes the tight cut" );
+
+        pass = runFilter( thetaDeltaPhi, mixed );
+        if( pass[0] && !pass[1] && pass[2] ) ilctest.pass( "a batch with both theta divisions" );
+        else ilctest.error( "a batch with both theta divisions" );
+
+        // a pair already rejected stays rejected
+        pass.assign( mixed.size(), 1 );
+        pass[2] = 0;
+        thetaDeltaPhi.filter( mixed, pass );
+        if( pass[0] && !pass[1] && !pass[2] ) ilctest.pass( "rejected pairs stay rejected" );
+        else ilctest.error( "rejected pairs are accepted again" );
+
+        thetaDeltaPhi.setPrecision( true );
+        if( thetaDeltaPhi.usesFloat() && deltaPhis[0]->usesFloat() && deltaPhis[1]->usesFloat() ) ilctest.pass( "the precision is passed on to all divisions" );
+        else ilctest.error( "the precision is not passed on to all divisions" );
+
+
+        // the same for one pair at a time
+        std::vector< ICriterion* > maxXs;
+        maxXs.push_back( new MaxXCriterion( 10. ) );
+        maxXs.push_back( new MaxXCriterion( 100. ) );
+
+        ThetaBinnedCriterion thetaMaxX( &secSys, maxXs );
+
+        if( thetaMaxX.getName() == "MaxX" && thetaMaxX.getType() == "2Hit"
+            && thetaMaxX.areCompatible( &segOuterForward, &segInnerForward )
+            && !thetaMaxX.areCompatible( &segOuterBackward, &segInnerBackward ) ) ilctest.pass( "the single pair criterion uses the cut of the parent's division" );
+        else ilctest.error( "the single pair criterion doesn't use the cut of the parent's division" );
+
+
+
+        ilctest.log( "testing the tables of cut off values" );
+
+        // two rounds for the minima, only one for the maxima
+        ThetaCutTable table;
+        table.sectorSystem = &secSys;
+        table.minima[ "Crit2_DeltaPhi" ] = { 0., 1.,   2., 3. };
+        table.maxima[ "Crit2_DeltaPhi" ] = { 10., 20. };
+
+        if( table.hasTable( "Crit2_DeltaPhi" ) && !table.hasTable( "Crit2_RZRatio" ) && table.getNRounds( "Crit2_DeltaPhi" ) == 2 ) ilctest.pass( "rounds of the table" );
+        else ilctest.error( "rounds of the table" );
+
+        std::stringstream s;
+        s << "values: " << ThetaCutTable::getValue( table.minima, "Crit2_DeltaPhi", 1, 1, 2, -1. )
+          << " " << ThetaCutTable::getValue( table.maxima, "Crit2_DeltaPhi", 3, 0, 2, -1. )
+          << " " << ThetaCutTable::getValue( table.maxima, "Crit2_RZRatio", 0, 0, 2, -1. );
+
+        // the value of the round, the last round's value and the global value
+        if( ThetaCutTable::getValue( table.minima, "Crit2_DeltaPhi", 1, 1, 2, -1. ) == 3.
+            && ThetaCutTable::getValue( table.maxima, "Crit2_DeltaPhi", 3, 0, 2, -1. ) == 10.
+            && ThetaCutTable::getValue( table.maxima, "Crit2_RZRatio", 0, 0, 2, -1. ) == -1. ) ilctest.pass( s.str() );
+        else ilctest.error( s.str() );
+
+        // --------------------------------------------------------------------
+
+
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================
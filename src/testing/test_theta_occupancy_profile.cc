@@ -0,0 +1,117 @@
+////////////////////////
+// theta_occupancy_profile test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include "ThetaOccupancyProfile.h"
+
+using namespace std ;
+using namespace KiTrackMarlin ;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "theta_occupancy_profile" , std::cout );
+
+//=============================================================================
+
+int main(int , char** ){
+
+    try{
+
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing the occupancy profile in theta" );
+
+        ThetaOccupancyProfile profile( 100 );
+
+        // a flat background and a dense forward peak
+        for( unsigned i = 0; i < 1000; i++ ) profile.fill( -1. + 2. * ( i + 0.5 ) / 1000. );
+        for( unsigned i = 0; i < 3000; i++ ) profile.fill( 0.9 + 0.1 * ( i + 0.5 ) / 3000. );
+        profile.fill( 1.5 );
+        profile.fill( -2. );
+
+        for( unsigned i = 0; i < 10; i++ ) profile.addEvent();
+
+        if( profile.getNHits() == 4002. && profile.getCount( 0 ) == 11. && profile.getCount( 99 ) == 611. ) ilctest.pass( "hits out of range go into the first and last bin" );
+        else ilctest.error( "hits out of range don't go into the first and last bin" );
+
+
+        std::vector< double > boundaries = profile.suggestBoundaries( 4 );
+        std::vector< double > expected = profile.getExpectedHits( boundaries );
+
+        std::stringstream s;
+        s << "boundaries:";
+        for( unsigned i = 0; i < boundaries.size(); i++ ) s << " " << boundaries[i];
+        s << ", hits per event:";
+        for( unsigned i = 0; i < expected.size(); i++ ) s << " " << expected[i];
+
+        bool equalised = ( boundaries.size() == 5 ) && ( boundaries.front() == -1. ) && ( boundaries.back() == 1. );
+        for( unsigned i = 0; i < expected.size(); i++ ) if( std::fabs( expected[i] - 100.05 ) > 0.5 ) equalised = false;
+
+        // three of the four divisions go to the peak
+        if( equalised && boundaries[1] > 0.9 ) ilctest.pass( s.str() );
+        else ilctest.error( s.str() );
+
+        // without hits the divisions are uniform
+        std::vector< double > uniform = ThetaOccupancyProfile( 100 ).suggestBoundaries( 4 );
+        if( uniform.size() == 5 && uniform[1] == -0.5 && uniform[2] == 0. && uniform[3] == 0.5 ) ilctest.pass( "uniform divisions without hits" );
+        else ilctest.error( "no uniform divisions without hits" );
+
+        // all hits in one bin still give increasing boundaries
+        ThetaOccupancyProfile spike( 100 );
+        for( unsigned i = 0; i < 10; i++ ) spike.fill( 0.999 );
+        std::vector< double > spikeBoundaries = spike.suggestBoundaries( 8 );
+
+        bool increasing = true;
+        for( unsigned i = 1; i < spikeBoundaries.size(); i++ ) if( !( spikeBoundaries[i] > spikeBoundaries[i-1] ) ) increasing = false;
+
+        if( increasing ) ilctest.pass( "the boundaries are strictly increasing for a single dense bin" );
+        else ilctest.error( "the boundaries are not strictly increasing for a single dense bin" );
+
+
+        ilctest.log( "testing the profile files" );
+
+        const std::string fileName = "test_theta_occupancy_profile.txt";
+
+        profile.write( fileName );
+        ThetaOccupancyProfile readProfile = ThetaOccupancyProfile::read( fileName );
+
+        bool same = ( readProfile.getNBins() == profile.getNBins() ) && ( readProfile.getNEvents() == profile.getNEvents() );
+        for( unsigned bin = 0; bin < profile.getNBins() && same; bin++ ) same = ( readProfile.getCount( bin ) == profile.getCount( bin ) );
+
+        if( same ) ilctest.pass( "a written profile is read back the same" );
+        else ilctest.error( "a written profile is read back differently" );
+
+        std::ofstream( fileName.c_str() ) << "# too few bins\nevents 1\nbins 3\n1 2\n";
+
+        bool thrown = false;
+        try{ ThetaOccupancyProfile::read( fileName ); }
+        catch( std::runtime_error& e ){ thrown = true; ilctest.log( e.what() ); }
+
+        if( thrown ) ilctest.pass( "a file with too few bins is rejected" );
+        else ilctest.error( "a file with too few bins is accepted" );
+
+        std::remove( fileName.c_str() );
+
+        // --------------------------------------------------------------------
+
+
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================